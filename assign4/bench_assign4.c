@@ -0,0 +1,1033 @@
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+#include "record_mgr.h"
+#include "dberror.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// benchmarks, run all of them or the ones named on the command line
+static void benchPin (void);
+static void benchPinMemory (void);
+static void benchDevice (void);
+static void benchCommit (void);
+static void benchRecords (void);
+static void benchLoad (void);
+static void benchKernels (void);
+static void benchParallel (void);
+static void benchLayout (void);
+static void benchZones (void);
+static void benchIndex (void);
+
+typedef struct Benchmark {
+	char *name;
+	void (*run)(void);
+} Benchmark;
+
+static Benchmark benchmarks[] = {
+	{"pin", benchPin},
+	{"pin_mem", benchPinMemory},
+	{"device", benchDevice},
+	{"commit", benchCommit},
+	{"records", benchRecords},
+	{"load", benchLoad},
+	{"kernels", benchKernels},
+	{"parallel", benchParallel},
+	{"layout", benchLayout},
+	{"zones", benchZones},
+	{"index", benchIndex},
+};
+
+#define BENCH_FILE "bench.bin"
+
+// page file of the current benchmark
+static char *benchFile = BENCH_FILE;
+
+// cycle counter, wall clock nanoseconds where there is no TSC
+static unsigned long long
+benchCycles (void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+// main method
+int
+main (int argc, char **argv)
+{
+	int i, j;
+	int num = sizeof(benchmarks) / sizeof(benchmarks[0]);
+
+	initStorageManager();
+	for (i = 0; i < num; i++)
+	{
+		int selected = (argc < 2);
+		for (j = 1; j < argc; j++)
+			if (strcmp(argv[j], benchmarks[i].name) == 0)
+				selected = 1;
+		if (selected)
+		{
+			printf("== %s\n", benchmarks[i].name);
+			benchmarks[i].run();
+		}
+	}
+	return 0;
+}
+
+// ************************************************************
+// cycles per pin/unpin pair for each replacement strategy, once with the
+// working set resident in the pool (lookup + bookkeeping only) and once
+// with a working set four times the pool (victim search + read)
+static void
+benchPin (void)
+{
+	char *names[] = {"FIFO", "LRU", "CLOCK", "LFU", "LRU_K"};
+	int poolSize = 64, filePages = 4 * 64, rounds = 20000;
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_PageHandle *h = MAKE_PAGE_HANDLE();
+	int s, i, r;
+
+	createPageFile(benchFile);
+	initBufferPool(bm, benchFile, poolSize, RS_FIFO, NULL);
+	for (i = 0; i < filePages; i++)
+	{
+		pinPage(bm, h, i);
+		markDirty(bm, h);
+		unpinPage(bm, h);
+	}
+	shutdownBufferPool(bm);
+
+	printf("%-8s %16s %16s\n", "strategy", "hit cycles/pin", "miss cycles/pin");
+	for (s = RS_FIFO; s <= RS_LRU_K; s++)
+	{
+		unsigned long long start, hit, miss;
+		int k = 2;
+		initBufferPool(bm, benchFile, poolSize, s, &k);
+
+		for (i = 0; i < poolSize; i++)
+		{
+			pinPage(bm, h, i);
+			unpinPage(bm, h);
+		}
+		start = benchCycles();
+		for (r = 0; r < rounds; r++)
+			for (i = 0; i < poolSize; i++)
+			{
+				pinPage(bm, h, i);
+				unpinPage(bm, h);
+			}
+		hit = benchCycles() - start;
+
+		start = benchCycles();
+		for (r = 0; r < rounds / 50; r++)
+			for (i = 0; i < filePages; i++)
+			{
+				pinPage(bm, h, (i * 7) % filePages);
+				unpinPage(bm, h);
+			}
+		miss = benchCycles() - start;
+
+		printf("%-8s %16.1f %16.1f\n", names[s],
+				(double) hit / ((double) rounds * poolSize),
+				(double) miss / ((double) (rounds / 50) * filePages));
+		shutdownBufferPool(bm);
+	}
+
+	destroyPageFile(benchFile);
+	free(h);
+	free(bm);
+}
+
+// ************************************************************
+// the pin benchmark on the in-memory backend, misses cost no I/O
+static void
+benchPinMemory (void)
+{
+	benchFile = SM_MEMORY_PREFIX BENCH_FILE;
+	benchPin();
+	benchFile = BENCH_FILE;
+}
+
+// ************************************************************
+// throughput of a buffer pool on synthetic devices: the page file lives in
+// memory behind the latency backend and the injected delays are added to
+// the measured CPU time instead of being slept
+static double
+benchDeviceRun (BM_BufferPool *bm, int filePages, int scan)
+{
+	BM_PageHandle h[16];
+	PageNumber pages[16];
+	SM_LatencyStats stats;
+	struct timespec t0, t1;
+	int i, j, pins = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	if (scan)
+	{
+		// sequential scan in batches, misses are read in runs
+		for (i = 0; i < filePages; i += 16)
+		{
+			for (j = 0; j < 16; j++)
+				pages[j] = i + j;
+			pinPages(bm, h, pages, 16);
+			unpinPages(bm, h, 16);
+			pins += 16;
+		}
+	}
+	else
+	{
+		unsigned int seed = 7;
+		for (i = 0; i < filePages; i++)
+		{
+			// 80% of the pins go to a hot set of half the pool
+			int page = rand_r(&seed) % 10 < 8 ? rand_r(&seed) % (filePages / 128) : rand_r(&seed) % filePages;
+			pinPage(bm, h, page);
+			unpinPage(bm, h);
+			pins++;
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	getStorageLatencyStats(&stats);
+	return pins / ((t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9 + stats.micros / 1e6);
+}
+
+static void
+benchDevice (void)
+{
+	char *strategies[] = {"FIFO", "LRU", "CLOCK", "LFU", "LRU_K"};
+	char *devices[] = {"fixed", "ssd", "hdd"};
+	SM_LatencyConfig configs[3];
+	int poolSize = 128, filePages = 8192;
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_PageHandle *h = MAKE_PAGE_HANDLE();
+	int d, s, i, k = 2;
+
+	memset(configs, 0, sizeof(configs));
+	configs[0].model = SM_LATENCY_FIXED;
+	configs[0].readMicros = configs[0].writeMicros = 100;
+	configs[1].model = SM_LATENCY_SSD;
+	configs[1].readMicros = 60;
+	configs[1].writeMicros = 30;
+	configs[1].jitterMicros = 40;
+	configs[1].bandwidth = 2000L * 1024 * 1024;
+	configs[2].model = SM_LATENCY_HDD;
+	configs[2].seekMicros = 8000;
+	configs[2].rotationMicros = 4000;
+	configs[2].spanPages = 1 << 18;
+	configs[2].bandwidth = 150L * 1024 * 1024;
+	for (d = 0; d < 3; d++)
+		configs[d].virtualTime = 1;
+
+	setStorageLatency(&memoryStorageBackend, &configs[0]);
+	setDefaultStorageBackend(&latencyStorageBackend);
+	createPageFile(BENCH_FILE);
+	initBufferPool(bm, BENCH_FILE, poolSize, RS_FIFO, NULL);
+	for (i = 0; i < filePages; i++)
+	{
+		pinPage(bm, h, i);
+		markDirty(bm, h);
+		unpinPage(bm, h);
+	}
+	shutdownBufferPool(bm);
+
+	printf("%-8s %-8s %14s %14s\n", "device", "strategy", "scan pins/s", "skewed pins/s");
+	for (d = 0; d < 3; d++)
+		for (s = RS_FIFO; s <= RS_LRU_K; s++)
+		{
+			double scan, skewed;
+			initBufferPool(bm, BENCH_FILE, poolSize, s, &k);
+			setStorageLatency(&memoryStorageBackend, &configs[d]);
+			scan = benchDeviceRun(bm, filePages, 1);
+			setStorageLatency(&memoryStorageBackend, &configs[d]);
+			skewed = benchDeviceRun(bm, filePages, 0);
+			printf("%-8s %-8s %14.0f %14.0f\n", devices[d], strategies[s], scan, skewed);
+			shutdownBufferPool(bm);
+		}
+
+	destroyPageFile(BENCH_FILE);
+	setDefaultStorageBackend(NULL);
+	free(h);
+	free(bm);
+}
+
+// ************************************************************
+// commit throughput against the number of concurrent writers: every commit
+// changes the writer's own page and forces it, the device takes 1ms per
+// cache flush and serves one flush at a time
+#define COMMITS_PER_WRITER 50
+
+typedef struct BenchWriter {
+	BM_BufferPool *bm;
+	PageNumber pageNum;
+} BenchWriter;
+
+static void *
+benchCommitWriter (void *arg)
+{
+	BenchWriter *w = (BenchWriter *) arg;
+	BM_PageHandle h;
+	int i;
+	for (i = 0; i < COMMITS_PER_WRITER; i++)
+	{
+		pinPage(w->bm, &h, w->pageNum);
+		sprintf(h.data, "commit-%i", i);
+		markDirty(w->bm, &h);
+		forcePage(w->bm, &h);
+		unpinPage(w->bm, &h);
+	}
+	return NULL;
+}
+
+static void
+benchCommit (void)
+{
+	char *modes[] = {"none", "sync", "periodic", "group"};
+	int writers[] = {1, 2, 4, 8, 16};
+	SM_LatencyConfig config;
+	BM_BufferPool *bm = MAKE_POOL();
+	pthread_t threads[16];
+	BenchWriter args[16];
+	int m, w, i;
+
+	memset(&config, 0, sizeof(config));
+	config.model = SM_LATENCY_FIXED;
+	config.syncMicros = 1000;
+	setStorageLatency(&memoryStorageBackend, &config);
+	setDefaultStorageBackend(&latencyStorageBackend);
+	createPageFile(BENCH_FILE);
+
+	printf("%-9s", "mode");
+	for (w = 0; w < 5; w++)
+		printf(" %6i writers", writers[w]);
+	printf("   (commits/s)\n");
+	for (m = SM_DURABILITY_NONE; m <= SM_DURABILITY_GROUP_COMMIT; m++)
+	{
+		printf("%-9s", modes[m]);
+		for (w = 0; w < 5; w++)
+		{
+			struct timespec t0, t1;
+			initBufferPool(bm, BENCH_FILE, 16, RS_LRU, NULL);
+			setPoolDurability(bm, m, 10000);
+			clock_gettime(CLOCK_MONOTONIC, &t0);
+			for (i = 0; i < writers[w]; i++)
+			{
+				args[i].bm = bm;
+				args[i].pageNum = i;
+				pthread_create(&threads[i], NULL, benchCommitWriter, &args[i]);
+			}
+			for (i = 0; i < writers[w]; i++)
+				pthread_join(threads[i], NULL);
+			clock_gettime(CLOCK_MONOTONIC, &t1);
+			printf(" %14.0f", writers[w] * COMMITS_PER_WRITER
+					/ ((t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9));
+			shutdownBufferPool(bm);
+		}
+		printf("\n");
+	}
+
+	destroyPageFile(BENCH_FILE);
+	setDefaultStorageBackend(NULL);
+	free(bm);
+}
+
+// ************************************************************
+// records per second of the record manager on a table in memory, and how
+// many records a page holds compared to the text slots of old tables
+#define BENCH_RECORDS 200000
+
+static double
+benchSeconds (struct timespec *t0)
+{
+	struct timespec t1;
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	return (t1.tv_sec - t0->tv_sec) + (t1.tv_nsec - t0->tv_nsec) / 1e9;
+}
+
+static void
+benchRecords (void)
+{
+	char *names[] = {"a", "b", "c"};
+	DataType dt[] = {DT_INT, DT_STRING, DT_INT};
+	int sizes[] = {0, 4, 0};
+	int keys[] = {0};
+	char *table = SM_MEMORY_PREFIX "bench_table";
+	Schema *schema = createSchema(3, names, dt, sizes, 1, keys);
+	RM_TableData rel;
+	RM_ScanHandle scan;
+	RID *rids = (RID *) malloc(sizeof(RID) * BENCH_RECORDS);
+	Record *r;
+	struct timespec t0;
+	RM_RecordRef ref;
+	Value *value;
+	int i, j, n = 0;
+	long sum = 0;
+	double insert, get, full, copied, inPlace, churn, interpreted, compiled, batched, projected;
+	RM_Batch *batch;
+	Expr *cond, *left, *right;
+	int pages;
+
+	initRecordManager(NULL);
+	createTable(table, schema);
+	openTable(&rel, table);
+	createRecord(&r, schema);
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < BENCH_RECORDS; i++)
+	{
+		memcpy(r->data, &i, sizeof(int));
+		memcpy(r->data + sizeof(int), "abcd", 4);
+		memcpy(r->data + sizeof(int) + 4, &i, sizeof(int));
+		insertRecord(&rel, r);
+		rids[i] = r->id;
+	}
+	insert = BENCH_RECORDS / benchSeconds(&t0);
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < BENCH_RECORDS; i++)
+		getRecord(&rel, rids[(i * 7919) % BENCH_RECORDS], r);
+	get = BENCH_RECORDS / benchSeconds(&t0);
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	startScan(&rel, &scan, NULL);
+	while (next(&scan, r) == RC_OK)
+		n++;
+	closeScan(&scan);
+	full = n / benchSeconds(&t0);
+
+	// a condition matching a tenth of the table: evalExpr per record
+	// against the program the scan compiles
+	MAKE_ATTRREF(left, 0);
+	MAKE_CONS(right, stringToValue("i20000"));
+	MAKE_BINOP_EXPR(cond, left, right, OP_COMP_SMALLER);
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	n = 0;
+	startScan(&rel, &scan, NULL);
+	while (next(&scan, r) == RC_OK)
+	{
+		evalExpr(r, schema, cond, &value);
+		n += value->v.boolV;
+		freeVal(value);
+	}
+	closeScan(&scan);
+	interpreted = BENCH_RECORDS / benchSeconds(&t0);
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	n = 0;
+	startScan(&rel, &scan, cond);
+	while (next(&scan, r) == RC_OK)
+		n++;
+	closeScan(&scan);
+	compiled = BENCH_RECORDS / benchSeconds(&t0);
+	createBatch(&batch, schema, RM_BATCH_SIZE);
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	n = 0;
+	startScan(&rel, &scan, cond);
+	while (nextBatch(&scan, batch) == RC_OK)
+		n += batch->numSelected;
+	closeScan(&scan);
+	batched = BENCH_RECORDS / benchSeconds(&t0);
+	freeBatch(batch, schema);
+	freeExpr(cond);
+
+	// reading every attribute: copy and getAttr against a ref and the typed reads
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < BENCH_RECORDS; i++)
+	{
+		getRecord(&rel, rids[(i * 7919) % BENCH_RECORDS], r);
+		for (j = 0; j < 3; j++)
+		{
+			getAttr(r, schema, j, &value);
+			sum += j == 1 ? value->v.stringV[0] : value->v.intV;
+			freeVal(value);
+		}
+	}
+	copied = BENCH_RECORDS / benchSeconds(&t0);
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < BENCH_RECORDS; i++)
+	{
+		if (getRecordRef(&rel, rids[(i * 7919) % BENCH_RECORDS], &ref) != RC_OK)
+			continue;
+		sum += getIntAttr(&ref.record, schema, 0);
+		sum += getStringAttrRef(&ref.record, schema, 1, &j)[0];
+		sum += getIntAttr(&ref.record, schema, 2);
+		releaseRecordRef(&rel, &ref);
+	}
+	inPlace = BENCH_RECORDS / benchSeconds(&t0);
+
+	// churn: delete every other record, then insert as many again
+	pages = ((RM_RecordMtdt *) rel.mgmtData)->pageOffset;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < BENCH_RECORDS; i += 2)
+		deleteRecord(&rel, rids[i]);
+	for (i = 0; i < BENCH_RECORDS; i += 2)
+	{
+		j = BENCH_RECORDS + i;
+		memcpy(r->data, &j, sizeof(int));
+		insertRecord(&rel, r);
+	}
+	churn = BENCH_RECORDS / benchSeconds(&t0);
+
+	printf("%-8s %14s %14s %14s\n", "format", "insert rec/s", "get rec/s", "scan rec/s");
+	printf("%-8s %14.0f %14.0f %14.0f\n", "slotted", insert, get, full);
+	printf("scan with a < 20000 (%i matches): evalExpr %.0f rec/s, compiled %.0f rec/s, batches %.0f rec/s\n",
+			n, interpreted, compiled, batched);
+	printf("records per page: text %i, slotted %i\n",
+			PAGE_SIZE / calcSlotLen(schema), calcSlotMax(getRecordSize(schema)));
+	printf("all attributes: getRecord+getAttr %.0f rec/s, getRecordRef+typed %.0f rec/s (%ld)\n",
+			copied, inPlace, sum);
+	printf("churn: %.0f deletes+inserts/s, %i pages before, %i after\n",
+			churn, pages, ((RM_RecordMtdt *) rel.mgmtData)->pageOffset);
+
+	freeRecord(r);
+	closeTable(&rel);
+	deleteTable(table);
+
+	// a STRING[255] column holding 10 bytes per record
+	sizes[1] = 255;
+	schema = createSchema(3, names, dt, sizes, 1, keys);
+	createTable(table, schema);
+	openTable(&rel, table);
+	createRecord(&r, schema);
+	memset(r->data, 0, getRecordSize(schema));
+	memcpy(r->data + sizeof(int), "abcdefghij", 10);
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < BENCH_RECORDS; i++)
+	{
+		memcpy(r->data, &i, sizeof(int));
+		insertRecord(&rel, r);
+	}
+	insert = BENCH_RECORDS / benchSeconds(&t0);
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	n = 0;
+	startScan(&rel, &scan, NULL);
+	while (next(&scan, r) == RC_OK)
+		n++;
+	closeScan(&scan);
+	full = n / benchSeconds(&t0);
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	n = 0;
+	startProjectedScan(&rel, &scan, NULL, 1, keys);
+	while (next(&scan, r) == RC_OK)
+		n++;
+	closeScan(&scan);
+	projected = n / benchSeconds(&t0);
+	printf("STRING[255] with 10 bytes: %i pages (%i at fixed length), insert %.0f rec/s, scan %.0f rec/s, scan of a %.0f rec/s\n",
+			((RM_RecordMtdt *) rel.mgmtData)->pageOffset,
+			BENCH_RECORDS / calcSlotMax(getRecordSize(schema)) + 1, insert, full, projected);
+
+	freeRecord(r);
+	closeTable(&rel);
+	deleteTable(table);
+	shutdownRecordManager();
+	free(rids);
+}
+
+// ************************************************************
+// load rate of a table on disk: one insertRecord per row against
+// insertRecords in batches
+#define BENCH_LOAD_ROWS 1000000
+#define BENCH_LOAD_BATCH 1000
+
+static void
+benchLoad (void)
+{
+	char *names[] = {"a", "b", "c"};
+	DataType dt[] = {DT_INT, DT_STRING, DT_INT};
+	int sizes[] = {0, 16, 0};
+	// a repeats in every batch, the table has no key
+	int keys[] = {0};
+	char *table = "bench_load_table";
+	Schema *schema = createSchema(3, names, dt, sizes, 0, keys);
+	Record **batch = (Record **) malloc(sizeof(Record *) * BENCH_LOAD_BATCH);
+	RM_TableData rel;
+	struct timespec t0;
+	double single, bulk;
+	int i, j, pages;
+
+	for (i = 0; i < BENCH_LOAD_BATCH; i++)
+	{
+		createRecord(&batch[i], schema);
+		memset(batch[i]->data, 0, getRecordSize(schema));
+		memcpy(batch[i]->data, &i, sizeof(int));
+		memcpy(batch[i]->data + sizeof(int), "load-row", 8);
+	}
+	initRecordManager(NULL);
+
+	deleteTable(table);
+	createTable(table, schema);
+	openTable(&rel, table);
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < BENCH_LOAD_ROWS; i++)
+		insertRecord(&rel, batch[i % BENCH_LOAD_BATCH]);
+	closeTable(&rel);
+	single = BENCH_LOAD_ROWS / benchSeconds(&t0);
+	deleteTable(table);
+
+	createTable(table, schema);
+	openTable(&rel, table);
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (j = 0; j < BENCH_LOAD_ROWS; j += BENCH_LOAD_BATCH)
+		insertRecords(&rel, batch, BENCH_LOAD_BATCH, NULL);
+	pages = ((RM_RecordMtdt *) rel.mgmtData)->pageOffset;
+	closeTable(&rel);
+	bulk = BENCH_LOAD_ROWS / benchSeconds(&t0);
+	deleteTable(table);
+
+	printf("%-22s %14s\n", "load of 1M rows", "rows/s");
+	printf("%-22s %14.0f\n", "insertRecord", single);
+	printf("%-22s %14.0f\n", "insertRecords x1000", bulk);
+	printf("%i pages, %.1fx\n", pages, bulk / single);
+
+	for (i = 0; i < BENCH_LOAD_BATCH; i++)
+		freeRecord(batch[i]);
+	free(batch);
+	shutdownRecordManager();
+}
+
+// ************************************************************
+// values compared per second: valueEquals/valueSmaller on one Value pair
+// at a time against the bitmap kernels of each level the CPU has
+#define BENCH_KERNEL_ROWS (1 << 20)
+#define BENCH_KERNEL_REPEAT 20
+
+static void
+benchKernels (void)
+{
+	int *ints = (int *) malloc(sizeof(int) * BENCH_KERNEL_ROWS);
+	float *floats = (float *) malloc(sizeof(float) * BENCH_KERNEL_ROWS);
+	uint64_t *bits = (uint64_t *) malloc(sizeof(uint64_t) * BITMAP_WORDS(BENCH_KERNEL_ROWS));
+	char *levels[] = {"scalar", "sse2", "avx2"};
+	ExprCmp cmps[] = {EXPR_CMP_EQ, EXPR_CMP_LT};
+	Value left, right, result;
+	struct timespec t0;
+	double rate[2][2][4];
+	long count = 0;
+	int i, r, t, c;
+	ExprKernelLevel level;
+
+	for (i = 0; i < BENCH_KERNEL_ROWS; i++)
+	{
+		ints[i] = rand() % 1000;
+		floats[i] = ints[i] * 0.5f;
+	}
+	memset(rate, 0, sizeof(rate));
+
+	// t 0 int, 1 float; c 0 equal, 1 smaller
+	for (t = 0; t < 2; t++)
+		for (c = 0; c < 2; c++)
+		{
+			left.dt = right.dt = t == 0 ? DT_INT : DT_FLOAT;
+			right.v.intV = 500;
+			if (t == 1)
+				right.v.floatV = 250.0f;
+			clock_gettime(CLOCK_MONOTONIC, &t0);
+			for (r = 0; r < BENCH_KERNEL_REPEAT; r++)
+				for (i = 0; i < BENCH_KERNEL_ROWS; i++)
+				{
+					if (t == 0)
+						left.v.intV = ints[i];
+					else
+						left.v.floatV = floats[i];
+					if (c == 0)
+						valueEquals(&left, &right, &result);
+					else
+						valueSmaller(&left, &right, &result);
+					count += result.v.boolV;
+				}
+			rate[t][c][0] = (double) BENCH_KERNEL_ROWS * BENCH_KERNEL_REPEAT / benchSeconds(&t0);
+
+			for (level = EXPR_KERNELS_SCALAR; level <= EXPR_KERNELS_AVX2; level++)
+			{
+				if (setExprKernels(level) != level)
+					continue;
+				clock_gettime(CLOCK_MONOTONIC, &t0);
+				for (r = 0; r < BENCH_KERNEL_REPEAT; r++)
+				{
+					if (t == 0)
+						bitmapCompareInt(cmps[c], ints, NULL, 500, BENCH_KERNEL_ROWS, bits);
+					else
+						bitmapCompareFloat(cmps[c], floats, NULL, 250.0f, BENCH_KERNEL_ROWS, bits);
+					count += bits[r] & 1;
+				}
+				rate[t][c][level + 1] = (double) BENCH_KERNEL_ROWS * BENCH_KERNEL_REPEAT / benchSeconds(&t0);
+			}
+		}
+	setExprKernels(EXPR_KERNELS_AVX2);
+
+	printf("%-10s %14s %14s %14s %14s   (M values/s)\n", "compare", "valueEquals", levels[0], levels[1], levels[2]);
+	for (t = 0; t < 2; t++)
+		for (c = 0; c < 2; c++)
+			printf("%-10s %14.0f %14.0f %14.0f %14.0f\n", t == 0 ? (c == 0 ? "int =" : "int <") : (c == 0 ? "float =" : "float <"),
+					rate[t][c][0] / 1e6, rate[t][c][1] / 1e6, rate[t][c][2] / 1e6, rate[t][c][3] / 1e6);
+	printf("kernels in use: %s (%ld)\n", levels[getExprKernels()], count);
+
+	free(ints);
+	free(floats);
+	free(bits);
+}
+
+// ************************************************************
+// rows/s of parallelScan() on a table on disk by number of workers, the
+// condition costs a little work per row like a real filter would
+#define BENCH_PARALLEL_ROWS 2000000
+#define BENCH_PARALLEL_MAX_THREADS 8
+
+typedef struct BenchCounts {
+	long count[BENCH_PARALLEL_MAX_THREADS];
+} BenchCounts;
+
+static RC
+benchCount (Record *record, int worker, void *arg)
+{
+	(void) record;
+	((BenchCounts *) arg)->count[worker] += 1;
+	return RC_OK;
+}
+
+static void
+benchParallel (void)
+{
+	char *names[] = {"a", "b", "c"};
+	DataType dt[] = {DT_INT, DT_STRING, DT_INT};
+	int sizes[] = {0, 16, 0};
+	// a repeats in every batch, the table has no key
+	int keys[] = {0};
+	char *table = "bench_parallel_table";
+	Schema *schema = createSchema(3, names, dt, sizes, 0, keys);
+	Record **batch = (Record **) malloc(sizeof(Record *) * BENCH_LOAD_BATCH);
+	Expr *cond, *range, *left, *right, *text;
+	RM_TableData rel;
+	BenchCounts counts;
+	struct timespec t0;
+	double rate, single = 0;
+	long n;
+	int i, threads;
+
+	for (i = 0; i < BENCH_LOAD_BATCH; i++)
+	{
+		createRecord(&batch[i], schema);
+		memset(batch[i]->data, 0, getRecordSize(schema));
+		memcpy(batch[i]->data, &i, sizeof(int));
+		memcpy(batch[i]->data + sizeof(int), i % 2 ? "parallel-row" : "parallel-odd", 12);
+	}
+	initRecordManager(NULL);
+	deleteTable(table);
+	createTable(table, schema);
+	// room for a pin per worker and the pages they follow
+	openTableWithFrames(&rel, table, 4 * BENCH_PARALLEL_MAX_THREADS);
+	for (i = 0; i < BENCH_PARALLEL_ROWS; i += BENCH_LOAD_BATCH)
+		insertRecords(&rel, batch, BENCH_LOAD_BATCH, NULL);
+
+	// a < 500 AND b = "parallel-row"
+	MAKE_ATTRREF(left, 0);
+	MAKE_CONS(right, stringToValue("i500"));
+	MAKE_BINOP_EXPR(range, left, right, OP_COMP_SMALLER);
+	MAKE_ATTRREF(left, 1);
+	MAKE_CONS(right, stringToValue("sparallel-row"));
+	MAKE_BINOP_EXPR(text, left, right, OP_COMP_EQUAL);
+	MAKE_BINOP_EXPR(cond, range, text, OP_BOOL_AND);
+
+	printf("%-8s %14s %10s\n", "threads", "rows/s", "speedup");
+	for (threads = 1; threads <= BENCH_PARALLEL_MAX_THREADS; threads *= 2)
+	{
+		memset(&counts, 0, sizeof(counts));
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		parallelScan(&rel, cond, threads, benchCount, &counts);
+		rate = BENCH_PARALLEL_ROWS / benchSeconds(&t0);
+		if (threads == 1)
+			single = rate;
+		for (i = 0, n = 0; i < threads; i++)
+			n += counts.count[i];
+		printf("%-8i %14.0f %9.1fx (%ld matches)\n", threads, rate, rate / single, n);
+	}
+
+	freeExpr(cond);
+	closeTable(&rel);
+	deleteTable(table);
+	for (i = 0; i < BENCH_LOAD_BATCH; i++)
+		freeRecord(batch[i]);
+	free(batch);
+	shutdownRecordManager();
+}
+
+// ************************************************************
+// rows/s of scans reading one int of a wide record, the table stored row
+// by row against PAX pages: whole records, the projected attribute with
+// next() and in batches with a compiled condition on it
+#define BENCH_LAYOUT_ROWS 500000
+
+static void
+benchLayout (void)
+{
+	// fixed length, eight attributes
+	char *names[] = {"a", "b", "c", "d", "e", "f", "g", "h"};
+	DataType dt[] = {DT_INT, DT_STRING, DT_INT, DT_FLOAT, DT_INT, DT_FLOAT, DT_INT, DT_FLOAT};
+	int sizes[] = {0, 12, 0, 0, 0, 0, 0, 0};
+	// a repeats in every batch, the table has no key
+	int keys[] = {0};
+	int layouts[] = {RM_LAYOUT_ROW, RM_LAYOUT_PAX};
+	char *table = "bench_layout_table";
+	Schema *schema = createSchema(8, names, dt, sizes, 0, keys);
+	Record **batch = (Record **) malloc(sizeof(Record *) * BENCH_LOAD_BATCH);
+	Record *r;
+	RM_Batch *columns;
+	Expr *cond, *left, *right;
+	RM_TableData rel;
+	RM_ScanHandle scan;
+	struct timespec t0;
+	double full, projected, batched;
+	long n;
+	int i, l;
+
+	for (i = 0; i < BENCH_LOAD_BATCH; i++)
+	{
+		createRecord(&batch[i], schema);
+		memset(batch[i]->data, 0, getRecordSize(schema));
+		memcpy(batch[i]->data, &i, sizeof(int));
+		memcpy(batch[i]->data + sizeof(int), "wide row", 8);
+	}
+	createRecord(&r, schema);
+	createBatch(&columns, schema, RM_BATCH_SIZE);
+	// a < 100, one row in ten
+	MAKE_ATTRREF(left, 0);
+	MAKE_CONS(right, stringToValue("i100"));
+	MAKE_BINOP_EXPR(cond, left, right, OP_COMP_SMALLER);
+	initRecordManager(NULL);
+
+	printf("%-8s %14s %14s %14s\n", "layout", "full rec/s", "scan of a", "batches of a");
+	for (l = 0; l < 2; l++)
+	{
+		deleteTable(table);
+		createTableWithLayout(table, schema, layouts[l]);
+		openTable(&rel, table);
+		for (i = 0; i < BENCH_LAYOUT_ROWS; i += BENCH_LOAD_BATCH)
+			insertRecords(&rel, batch, BENCH_LOAD_BATCH, NULL);
+
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		startScan(&rel, &scan, NULL);
+		while (next(&scan, r) == RC_OK)
+			;
+		closeScan(&scan);
+		full = BENCH_LAYOUT_ROWS / benchSeconds(&t0);
+
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		startProjectedScan(&rel, &scan, NULL, 1, keys);
+		while (next(&scan, r) == RC_OK)
+			;
+		closeScan(&scan);
+		projected = BENCH_LAYOUT_ROWS / benchSeconds(&t0);
+
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		n = 0;
+		startProjectedScan(&rel, &scan, cond, 1, keys);
+		while (nextBatch(&scan, columns) == RC_OK)
+			n += columns->numSelected;
+		closeScan(&scan);
+		batched = BENCH_LAYOUT_ROWS / benchSeconds(&t0);
+
+		printf("%-8s %14.0f %14.0f %14.0f (%ld matches, %i pages)\n", l ? "PAX" : "row",
+				full, projected, batched, n, ((RM_RecordMtdt *) rel.mgmtData)->pageOffset);
+		closeTable(&rel);
+		deleteTable(table);
+	}
+
+	freeExpr(cond);
+	freeBatch(columns, schema);
+	freeRecord(r);
+	for (i = 0; i < BENCH_LOAD_BATCH; i++)
+		freeRecord(batch[i]);
+	free(batch);
+	shutdownRecordManager();
+}
+
+// ************************************************************
+// a range query on the naturally ordered attribute of a table on disk,
+// pages read and time with the zone map against the same scan with the
+// map switched off
+#define BENCH_ZONE_ROWS 1000000
+
+static void
+benchZones (void)
+{
+	char *names[] = {"a", "b", "c"};
+	DataType dt[] = {DT_INT, DT_STRING, DT_INT};
+	int sizes[] = {0, 8, 0};
+	int keys[] = {0};
+	char *table = "bench_zone_table";
+	Schema *schema = createSchema(3, names, dt, sizes, 1, keys);
+	Record **batch = (Record **) malloc(sizeof(Record *) * BENCH_LOAD_BATCH);
+	Record *r;
+	Expr *cond, *range, *left, *right;
+	RM_TableData rel;
+	RM_ScanHandle scan;
+	RM_RecordMtdt *mgmtData;
+	struct timespec t0;
+	double seconds;
+	long n;
+	int i, j, id, zones, reads;
+
+	for (i = 0; i < BENCH_LOAD_BATCH; i++)
+	{
+		createRecord(&batch[i], schema);
+		memset(batch[i]->data, 0, getRecordSize(schema));
+		memcpy(batch[i]->data + sizeof(int), "zonemap", 7);
+	}
+	createRecord(&r, schema);
+	initRecordManager(NULL);
+	deleteTable(table);
+	createTable(table, schema);
+	openTable(&rel, table);
+	for (i = 0; i < BENCH_ZONE_ROWS; i += BENCH_LOAD_BATCH)
+	{
+		for (j = 0; j < BENCH_LOAD_BATCH; j++)
+		{
+			id = i + j;
+			memcpy(batch[j]->data, &id, sizeof(int));
+		}
+		insertRecords(&rel, batch, BENCH_LOAD_BATCH, NULL);
+	}
+	closeTable(&rel);
+
+	// the last 1% of the ids
+	MAKE_ATTRREF(left, 0);
+	MAKE_CONS(right, stringToValue("i990000"));
+	MAKE_BINOP_EXPR(range, left, right, OP_COMP_SMALLER);
+	MAKE_UNOP_EXPR(cond, range, OP_BOOL_NOT);
+
+	printf("%-8s %12s %12s %12s\n", "zone map", "ms/query", "pages read", "matches");
+	for (zones = 1; zones >= 0; zones--)
+	{
+		openTable(&rel, table);
+		mgmtData = (RM_RecordMtdt *) rel.mgmtData;
+		mgmtData->zoneReady = zones;
+		reads = getNumReadIO(mgmtData->bm);
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		n = 0;
+		startScan(&rel, &scan, cond);
+		while (next(&scan, r) == RC_OK)
+			n++;
+		closeScan(&scan);
+		seconds = benchSeconds(&t0);
+		printf("%-8s %12.2f %12i %12ld\n", zones ? "on" : "off", seconds * 1000,
+				getNumReadIO(mgmtData->bm) - reads, n);
+		mgmtData->zoneReady = TRUE;
+		closeTable(&rel);
+	}
+
+	freeExpr(cond);
+	deleteTable(table);
+	freeRecord(r);
+	for (i = 0; i < BENCH_LOAD_BATCH; i++)
+		freeRecord(batch[i]);
+	free(batch);
+	shutdownRecordManager();
+}
+
+// ************************************************************
+// lookups by key through the primary key index against a scan for the
+// key, and what keeping the index costs a load
+#define BENCH_INDEX_ROWS 200000
+#define BENCH_INDEX_PROBES 100000
+#define BENCH_INDEX_SCANS 20
+
+static void
+benchIndex (void)
+{
+	char *names[] = {"a", "b", "c"};
+	DataType dt[] = {DT_INT, DT_STRING, DT_INT};
+	int sizes[] = {0, 8, 0};
+	int keys[] = {0};
+	char *table = "bench_index_table";
+	Schema *schema;
+	Record **batch = (Record **) malloc(sizeof(Record *) * BENCH_LOAD_BATCH);
+	Record *r;
+	Value *key[1];
+	RM_TableData rel;
+	struct timespec t0;
+	double load[2], probe, scan[2];
+	long found;
+	int i, j, id, keySize, zones;
+
+	initRecordManager(NULL);
+	for (keySize = 0; keySize < 2; keySize++)
+	{
+		schema = createSchema(3, names, dt, sizes, keySize, keys);
+		for (i = 0; i < BENCH_LOAD_BATCH; i++)
+		{
+			createRecord(&batch[i], schema);
+			memset(batch[i]->data, 0, getRecordSize(schema));
+			memcpy(batch[i]->data + sizeof(int), "indexed", 7);
+		}
+		deleteTable(table);
+		createTable(table, schema);
+		openTable(&rel, table);
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		for (i = 0; i < BENCH_INDEX_ROWS; i += BENCH_LOAD_BATCH)
+		{
+			for (j = 0; j < BENCH_LOAD_BATCH; j++)
+			{
+				id = i + j;
+				memcpy(batch[j]->data, &id, sizeof(int));
+			}
+			insertRecords(&rel, batch, BENCH_LOAD_BATCH, NULL);
+		}
+		load[keySize] = BENCH_INDEX_ROWS / benchSeconds(&t0);
+		for (i = 0; i < BENCH_LOAD_BATCH; i++)
+			freeRecord(batch[i]);
+		if (keySize == 0)
+			closeTable(&rel);
+	}
+
+	createRecord(&r, rel.schema);
+	found = 0;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < BENCH_INDEX_PROBES; i++)
+	{
+		MAKE_VALUE(key[0], DT_INT, (int) (((long) i * 7919) % BENCH_INDEX_ROWS));
+		found += getRecordByKey(&rel, key, r) == RC_OK;
+		freeVal(key[0]);
+	}
+	probe = BENCH_INDEX_PROBES / benchSeconds(&t0);
+
+	// lookups without the tree, one key in the middle of every twentieth of
+	// the table; a is ordered, so the zone map alone skips most pages
+	closeIndex(&rel);
+	for (zones = 1; zones >= 0; zones--)
+	{
+		((RM_RecordMtdt *) rel.mgmtData)->zoneReady = zones;
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		for (i = 0; i < BENCH_INDEX_SCANS; i++)
+		{
+			MAKE_VALUE(key[0], DT_INT, (2 * i + 1) * (BENCH_INDEX_ROWS / (2 * BENCH_INDEX_SCANS)));
+			found += getRecordByKey(&rel, key, r) == RC_OK;
+			freeVal(key[0]);
+		}
+		scan[zones] = BENCH_INDEX_SCANS / benchSeconds(&t0);
+	}
+	((RM_RecordMtdt *) rel.mgmtData)->zoneReady = TRUE;
+
+	printf("%-22s %14s\n", "lookup by key", "lookups/s");
+	printf("%-22s %14.0f\n", "index probe", probe);
+	printf("%-22s %14.0f\n", "scan, zone map", scan[1]);
+	printf("%-22s %14.0f\n", "scan", scan[0]);
+	printf("%.0fx over a scan, %ld of %i found\n", probe / scan[0], found, BENCH_INDEX_PROBES + 2 * BENCH_INDEX_SCANS);
+	printf("load of %i rows: %.0f rows/s without a key, %.0f rows/s with its index\n",
+			BENCH_INDEX_ROWS, load[0], load[1]);
+
+	freeRecord(r);
+	closeTable(&rel);
+	deleteTable(table);
+	free(batch);
+	shutdownRecordManager();
+}
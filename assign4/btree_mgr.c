@@ -95,7 +95,6 @@ RC createBtree (char *idxId, DataType keyType, int n) {
  * @return RC 
  */
 RC openBtree (BTreeHandle **tree, char *idxId) {
-    int offset = 0;
     *tree = MAKE_TREE_HANDLE();
     BM_BufferPool *bm = MAKE_POOL();
 	BM_PageHandle *ph = MAKE_PAGE_HANDLE();
@@ -119,7 +118,30 @@ RC openBtree (BTreeHandle **tree, char *idxId) {
 }
 
 /**
- * @brief Close a Btree index file
+ * @brief frees a node and the nodes below it, with their keys and RIDs
+ * 
+ * @param node 
+ */
+void
+freeNode(BTreeNode *node) {
+    for (int i = 0; i < node->keyNums; i++) {
+        freeVal(node->keys[i]);
+        if (node->type == LEAF_NODE) {
+            free(node->ptrs[i]);
+        }
+    }
+    if (node->type == Inner_NODE) {
+        for (int i = 0; i <= node->keyNums; i++) {
+            freeNode((BTreeNode *) node->ptrs[i]);
+        }
+    }
+    free(node->keys);
+    free(node->ptrs);
+    free(node);
+}
+
+/**
+ * @brief Close a Btree index file, the nodes are freed
  * 
  * @param tree 
  * @return RC 
@@ -131,7 +153,11 @@ RC closeBtree (BTreeHandle *tree) {
     // writeStrToPage(tree->idxId, 0, header);
     // free(header);
 	shutdownBufferPool(mgmtData->bm);
+    if (mgmtData->root) {
+        freeNode(mgmtData->root);
+    }
 	free(mgmtData->ph);
+    free(mgmtData->bm);
     free(mgmtData);
     free(tree);
     return RC_OK;
@@ -190,7 +216,6 @@ RC getKeyType (BTreeHandle *tree, DataType *result) {
  * @brief   if key > sign: 1; 
  *          if key < sign: -1; 
  *          if key == sign: 0;
- *          if key != sign: -1; // bool
  * 
  * @param key 
  * @param realkey 
@@ -219,8 +244,9 @@ compareValue(Value *key, Value *sign) {
             result = strcmp(key->v.stringV, sign->v.stringV);
             break;
         case DT_BOOL:
-            // Todo: not confirm
-            result = (key->v.boolV == sign->v.boolV) ? 0 : -1;
+            // false before true
+            result = (key->v.boolV != 0) - (sign->v.boolV != 0);
+            break;
         default:
             break;
     }
@@ -274,6 +300,9 @@ findEntryInNode(BTreeNode *node, Value *key) {
  */
 RC findKey (BTreeHandle *tree, Value *key, RID *result) {
     BTreeMtdt *mgmtData = (BTreeMtdt *) tree->mgmtData;
+    if (mgmtData->root == NULL) {
+        return RC_IM_KEY_NOT_FOUND;
+    }
     // 1. Find correct leaf node L for k
     BTreeNode* leafNode = findLeafNode(mgmtData->root, key);
     if (leafNode == NULL) {
@@ -377,7 +406,7 @@ buildRID(RID *rid) {
 void 
 insertIntoLeafNode(BTreeNode* node,  Value *key, RID *rid, BTreeMtdt *mgmtData) {
     int insert_pos = getInsertPos(node, key);
-    for (int i = node->keyNums; i >= insert_pos; i--) {
+    for (int i = node->keyNums; i > insert_pos; i--) {
         node->keys[i] = node->keys[i-1];
         node->ptrs[i] = node->ptrs[i-1];
     }
@@ -399,14 +428,13 @@ splitLeafNode(BTreeNode* node, BTreeMtdt *mgmtData) {
     // split right index
     int rpoint = (node->keyNums + 1) / 2;
     for (int i = rpoint; i < node->keyNums; i++) {
-        int index = node->keyNums - rpoint - 1;
-        new_node->keys[index] = node->keys[i];
-        new_node->ptrs[index] = node->ptrs[i];
+        new_node->keys[i - rpoint] = node->keys[i];
+        new_node->ptrs[i - rpoint] = node->ptrs[i];
         node->keys[i] = NULL;
         node->ptrs[i] = NULL;
-        new_node->keyNums += 1;
-        node->keyNums -= 1;
     }
+    new_node->keyNums = node->keyNums - rpoint;
+    node->keyNums = rpoint;
     new_node->next = node->next;
     node->next = new_node;
     new_node->parent = node->parent;
@@ -426,21 +454,20 @@ splitNonLeafNode(BTreeNode* node, BTreeMtdt *mgmtData) {
     int mid = node->keyNums / 2;
     // 5, [1.2] 3 [4.5]
     // 4, [1.2] 3 [4]
-    Value *pushKey = copyKey(node->keys[mid]);
+    Value *pushKey = node->keys[mid];
 
-    int index = 0;
     for (int i = mid + 1; i < node->keyNums; i++) {
-        sibling->keys[index] = node->keys[i];
-        sibling->ptrs[index + 1] = node->ptrs[i+1];
+        sibling->keys[i - mid - 1] = node->keys[i];
         node->keys[i] = NULL;
-        node->ptrs[i+1] = NULL;
-        sibling->keyNums += 1;
-        node->keyNums -= 1;
-        index += 1;
-    }
-    sibling->ptrs[0] = node->ptrs[mid + 1];
-    node->ptrs[mid + 1] = NULL;
-    node->keyNums -= 1;// pushKey
+    }
+    // the children of the right half move with their keys
+    for (int i = mid + 1; i <= node->keyNums; i++) {
+        sibling->ptrs[i - mid - 1] = node->ptrs[i];
+        ((BTreeNode *) node->ptrs[i])->parent = sibling;
+        node->ptrs[i] = NULL;
+    }
+    sibling->keyNums = node->keyNums - mid - 1;
+    node->keyNums = mid;
     node->keys[mid] = NULL;
 
     sibling->parent = node->parent;
@@ -480,16 +507,25 @@ insertIntoParentNode(BTreeNode* lnode, Value *key, BTreeMtdt *mgmtData) {
     }
 }
 
+/**
+ * @brief copy of a key owned by the tree, strings included
+ * 
+ * @param key 
+ * @return Value* 
+ */
 Value *
 copyKey(Value *key) {
     Value *new_key = (Value *) malloc(sizeof(Value));
     memcpy(new_key, key, sizeof(*new_key));
+    if (key->dt == DT_STRING) {
+        new_key->v.stringV = strdup(key->v.stringV);
+    }
     return new_key;
 }
 
 /**
  * @brief insert key to B+Tree
- *        bottom-up strategy
+ *        bottom-up strategy, the tree stores a copy of the key
  * @param tree 
  * @param key 
  * @param rid 
@@ -507,7 +543,7 @@ RC insertKey (BTreeHandle *tree, Value *key, RID rid)  {
         return RC_IM_KEY_ALREADY_EXISTS;
     }
     // 2. Add new entry into L in sorted order
-    insertIntoLeafNode(leafNode, key, &rid, mgmtData);
+    insertIntoLeafNode(leafNode, copyKey(key), &rid, mgmtData);
     // If L has enough space, the operation done
     if (leafNode->keyNums <= mgmtData->n) {
         return RC_OK;
@@ -524,7 +560,7 @@ RC insertKey (BTreeHandle *tree, Value *key, RID rid)  {
 }
 
 /**
- * @brief delete from leaf node
+ * @brief delete from leaf node, the key and RID of the entry are freed
  * 
  * @param node 
  * @param key 
@@ -533,7 +569,9 @@ RC insertKey (BTreeHandle *tree, Value *key, RID rid)  {
 void
 deleteFromLeafNode(BTreeNode *node, Value *key, BTreeMtdt *mgmtData) {
     int insert_pos = getInsertPos(node, key);
-    for (int i = insert_pos; i < node->keyNums; i++) {
+    freeVal(node->keys[insert_pos]);
+    free(node->ptrs[insert_pos]);
+    for (int i = insert_pos; i < node->keyNums - 1; i++) {
         node->keys[i] = node->keys[i+1];
         node->ptrs[i] = node->ptrs[i+1];
     }
@@ -541,220 +579,20 @@ deleteFromLeafNode(BTreeNode *node, Value *key, BTreeMtdt *mgmtData) {
     mgmtData->entries -= 1;
 }
 
-/**
- * @brief checks for enough space
- * 
- * @param keyNums 
- * @param node 
- * @param mgmtData 
- * @return true 
- * @return false 
- */
-bool
-isEnoughSpace(int keyNums, BTreeNode *node, BTreeMtdt *mgmtData) {
-    int min = node->type == LEAF_NODE ? mgmtData->minLeaf : mgmtData->minNonLeaf;
-    if (keyNums >= mgmtData->minLeaf && keyNums <= mgmtData->n) {
-        return true;
-    }
-    return false;
-}
-
-/**
- * @brief Deletes the parent entry
- * 
- * @param node  
- */
-void deleteParentEntry(BTreeNode *node) {
-    BTreeNode *parent = node->parent;
-    for (int i = 0; i <= parent->keyNums; i++) {
-        if (parent->ptrs[i] == node) {
-            int keyIndex = i-1 < 0 ? 0 : i-1;
-            parent->keys[keyIndex] = NULL;
-            parent->ptrs[i] = NULL;
-            for (int j = keyIndex; j < parent->keyNums - 1; j++) {
-                parent->keys[j] = parent->keys[j+1];
-            }
-            for (int j = i; j < parent->keyNums; j++) {
-                parent->ptrs[j] = parent->ptrs[j+1];
-            }
-            parent->keyNums -= 1;
-            break;
-        }
-    }
-}
-/**
- * @brief Updates parent entry
- * 
- * @param node Inner_Node
- * @param key 
- * @param newkey 
- */
-void
-updateParentEntry(BTreeNode *node, Value *key, Value *newkey) {
-    // equal = no update
-    if (compareValue(key, newkey) == 0) {
-        return;
-    }
-    
-    bool isDelete = false;
-    BTreeNode *parent = node->parent;
-    // 1. delete key
-    for (int i = 0; i < parent->keyNums; i++) {
-        if (compareValue(key, parent->keys[i]) == 0) {
-            for (int j = i; j < parent->keyNums - 1; j++) {
-                parent->keys[j] = parent->keys[j+1];
-            }
-            parent->keys[parent->keyNums - 1] = NULL;
-            parent->keyNums -= 1;
-            isDelete = true;
-            break;
-        }
-    }
-    if (isDelete == false) {
-        return;
-    }
-    // 2. add new key
-    int insert_pos = getInsertPos(parent, newkey);
-    for (int i = parent->keyNums; i >= insert_pos; i--) {
-        parent->keys[i] = parent->keys[i-1];
-    }
-    parent->keys[insert_pos] = newkey;
-    parent->keyNums += 1;
-}
-
-
-
-/**
- * @brief try to redistribute borrow key from sibling
- * 
- * @param node 
- * @param key 
- * @param mgmtData 
- * @return true 
- * @return false 
- */
-bool
-redistributeFromSibling(BTreeNode *node, Value *key, BTreeMtdt *mgmtData) {
-    BTreeNode *parent = node->parent;
-    BTreeNode *sibling = NULL;
-    int index;
-    
-    for (int i = 0; i <= parent->keyNums; i++) {
-        if (parent->ptrs[i] != node) {
-            continue;
-        }
-        // perfer left sibling
-        sibling = (BTreeNode *) parent->ptrs[i-1];
-        if (sibling && isEnoughSpace(sibling->keyNums - 1, sibling, mgmtData) == true) {
-            index = sibling->keyNums - 1;
-            break;
-        }
-        sibling = (BTreeNode *) parent->ptrs[i+1];
-        if (sibling && isEnoughSpace(sibling->keyNums - 1, sibling, mgmtData) == true) {
-            index = 0;
-            break;
-        }
-        sibling = NULL;
-        break;
-    }
-    if (sibling) {
-        insertIntoLeafNode(node, copyKey(sibling->keys[index]), sibling->ptrs[index], mgmtData);
-        updateParentEntry(node, key, copyKey(sibling->keys[index]));
-        sibling->keyNums -= 1;
-        free(sibling->keys[index]);
-        free(sibling->ptrs[index + 1]);
-        sibling->keys[index] = NULL;
-        sibling->ptrs[index + 1] = NULL;
-        return true;
-    }
-    // redistribute fail
-    return false;
-}
-
-/**
- * @brief Checks capacity of sibling
- * 
- * @param node 
- * @param mgmtData 
- * @return BTreeNode* 
- */
-BTreeNode *
-checkSiblingCapacity(BTreeNode *node, BTreeMtdt *mgmtData) {
-    BTreeNode *sibling = NULL;
-    BTreeNode * parent = node->parent;
-    for (int i = 0; i <= parent->keyNums; i++) {
-        if (parent->ptrs[i] != node) {
-            continue;
-        }
-        if (i - 1 >= 0) {
-            // perfer left sibling
-            sibling = (BTreeNode *) parent->ptrs[i-1];
-            if (isEnoughSpace(sibling->keyNums + node->keyNums, sibling, mgmtData) == true) {
-                break;
-            }
-        }
-        if (i + 1 <= parent->keyNums + 1) {
-            sibling = (BTreeNode *) parent->ptrs[i+1];
-            if (isEnoughSpace(sibling->keyNums + node->keyNums, sibling, mgmtData) == true) {
-                break;
-            }
-        }
-        sibling = NULL;
-        break;
-    }
-    return sibling;
-}
-
-/**
- * @brief Merges siblings
- * 
- * @param node 
- * @param sibling 
- * @param mgmtData 
- */
-void
-mergeSibling(BTreeNode *node, BTreeNode *sibling, BTreeMtdt *mgmtData) {
-    BTreeNode *parent = node->parent;
-    
-    int key_count = sibling->keyNums + node->keyNums; 
-    if (key_count > sibling->keyNums) {
-        int i = 0, j = 0, curr = 0;
-        Value **newkeys = malloc((key_count) * sizeof(Value *));
-        void **newptrs = malloc((key_count + 1) * sizeof(void *));
-        for (curr = 0; curr < key_count; curr++) {
-            if (j >= node->keyNums || compareValue(sibling->keys[i], node->keys[j]) <= 0) {
-                newkeys[curr] = sibling->keys[i];
-                newptrs[curr] = sibling->ptrs[i];
-                i += 1;
-            } else {
-                newkeys[curr] = sibling->keys[j];
-                newptrs[curr] = sibling->ptrs[j];
-            }
-        }
-        free(sibling->keys);
-        free(sibling->ptrs);
-        sibling->keys = newkeys;
-        sibling->ptrs = newptrs;
-    }
-    // update parent
-    deleteParentEntry(node);
-    mgmtData->nodes -= 1;
-    free(node->ptrs);
-    free(node->keys);
-    free(node);
-    // Todo: recurisve
-    if (sibling->keyNums < mgmtData->minNonLeaf) {}
-}
-
 /**
  * @brief delete key
- * 
+ *        the entry leaves its leaf, leaves are not merged or refilled: the
+ *        keys of inner nodes still route every search to the right leaf,
+ *        and inserts fill the leaf again
  * @param tree 
  * @param key 
  * @return RC 
  */
 RC deleteKey (BTreeHandle *tree, Value *key) {
     BTreeMtdt *mgmtData = (BTreeMtdt *) tree->mgmtData;
+    if (mgmtData->root == NULL) {
+        return RC_IM_KEY_NOT_FOUND;
+    }
     // 1. Find correct leaf node L for k
     BTreeNode* leafNode = findLeafNode(mgmtData->root, key);
     // check: key not in tree
@@ -763,22 +601,27 @@ RC deleteKey (BTreeHandle *tree, Value *key) {
     }
     // 2.Remove the entry
     deleteFromLeafNode(leafNode, key, mgmtData);
-    // If L is at least half full, the operation is done
-    if (leafNode->keyNums >= mgmtData->minLeaf) {
-        Value *newkey = copyKey(leafNode->keys[0]);
-        updateParentEntry(leafNode, key, newkey);
-        return RC_OK;
+    return RC_OK;
+}
+
+/**
+ * @brief points a key at another record
+ * 
+ * @param tree 
+ * @param key 
+ * @param rid 
+ * @return RC RC_IM_KEY_NOT_FOUND if the key is not in the tree
+ */
+RC updateKey (BTreeHandle *tree, Value *key, RID rid) {
+    BTreeMtdt *mgmtData = (BTreeMtdt *) tree->mgmtData;
+    if (mgmtData->root == NULL) {
+        return RC_IM_KEY_NOT_FOUND;
     }
-    // Otherwise
-    // try to redistribute, borrowing from sibling
-    // if redistribution fails, merge L and sibling.
-    // if merge occured, delete entry in parent pointing to L.
-    BTreeNode *sibling = checkSiblingCapacity(leafNode, mgmtData);
-    if (sibling) {
-        mergeSibling(leafNode, sibling, mgmtData);
-    } else {
-        redistributeFromSibling(leafNode, key, mgmtData);
+    RID *r = findEntryInNode(findLeafNode(mgmtData->root, key), key);
+    if (r == NULL) {
+        return RC_IM_KEY_NOT_FOUND;
     }
+    (*r) = rid;
     return RC_OK;
 }
 
@@ -822,7 +665,7 @@ RC nextEntry (BT_ScanHandle *handle, RID *result) {
     int keyIndex = scanMtdt->keyIndex;
 
     if (keyIndex < node->keyNums) {
-        rid = buildRID((RID *) node->ptrs[keyIndex]);
+        rid = (RID *) node->ptrs[keyIndex];
         scanMtdt->keyIndex += 1;
     } else {
         if (node->next == NULL) {
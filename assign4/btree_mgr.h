@@ -89,6 +89,7 @@ extern RC getKeyType (BTreeHandle *tree, DataType *result);
 extern RC findKey (BTreeHandle *tree, Value *key, RID *result);
 extern RC insertKey (BTreeHandle *tree, Value *key, RID rid);
 extern RC deleteKey (BTreeHandle *tree, Value *key);
+extern RC updateKey (BTreeHandle *tree, Value *key, RID rid);
 extern RC openTreeScan (BTreeHandle *tree, BT_ScanHandle **handle);
 extern RC nextEntry (BT_ScanHandle *handle, RID *result);
 extern RC closeTreeScan (BT_ScanHandle *handle);
@@ -97,6 +98,7 @@ extern RC closeTreeScan (BT_ScanHandle *handle);
 extern void insertIntoParentNode(BTreeNode*, Value *, BTreeMtdt *);
 extern RID* buildRID(RID *);
 extern Value *copyKey(Value *); 
+extern void freeNode(BTreeNode *);
 
 // debug and test functions
 extern char *printTree (BTreeHandle *tree);
@@ -1,6 +1,12 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <pthread.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/time.h>
 #include "storage_mgr.h"
 #include "buffer_mgr.h"
@@ -42,13 +48,13 @@ long getTimeStamp() {
  * @author Yun Zi
  */
 void *traverseFrameList(BM_FrameList *frameList, BM_MgmtData *mgmt, RC (*callback)(BM_Frame*, BM_MgmtData*)) {
-    BM_Frame *curr = frameList->head;
-    while (curr) {
+    int i;
+    for (i = 0; i < frameList->size; i++) {
+        BM_Frame *curr = &frameList->frames[i];
         int status = callback(curr, mgmt);
         if (status == RC_RETURN) {
             return curr;
         }
-        curr = curr->next;
     }
     return NULL;
 }
@@ -56,49 +62,90 @@ void *traverseFrameList(BM_FrameList *frameList, BM_MgmtData *mgmt, RC (*callbac
 /**
  * @brief sets default values for a frame
  * 
+ * @param frameList
+ * @param frameNum
  * @return BM_Frame 
  * @author Yun Zi
  */
-BM_Frame *initFrame(int frameNum) {
-    BM_Frame *frame = MAKE_FRAME();
+BM_Frame *initFrame(BM_FrameList *frameList, int frameNum) {
+    BM_Frame *frame = &frameList->frames[frameNum];
     frame->dirtyflag = FALSE;
+    frame->pointer = FALSE;
     frame->fixCount = 0;
-    frame->refCount = 0;
-    frame->timestamp = 0;
-    frame->data = NULL;
     frame->frameNum = frameNum;
     frame->pageNum = NO_PAGE;
-    frame->next = NULL;
-    frame->prev = NULL;
+    frameList->refCount[frameNum] = 0;
+    frameList->timestamp[frameNum] = 0;
     return frame;
 }
 
 /**
- * @brief destroys frame list
+ * @brief destroys frame list, the arena is freed if the list owns it
  * 
  * @param frameList
  * @return void 
  * @author Yun Zi
  */
 void destoryFrameList(BM_FrameList *frameList) {
-  
-    if(frameList->head != NULL){
-        BM_Frame *curr = frameList->head;
-        BM_Frame *next = NULL;
-        while (curr) {
-            next = curr ->next;
-            free(curr);
-            curr = next;
-        }
-    }
-   
-    frameList->head = frameList->tail = NULL;
+    if (frameList->arena) {
+        free(frameList->arena);
+    }
+    frameList->arena = NULL;
+    frameList->frames = NULL;
     free(frameList);
-    frameList = NULL;
+}
+
+/**
+ * @brief rounds size up to a multiple of align
+ * 
+ * @param size
+ * @param align
+ * @return size_t 
+ */
+static size_t alignSize(size_t size, size_t align) {
+    return (size + align - 1) / align * align;
+}
+
+/**
+ * @brief computes where each part of the frame arena starts
+ * @details shared state | descriptors | timestamps | ref counts | pages
+ * 
+ * @param num
+ * @param offsets the 4 offsets after the shared state
+ * @return size_t size of the whole arena
+ */
+static size_t frameArenaLayout(int num, size_t *offsets) {
+    offsets[0] = alignSize(sizeof(BM_PoolShared), BM_CACHE_LINE);
+    offsets[1] = offsets[0] + alignSize(num * sizeof(BM_Frame), BM_CACHE_LINE);
+    offsets[2] = offsets[1] + alignSize(num * sizeof(long), BM_CACHE_LINE);
+    offsets[3] = alignSize(offsets[2] + num * sizeof(int), PAGE_SIZE);
+    return offsets[3] + (size_t)num * PAGE_SIZE;
+}
+
+/**
+ * @brief builds a frame list over an arena laid out by frameArenaLayout,
+ *        the frames themselves are left as they are
+ * 
+ * @param arena
+ * @param num
+ * @return BM_FrameList 
+ */
+static BM_FrameList *mapFrameList(char *arena, int num) {
+    size_t offsets[4];
+    frameArenaLayout(num, offsets);
+    BM_FrameList *frameList = MAKE_FRAME_LIST();
+    frameList->size = num;
+    frameList->arena = NULL;
+    frameList->frames = (BM_Frame *) (arena + offsets[0]);
+    frameList->timestamp = (long *) (arena + offsets[1]);
+    frameList->refCount = (int *) (arena + offsets[2]);
+    frameList->pages = arena + offsets[3];
+    return frameList;
 }
 
 /**
  * @brief sets frames in frame list
+ * @details one aligned allocation holding the pool state, the frames and the pages
  * 
  * @param num
  * @return BM_FrameList 
@@ -106,18 +153,59 @@ void destoryFrameList(BM_FrameList *frameList) {
  */
 BM_FrameList *initFrameList(int num) {
     int i;
-    BM_Frame *curr;
-    BM_FrameList *frameList = MAKE_FRAME_LIST();
-    frameList->head = curr = frameList->tail = initFrame(0);
+    size_t offsets[4];
+    char *arena = NULL;
 
-    for (i = 1; i < num; i++) {
-        curr->next = initFrame(i);
-        curr->next->prev = curr;
-        frameList->tail = curr = curr->next;
+    if (posix_memalign((void **)&arena, PAGE_SIZE, frameArenaLayout(num, offsets)) != 0) {
+        return NULL;
+    }
+    memset(arena, 0, sizeof(BM_PoolShared));
+    BM_FrameList *frameList = mapFrameList(arena, num);
+    frameList->arena = arena;
+    for (i = 0; i < num; i++) {
+        initFrame(frameList, i);
     }
     return frameList;
 }
 
+/**
+ * @brief takes the lock of a pool's shared state, a lock left behind by a
+ *        crashed process of a shared pool is taken over
+ * 
+ * @param shared
+ * @return void 
+ */
+static void lockShared(BM_PoolShared *shared) {
+    int rc = pthread_mutex_lock(&shared->mutexlock);
+#ifdef __linux__
+    if (rc == EOWNERDEAD) {
+        pthread_mutex_consistent(&shared->mutexlock);
+    }
+#else
+    (void) rc;
+#endif
+}
+
+/**
+ * @brief takes the pool lock
+ * 
+ * @param mgmt
+ * @return void 
+ */
+void lockPool(BM_MgmtData *mgmt) {
+    lockShared(mgmt->shared);
+}
+
+/**
+ * @brief releases the pool lock
+ * 
+ * @param mgmt
+ * @return void 
+ */
+void unlockPool(BM_MgmtData *mgmt) {
+    pthread_mutex_unlock(&mgmt->shared->mutexlock);
+}
+
 // Buffer Manager Interface Pool Handling
 /**
  * @brief creates a new buffer pool with page frames using the page replacement strategy
@@ -147,17 +235,174 @@ RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName,
         return pageStatus;
     }
     mgmt->frameList = initFrameList(numPages);
-    mgmt->readCount = 0;
-    mgmt->writeCount = 0;
+    if (!mgmt->frameList) {
+        closePageFile(mgmt->fh);
+        free(mgmt->fh);
+        free(mgmt);
+        return RC_FAIL;
+    }
+    mgmt->shared = (BM_PoolShared *) mgmt->frameList->arena;
+    mgmt->shared->numPages = numPages;
+    pthread_mutex_init(&(mgmt->shared->mutexlock), NULL);
+    mgmt->tier = NULL;
+    mgmt->shmName = NULL;
+    mgmt->shmBase = NULL;
+    mgmt->shmSize = 0;
     mgmt->totalSize = numPages;
     if (strategy == RS_LRU_K) {
         mgmt->k = stratData ? *((int*)stratData) : 1;
     }
-    pthread_mutex_init(&(mgmt->mutexlock), NULL);
     bm->mgmtData = mgmt;
     return RC_OK;
 }
 
+/**
+ * @brief waits until a value set by another process shows up
+ * 
+ * @param done
+ * @param arg
+ * @return bool FALSE after about 5 seconds
+ */
+static bool waitForCreator(bool (*done)(void *), void *arg) {
+    int i;
+    for (i = 0; i < 5000; i++) {
+        if (done(arg)) {
+            return TRUE;
+        }
+        usleep(1000);
+    }
+    return FALSE;
+}
+
+static bool shmHasSize(void *arg) {
+    struct stat st;
+    return fstat(*(int *)arg, &st) == 0 && st.st_size > 0;
+}
+
+static bool shmIsReady(void *arg) {
+    return __atomic_load_n(&((BM_PoolShared *)arg)->ready, __ATOMIC_ACQUIRE) == 1;
+}
+
+/**
+ * @brief creates a buffer pool in the POSIX shared memory segment shmName,
+ *        or attaches to it when another process created it already; the
+ *        frames, the page memory and the pool lock are shared between
+ *        all processes using the same shmName
+ * 
+ * @param bm
+ * @param pageFileName
+ * @param numPages must match the pool the segment was created for
+ * @param strategy
+ * @param stratData
+ * @param shmName name of the segment, e.g. "/orders_pool"
+ * @return RC 
+ */
+RC initBufferPoolShared(BM_BufferPool *const bm, const char *const pageFileName, 
+		const int numPages, ReplacementStrategy strategy,
+		void *stratData, const char *const shmName) {
+    size_t offsets[4];
+    size_t size = frameArenaLayout(numPages, offsets);
+    bool creator = TRUE;
+    struct stat st;
+    int i;
+
+    if (!shmName || strlen(pageFileName) >= BM_SHM_FILE_MAX || numPages <= 0) {
+        return RC_FAIL;
+    }
+    int fd = shm_open(shmName, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0 && errno == EEXIST) {
+        creator = FALSE;
+        fd = shm_open(shmName, O_RDWR, 0600);
+    }
+    if (fd < 0) {
+        return RC_FAIL;
+    }
+    if (creator && ftruncate(fd, size) != 0) {
+        close(fd);
+        shm_unlink(shmName);
+        return RC_FAIL;
+    }
+    if (!creator && (!waitForCreator(shmHasSize, &fd) || fstat(fd, &st) != 0 || (size_t)st.st_size != size)) {
+        close(fd);
+        return RC_FAIL;
+    }
+    char *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        if (creator) {
+            shm_unlink(shmName);
+        }
+        return RC_FAIL;
+    }
+    BM_PoolShared *shared = (BM_PoolShared *) base;
+    BM_FrameList *frameList = mapFrameList(base, numPages);
+
+    // every process has its own handle on the page file, a pool is neither
+    // published nor joined without one
+    SM_FileHandle *fh = MAKE_FH_HANDLE();
+    RC pageStatus = openPageFile((char *)pageFileName, fh);
+    if (pageStatus != RC_OK) {
+        free(fh);
+        destoryFrameList(frameList);
+        munmap(base, size);
+        if (creator) {
+            shm_unlink(shmName);
+        }
+        return pageStatus;
+    }
+
+    if (creator) {
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+#ifdef __linux__
+        pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+#endif
+        pthread_mutex_init(&shared->mutexlock, &attr);
+        pthread_mutexattr_destroy(&attr);
+        shared->numPages = numPages;
+        shared->attached = 1;
+        strcpy(shared->pageFile, pageFileName);
+        for (i = 0; i < numPages; i++) {
+            initFrame(frameList, i);
+        }
+        __atomic_store_n(&shared->ready, 1, __ATOMIC_RELEASE);
+    } else {
+        bool match = FALSE;
+        if (waitForCreator(shmIsReady, shared)) {
+            lockShared(shared);
+            match = shared->numPages == numPages && strcmp(shared->pageFile, pageFileName) == 0;
+            if (match) {
+                shared->attached += 1;
+            }
+            pthread_mutex_unlock(&shared->mutexlock);
+        }
+        if (!match) {
+            closePageFile(fh);
+            free(fh);
+            destoryFrameList(frameList);
+            munmap(base, size);
+            return RC_FAIL;
+        }
+    }
+
+    BM_MgmtData * mgmt = MAKE_MGMT_DATA();
+    mgmt->shared = shared;
+    mgmt->frameList = frameList;
+    mgmt->shmName = strdup(shmName);
+    mgmt->shmBase = base;
+    mgmt->shmSize = size;
+    mgmt->tier = NULL;
+    mgmt->totalSize = numPages;
+    mgmt->k = (strategy == RS_LRU_K && stratData) ? *((int*)stratData) : 1;
+    bm->pageFile = (char *)pageFileName;
+    bm->numPages = numPages;
+    bm->strategy = strategy;
+    bm->mgmtData = mgmt;
+    mgmt->fh = fh;
+    return RC_OK;
+}
+
 /**
  * @brief destroys a buffer pool
  * 
@@ -170,58 +415,139 @@ RC shutdownBufferPool(BM_BufferPool *const bm) {
     if (!mgmt) {
         return RC_FAIL;
     }
-    BM_Frame *curr = mgmt->frameList->head;
-    while (curr) {
-        curr->fixCount = 0;
-        curr = curr->next;
+    int i;
+    bool last = TRUE;
+    if (mgmt->shmBase) {
+        // pages pinned by other processes stay, the last one out flushes everything
+        forceFlushPool(bm);
+        lockPool(mgmt);
+        mgmt->shared->attached -= 1;
+        last = (mgmt->shared->attached == 0);
+        unlockPool(mgmt);
+    }
+    if (last) {
+        for (i = 0; i < mgmt->frameList->size; i++) {
+            mgmt->frameList->frames[i].fixCount = 0;
+        }
+        forceFlushPool(bm);
+        pthread_mutex_destroy(&mgmt->shared->mutexlock);
     }
-    forceFlushPool(bm);
-    // free memory in linkedlist
+    // free the frame arena
     destoryFrameList(mgmt->frameList);
+    if (mgmt->tier) {
+        destroyCompressedTier(mgmt->tier);
+        mgmt->tier = NULL;
+    }
+    if (mgmt->shmBase) {
+        munmap(mgmt->shmBase, mgmt->shmSize);
+        if (last) {
+            shm_unlink(mgmt->shmName);
+        }
+        free(mgmt->shmName);
+    }
     closePageFile (mgmt->fh);
     free(mgmt->fh);
-    free(mgmt);
     mgmt->fh = NULL;
     mgmt->frameList = NULL;
+    free(mgmt);
     bm->mgmtData = NULL;
     bm->numPages = 0;
     return RC_OK;
 }
 
 /**
- * @brief force write to single frame
+ * @brief gets the frame requested by its page number
+ * 
+ * @param frameList
+ * @param pageNum
+ * @return BM_Frame 
+ * @author Yun Zi
+ */
+BM_Frame *getFrameByNum(BM_FrameList *frameList,PageNumber pageNum) {
+    BM_Frame *curr = frameList->frames;
+    BM_Frame *end = curr + frameList->size;
+    for (; curr < end; curr++) {
+        if (pageNum == curr->pageNum) {
+            return curr;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief orders frames by page number
+ */
+static int compareFramePage(const void *a, const void *b) {
+    PageNumber pa = (*(BM_Frame * const *)a)->pageNum;
+    PageNumber pb = (*(BM_Frame * const *)b)->pageNum;
+    return (pa > pb) - (pa < pb);
+}
+
+/**
+ * @brief writes frames back to disk in page order, adjacent pages go out
+ *        as one vectored write; caller holds the pool lock
+ * 
+ * @param mgmt
+ * @param frames reordered by page number
+ * @param n
+ * @return void 
+ */
+void writeFrameRuns(BM_MgmtData *mgmt, BM_Frame **frames, int n) {
+    SM_PageHandle data[BM_MAX_WRITE_RUN];
+    int start = 0, i;
+    qsort(frames, n, sizeof(BM_Frame *), compareFramePage);
+    while (start < n) {
+        int len = 1;
+        while (start + len < n && len < BM_MAX_WRITE_RUN
+                && frames[start + len]->pageNum == frames[start]->pageNum + len) {
+            len += 1;
+        }
+        for (i = 0; i < len; i++) {
+            data[i] = FRAME_DATA(mgmt->frameList, frames[start + i]);
+        }
+        if (writeBlocks(frames[start]->pageNum, len, mgmt->fh, data) != RC_OK) {
+            // a run the backend refused is retried page by page
+            for (i = 0; i < len; i++) {
+                writeBlock(frames[start + i]->pageNum, mgmt->fh, data[i]);
+            }
+        }
+        for (i = 0; i < len; i++) {
+            frames[start + i]->dirtyflag = FALSE;
+        }
+        mgmt->shared->writeCount += len;
+        mgmt->shared->writeRuns += 1;
+        start += len;
+    }
+}
+
+/**
+ * @brief writes the frame back to disk, caller holds the pool lock
  * 
  * @param frame
  * @param mgmt
  * @return void 
- * @author Yun Zi
  */
-void forceWriteSingle(BM_Frame * frame, BM_MgmtData *mgmt) {
-    pthread_mutex_lock(&mgmt->mutexlock);
-    writeBlock(frame->pageNum, mgmt->fh, frame->data);
-    frame->dirtyflag = FALSE;
-    mgmt->writeCount += 1;
-    pthread_mutex_unlock(&mgmt->mutexlock);
+void writeFrameBack(BM_Frame * frame, BM_MgmtData *mgmt) {
+    writeFrameRuns(mgmt, &frame, 1);
 }
 
 /**
- * @brief force flush of buffer pool
+ * @brief force write to single frame
  * 
  * @param frame
  * @param mgmt
- * @return int
+ * @return void 
  * @author Yun Zi
  */
-int forceFlushSingle(BM_Frame * frame, BM_MgmtData *mgmt) {
-    if (frame->fixCount == 0 && frame->dirtyflag) {
-        forceWriteSingle(frame, mgmt);
-    }
-    return 0;
+void forceWriteSingle(BM_Frame * frame, BM_MgmtData *mgmt) {
+    lockPool(mgmt);
+    writeFrameBack(frame, mgmt);
+    unlockPool(mgmt);
 }
 
 /**
  * @brief causes all dirty pages with fix count 0 from the buffer pool to be written to disk
- * 
+ * @details the pages are written in page order, adjacent pages as one run
  * @param bm
  * @return RC 
  * @author Yun Zi
@@ -231,27 +557,58 @@ RC forceFlushPool(BM_BufferPool *const bm) {
     if (!mgmt) {
         return RC_FAIL;
     }
-    traverseFrameList(mgmt->frameList, mgmt, forceFlushSingle);
-    return RC_OK;
+    BM_FrameList *frameList = mgmt->frameList;
+    BM_Frame **dirty = (BM_Frame **) malloc(frameList->size * sizeof(BM_Frame *));
+    int n = 0, i;
+    lockPool(mgmt);
+    for (i = 0; i < frameList->size; i++) {
+        BM_Frame *frame = &frameList->frames[i];
+        if (frame->fixCount == 0 && frame->dirtyflag) {
+            dirty[n++] = frame;
+        }
+    }
+    writeFrameRuns(mgmt, dirty, n);
+    unlockPool(mgmt);
+    free(dirty);
+    return syncPageFile(mgmt->fh);
 }
 
 /**
- * @brief gets the frame requested by its page number
- * 
- * @param frameList
- * @param pageNum
- * @return BM_Frame 
- * @author Yun Zi
+ * @brief writes pages the caller built straight to the page file
+ * @details for bulk loads: the pages go out as one vectored write without
+ *          taking frames, a frame already holding one of them takes the new
+ *          content and a copy in the compressed tier is dropped
+ * @param bm
+ * @param startPage at most one past the end of the file
+ * @param numPages
+ * @param pages
+ * @return RC 
  */
-BM_Frame *getFrameByNum(BM_FrameList *frameList,PageNumber pageNum) {
-    BM_Frame *curr = frameList->head;
-    while (curr) {
-        if (pageNum == curr->pageNum) {
-            return curr;
+RC writePagesDirect (BM_BufferPool *const bm, PageNumber startPage, int numPages, char **pages) {
+    BM_MgmtData * mgmt = (BM_MgmtData*)bm->mgmtData;
+    RC result;
+    int i;
+    if (!mgmt) {
+        return RC_FAIL;
+    }
+    lockPool(mgmt);
+    for (i = 0; i < numPages; i++) {
+        BM_Frame *frame = getFrameByNum(mgmt->frameList, startPage + i);
+        if (frame) {
+            memcpy(FRAME_DATA(mgmt->frameList, frame), pages[i], PAGE_SIZE);
+            frame->dirtyflag = FALSE;
+        }
+        if (mgmt->tier) {
+            tierInvalidate(mgmt->tier, startPage + i);
         }
-        curr = curr->next;
     }
-    return NULL;
+    result = writeBlocks(startPage, numPages, mgmt->fh, pages);
+    if (result == RC_OK) {
+        mgmt->shared->writeCount += numPages;
+        mgmt->shared->writeRuns += 1;
+    }
+    unlockPool(mgmt);
+    return result;
 }
 
 // Buffer Manager Interface Access Pages
@@ -265,12 +622,14 @@ BM_Frame *getFrameByNum(BM_FrameList *frameList,PageNumber pageNum) {
  */
 RC markDirty (BM_BufferPool *const bm, BM_PageHandle *const page) {
     BM_MgmtData * mgmt = (BM_MgmtData*)bm->mgmtData;
+    // the frame lookup reads the page table other pins change
+    lockPool(mgmt);
     BM_Frame *curr = getFrameByNum(mgmt->frameList, page->pageNum);
-    if (!curr) {
-        return RC_FAIL;
+    if (curr) {
+        curr->dirtyflag = TRUE;
     }
-    curr->dirtyflag = TRUE;
-    return RC_OK;    
+    unlockPool(mgmt);
+    return curr ? RC_OK : RC_FAIL;
 }
 
 /**
@@ -283,12 +642,38 @@ RC markDirty (BM_BufferPool *const bm, BM_PageHandle *const page) {
  */
 RC unpinPage (BM_BufferPool *const bm, BM_PageHandle *const page) {
     BM_MgmtData * mgmt = (BM_MgmtData*)bm->mgmtData;
+    lockPool(mgmt);
     BM_Frame *curr = getFrameByNum(mgmt->frameList, page->pageNum);
-    if (!curr) {
-        return RC_FAIL;
+    if (curr) {
+        curr->fixCount -= 1;
     }
-    curr->fixCount -= 1;
-    return RC_OK;
+    unlockPool(mgmt);
+    return curr ? RC_OK : RC_FAIL;
+}
+
+/**
+ * @brief unpins n pages under a single lock
+ * 
+ * @param bm
+ * @param handles
+ * @param n
+ * @return RC RC_FAIL if one of the pages is not in the pool
+ */
+RC unpinPages (BM_BufferPool *const bm, BM_PageHandle *const handles, int n) {
+    BM_MgmtData * mgmt = (BM_MgmtData*)bm->mgmtData;
+    RC result = RC_OK;
+    int i;
+    lockPool(mgmt);
+    for (i = 0; i < n; i++) {
+        BM_Frame *curr = getFrameByNum(mgmt->frameList, handles[i].pageNum);
+        if (!curr) {
+            result = RC_FAIL;
+            continue;
+        }
+        curr->fixCount -= 1;
+    }
+    unlockPool(mgmt);
+    return result;
 }
 
 /**
@@ -308,7 +693,8 @@ RC forcePage (BM_BufferPool *const bm, BM_PageHandle *const page) {
     if (frame) {
         forceWriteSingle(frame, mgmt);
     }
-    return RC_OK;
+    // outside the pool lock, so concurrent committers can share a sync
+    return syncPageFile(mgmt->fh);
 }
 
 /**
@@ -331,37 +717,114 @@ RC getAndCheckEmptyPage(BM_Frame *frame, BM_MgmtData *mgmt) {
  * 
  * @param bm
  * @param pageNum
- * @return BM_PINPAGE 
+ * @param bm_pinpage filled with the frame and how it was found
+ * @return RC RC_FAIL if every frame is pinned
  * @author Yun Zi
  */
-BM_PINPAGE* pinFindFrame(BM_BufferPool *const bm,PageNumber pageNum) {
+RC pinFindFrame(BM_BufferPool *const bm,PageNumber pageNum, BM_PINPAGE *bm_pinpage) {
     BM_MgmtData * mgmt = (BM_MgmtData*)bm->mgmtData;
     BM_Frame *frame = NULL;
-    BM_PINPAGE *bm_pinpage = (BM_PINPAGE *) malloc(sizeof(BM_PINPAGE));
     // find pageNum frame
     frame = getFrameByNum(mgmt->frameList, pageNum);
     if (frame) {
         bm_pinpage->status = PIN_EXIST;
         bm_pinpage->frame = frame;
-        return bm_pinpage;
+        return RC_OK;
     }
     // find empty frame
     frame = (BM_Frame *)traverseFrameList(mgmt->frameList, mgmt, getAndCheckEmptyPage);
     if (frame) {
         bm_pinpage->status = PIN_EMPTY;
         bm_pinpage->frame = frame;
-        return bm_pinpage;
+        return RC_OK;
     }
     // replace algorithm
     frame = handlers[bm->strategy](mgmt->frameList, mgmt);
     if (frame) {
         bm_pinpage->status = PIN_REPLACE;
         bm_pinpage->frame = frame;
-        return bm_pinpage;
+        return RC_OK;
     }
-    free(bm_pinpage);
-    bm_pinpage = NULL;
-    return NULL;
+    return RC_FAIL;
+}
+
+/**
+ * @brief takes a frame for pageNum, evicting (and writing back) a victim if needed
+ *        the page itself is not read, caller holds the pool lock
+ * 
+ * @param bm
+ * @param pageNum
+ * @param loaded set to TRUE when the page is already in the pool
+ * @return BM_Frame 
+ */
+BM_Frame *claimFrame(BM_BufferPool *const bm, PageNumber pageNum, bool *loaded) {
+    BM_MgmtData * mgmt = (BM_MgmtData*)bm->mgmtData;
+    BM_PINPAGE bm_pinpage;
+    if (pinFindFrame(bm, pageNum, &bm_pinpage) != RC_OK) {
+        return NULL;
+    }
+    BM_Frame *frame = bm_pinpage.frame;
+    *loaded = (bm_pinpage.status == PIN_EXIST);
+    if (bm_pinpage.status == PIN_REPLACE) {
+        if (frame->dirtyflag) {
+            writeFrameBack(frame, mgmt);
+        }
+        // the page is clean now, keep a compressed copy instead of dropping it
+        if (mgmt->tier) {
+            tierStore(mgmt->tier, frame->pageNum, FRAME_DATA(mgmt->frameList, frame));
+        }
+        // the frame starts over for the new page, the page memory is reused
+        initFrame(mgmt->frameList, frame->frameNum);
+    }
+    frame->pageNum = pageNum;
+    return frame;
+}
+
+/**
+ * @brief updates the pin and replacement bookkeeping of a frame
+ * 
+ * @param frameList
+ * @param frame
+ * @return void 
+ */
+void touchFrame(BM_FrameList *frameList, BM_Frame *frame) {
+    frameList->timestamp[frame->frameNum] = getTimeStamp();
+    frameList->refCount[frame->frameNum] += 1;
+    frame->fixCount += 1;
+    frame->pointer = TRUE;
+}
+
+/**
+ * @brief pins the page with page number, caller holds the pool lock
+ * 
+ * @param bm
+ * @param page
+ * @param pageNum
+ * @return RC 
+ */
+RC pinPageLocked (BM_BufferPool *const bm, BM_PageHandle *const page, 
+		const PageNumber pageNum) {
+    BM_MgmtData * mgmt = (BM_MgmtData*)bm->mgmtData;
+    bool loaded = FALSE;
+    BM_Frame *frame = claimFrame(bm, pageNum, &loaded);
+    if (!frame) {
+        return RC_FAIL;
+    }
+    if (!loaded) {
+        char *data = FRAME_DATA(mgmt->frameList, frame);
+        if (!mgmt->tier || tierLoad(mgmt->tier, pageNum, data) != RC_OK) {
+            ensureCapacity(pageNum + 1, mgmt->fh);
+            readBlock(pageNum, mgmt->fh, data);
+            mgmt->shared->readCount += 1;
+        }
+        mgmt->shared->loadCount += 1;
+    }
+    touchFrame(mgmt->frameList, frame);
+    if (page) {
+        page->data = FRAME_DATA(mgmt->frameList, frame);
+        page->pageNum = pageNum;
+    }
+    return RC_OK;
 }
 
 /**
@@ -382,73 +845,135 @@ RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page,
     if (!mgmt) {
         return RC_FAIL;
     }
-    BM_PINPAGE *bm_pinpage = pinFindFrame(bm, pageNum);
-    if (!bm_pinpage) {
-        return RC_FAIL;
+    lockPool(mgmt);
+    RC result = pinPageLocked(bm, page, pageNum);
+    unlockPool(mgmt);
+    return result;
+}
+
+/**
+ * @brief orders batch misses by page number
+ */
+static int comparePageMiss(const void *a, const void *b) {
+    return ((const BM_PageMiss *)a)->pageNum - ((const BM_PageMiss *)b)->pageNum;
+}
+
+/**
+ * @brief loads a run of consecutive pages into their claimed frames with one read
+ * 
+ * @param mgmt
+ * @param frames
+ * @param count
+ * @return void 
+ */
+void readFrameRun(BM_MgmtData *mgmt, BM_Frame **frames, int count) {
+    int i;
+    SM_PageHandle *buffers = (SM_PageHandle *) malloc(count * sizeof(SM_PageHandle));
+    for (i = 0; i < count; i++) {
+        buffers[i] = FRAME_DATA(mgmt->frameList, frames[i]);
     }
-    if (!bm_pinpage->frame) {
-        return RC_FAIL;
+    ensureCapacity(frames[count - 1]->pageNum + 1, mgmt->fh);
+    if (readBlocks(frames[0]->pageNum, count, mgmt->fh, buffers) != RC_OK) {
+        // fall back to page at a time so a short file does not poison the run
+        for (i = 0; i < count; i++) {
+            if (readBlock(frames[i]->pageNum, mgmt->fh, buffers[i]) != RC_OK) {
+                memset(buffers[i], 0, PAGE_SIZE);
+            }
+        }
     }
-    BM_Frame *frame = bm_pinpage->frame;
-    // printf("\nstatus: %i, data: %s, framePageNum: %i", bm_pinpage->status, frame->data, frame->pageNum);
-    if (bm_pinpage->status == PIN_REPLACE) {
-        BM_Frame *newFrame = initFrame(bm_pinpage->frame->frameNum);
-        newFrame->data = (SM_PageHandle) malloc(PAGE_SIZE);
-        if (!mgmt->fh) {
-            mgmt->fh = MAKE_FH_HANDLE();
-            openPageFile(bm->pageFile, mgmt->fh);
-        }
-        ensureCapacity(pageNum, mgmt->fh);
-        readBlock(pageNum, mgmt->fh, newFrame->data);
-        newFrame->pageNum = pageNum;
-        newFrame->frameNum = frame->frameNum;
-        mgmt->readCount += 1;
-        // printf("\nnewdata: %s, newpageNum: %i, framedata: %s, framepageNum: %i\n", 
-        //     newFrame->data, 
-        //     newFrame->pageNum, 
-        //     frame->data, 
-        //     frame->pageNum
-        // );
+    mgmt->shared->readCount += count;
+    free(buffers);
+}
 
-        if (frame->dirtyflag) {
-            forceWriteSingle(frame, mgmt);
+/**
+ * @brief pins n pages at once: one lookup pass under a single lock,
+ *        misses are sorted and read in runs of consecutive page numbers
+ * 
+ * @param bm
+ * @param handles array of n page handles
+ * @param pageNums array of n page numbers
+ * @param n
+ * @return RC RC_FAIL if the pool cannot hold all of them, nothing stays pinned then
+ */
+RC pinPages (BM_BufferPool *const bm, BM_PageHandle *const handles, 
+		const PageNumber *pageNums, int n) {
+    BM_MgmtData * mgmt = (BM_MgmtData*)bm->mgmtData;
+    int i, j, missNum = 0;
+    if (!mgmt || n < 0) {
+        return RC_FAIL;
+    }
+    for (i = 0; i < n; i++) {
+        if (pageNums[i] < 0) {
+            return RC_FAIL;
         }
-        if (frame->prev) {
-            frame->prev->next = newFrame;
+    }
+    BM_PageMiss *misses = (BM_PageMiss *) malloc((n + 1) * sizeof(BM_PageMiss));
+    BM_Frame **frames = (BM_Frame **) malloc((n + 1) * sizeof(BM_Frame *));
+    RC result = RC_OK;
+
+    lockPool(mgmt);
+    // 1. hits are pinned straight away so the misses cannot evict them
+    for (i = 0; i < n; i++) {
+        BM_Frame *frame = getFrameByNum(mgmt->frameList, pageNums[i]);
+        frames[i] = frame;
+        if (frame) {
+            touchFrame(mgmt->frameList, frame);
         } else {
-            mgmt->frameList->head = newFrame;
+            misses[missNum].pageNum = pageNums[i];
+            misses[missNum].index = i;
+            missNum += 1;
         }
-        if (frame->next) {
-            frame->next->prev = newFrame;
-        } else {
-            mgmt->frameList->tail = newFrame;
-        }
-        newFrame->prev = frame->prev;
-        newFrame->next = frame->next;
-        free(frame->data);
-        frame->data = NULL;
-        free(frame);
-        frame = newFrame;
-    }
-    if (bm_pinpage->status == PIN_EMPTY) {
-        frame->data = (SM_PageHandle) malloc(PAGE_SIZE);
-        ensureCapacity(pageNum, mgmt->fh);
-        readBlock(pageNum, mgmt->fh, frame->data);
-        frame->pageNum = pageNum;
-        mgmt->readCount += 1;
-    }
-    frame->timestamp = getTimeStamp();
-    frame->fixCount += 1;
-    frame->refCount += 1;
-    frame->pointer = 1;
-    
-    if (page) {
-        page->data = (char *)frame->data;
-        page->pageNum = pageNum;
     }
-    free(bm_pinpage);
-    bm_pinpage = NULL;
-    return RC_OK;    
+    // 2. misses in page order, runs of consecutive pages share one read
+    qsort(misses, missNum, sizeof(BM_PageMiss), comparePageMiss);
+    BM_Frame **run = (BM_Frame **) malloc((missNum + 1) * sizeof(BM_Frame *));
+    int runLen = 0;
+    for (j = 0; j < missNum && result == RC_OK; j++) {
+        int idx = misses[j].index;
+        bool loaded = FALSE;
+        BM_Frame *frame = claimFrame(bm, pageNums[idx], &loaded);
+        if (!frame) {
+            result = RC_FAIL;
+            break;
+        }
+        if (!loaded) {
+            mgmt->shared->loadCount += 1;
+            // a tier hit is decompressed right away and needs no read
+            loaded = mgmt->tier &&
+                    tierLoad(mgmt->tier, frame->pageNum, FRAME_DATA(mgmt->frameList, frame)) == RC_OK;
+        }
+        if (!loaded) {
+            if (runLen > 0 && run[runLen - 1]->pageNum + 1 != frame->pageNum) {
+                readFrameRun(mgmt, run, runLen);
+                runLen = 0;
+            }
+            run[runLen++] = frame;
+        }
+        // duplicates in the batch end up as a hit on the claimed frame
+        touchFrame(mgmt->frameList, frame);
+        frames[idx] = frame;
+    }
+    if (runLen > 0) {
+        readFrameRun(mgmt, run, runLen);
+    }
+    if (result != RC_OK) {
+        // undo the pins of this call
+        for (i = 0; i < n; i++) {
+            if (frames[i]) {
+                frames[i]->fixCount -= 1;
+            }
+        }
+    } else {
+        for (i = 0; i < n; i++) {
+            handles[i].pageNum = pageNums[i];
+            handles[i].data = FRAME_DATA(mgmt->frameList, frames[i]);
+        }
+    }
+    unlockPool(mgmt);
+    free(run);
+    free(frames);
+    free(misses);
+    return result;
 }
 
 // special case => have referrence
@@ -457,10 +982,11 @@ BM_Frame *checkFixCount(BM_Frame *ret, BM_FrameList *frameList, BM_MgmtData *mgm
         return ret;
     }
     int i = 0;
+    int frameNum = ret->frameNum;
     while (i < mgmt->totalSize) {
-        ret = ret->next ? ret->next : frameList->head;
-        if (ret->fixCount == 0) {
-            return ret;
+        frameNum = (frameNum + 1) % frameList->size;
+        if (frameList->frames[frameNum].fixCount == 0) {
+            return &frameList->frames[frameNum];
         }
         i += 1;
     }
@@ -479,17 +1005,8 @@ BM_Frame *checkFixCount(BM_Frame *ret, BM_FrameList *frameList, BM_MgmtData *mgm
  * @author MingXi Xia
  */
 BM_Frame *pinPageFIFO(BM_FrameList *frameList, BM_MgmtData *mgmt){
-    BM_Frame *curr = frameList->head;
-    BM_Frame *ret = curr;
-    int front = mgmt->readCount % mgmt->totalSize;
-    while (curr){
-        if (curr->frameNum == front) {
-            ret = curr;
-            break;
-        }
-        curr = curr->next;
-    }
-    return checkFixCount(ret, frameList, mgmt);
+    int front = mgmt->shared->loadCount % mgmt->totalSize;
+    return checkFixCount(&frameList->frames[front], frameList, mgmt);
 }
 
 //LRU implementation
@@ -502,19 +1019,16 @@ BM_Frame *pinPageFIFO(BM_FrameList *frameList, BM_MgmtData *mgmt){
  * @author MingXi Xia
  */
 BM_Frame *pinPageLRU(BM_FrameList *frameList, BM_MgmtData *mgmt){
-    BM_Frame *curr = frameList->head;
-    BM_Frame *ret = curr;
-    long min = curr->timestamp;
-    while (curr){
-        // printf("\nnumber %i frame, timestamp: %ld", curr->frameNum, curr->timestamp);
-        if (curr->timestamp < min) {
-            min = curr->timestamp;
-            ret = curr;
+    const long *timestamp = frameList->timestamp;
+    int i, ret = 0;
+    long min = timestamp[0];
+    for (i = 1; i < frameList->size; i++) {
+        if (timestamp[i] < min) {
+            min = timestamp[i];
+            ret = i;
         }
-        curr = curr->next;
     }
-    return checkFixCount(ret, frameList, mgmt);
-    // return ret;
+    return checkFixCount(&frameList->frames[ret], frameList, mgmt);
 }
 
 /**
@@ -526,25 +1040,23 @@ BM_Frame *pinPageLRU(BM_FrameList *frameList, BM_MgmtData *mgmt){
  * @author MingXi Xia
  */
 BM_Frame *pinPageCLOCK(BM_FrameList *frameList, BM_MgmtData *mgmt){
-    BM_Frame *curr = frameList->head;
-    BM_Frame *ret = curr;
-    while(curr){
-        if(curr->pointer == 0){
-            ret = curr;
+    BM_Frame *frames = frameList->frames;
+    int i, ret = 0;
+    for (i = 0; i < frameList->size; i++) {
+        if (frames[i].pointer == FALSE) {
+            ret = i;
             break;
         }
-        
-        curr = curr->next;
     }
-    while(curr){
-        curr->pointer = 0;
-        curr=curr->next;
+    for (; i < frameList->size; i++) {
+        frames[i].pointer = FALSE;
     }
-    return checkFixCount(ret, frameList, mgmt);
+    return checkFixCount(&frames[ret], frameList, mgmt);
 }
 
 /**
  * @brief pin replacement strategy LRUK implementation
+ *        picks the frame with the k-th oldest timestamp, ties go to the lower frame
  * 
  * @param frameList
  * @param mgmt
@@ -552,31 +1064,22 @@ BM_Frame *pinPageCLOCK(BM_FrameList *frameList, BM_MgmtData *mgmt){
  * @author MingXi Xia
  */
 BM_Frame *pinPageLRUK(BM_FrameList *frameList, BM_MgmtData *mgmt){
-    BM_Frame *curr = frameList->head;
-    BM_Frame *ret = NULL;
-    BM_Frame ** arr = (BM_Frame**)malloc(sizeof(BM_Frame*) * mgmt->totalSize);
-    int i = 0;
-    int j = 0;
-    while (i < mgmt->totalSize){
-        arr[i] = curr;
-        curr = curr->next;
-        i += 1;
-    }
-    for (i = 0; i < mgmt->totalSize - 1; i++) {
-        for (j = 0; j < mgmt->totalSize - i - 1; j++) {
-            if (arr[j]->timestamp > arr[j+1]->timestamp) {
-                BM_Frame * temp = arr[j];
-                arr[j] = arr[j+1];
-                arr[j+1] = temp;
+    const long *timestamp = frameList->timestamp;
+    int i, round, ret = -1;
+    int k = mgmt->k < 1 ? 1 : (mgmt->k > frameList->size ? frameList->size : mgmt->k);
+    // k selection passes over the timestamp array instead of sorting frames
+    for (round = 0; round < k; round++) {
+        int next = -1;
+        for (i = 0; i < frameList->size; i++) {
+            bool after = ret < 0 || timestamp[i] > timestamp[ret] ||
+                    (timestamp[i] == timestamp[ret] && i > ret);
+            if (after && (next < 0 || timestamp[i] < timestamp[next])) {
+                next = i;
             }
         }
+        ret = next;
     }
-    // for (i = 0;i < mgmt->totalSize; i++) {
-    //     printf("timestamp: %ld, frameNum: %d\n", arr[i]->timestamp, arr[i]->frameNum);
-    // }
-    ret = arr[mgmt->k - 1];
-    free(arr);
-    return ret;
+    return checkFixCount(&frameList->frames[ret], frameList, mgmt);
 }
 
 /**
@@ -588,17 +1091,16 @@ BM_Frame *pinPageLRUK(BM_FrameList *frameList, BM_MgmtData *mgmt){
  * @author MingXi Xia
  */
 BM_Frame *pinPageLFU(BM_FrameList *frameList, BM_MgmtData *mgmt){
-    BM_Frame *curr = frameList->head;
-    BM_Frame *ret = curr;
-    int min_count = curr->refCount;
-    while(curr){
-        if(curr->refCount<min_count){
-            min_count = curr->refCount;
-            ret = curr;
+    const int *refCount = frameList->refCount;
+    int i, ret = 0;
+    int min_count = refCount[0];
+    for (i = 1; i < frameList->size; i++) {
+        if (refCount[i] < min_count) {
+            min_count = refCount[i];
+            ret = i;
         }
-        curr=curr->next;
     }
-    return checkFixCount(ret, frameList, mgmt);
+    return checkFixCount(&frameList->frames[ret], frameList, mgmt);
 }
 
 
@@ -614,10 +1116,10 @@ BM_Frame *pinPageLFU(BM_FrameList *frameList, BM_MgmtData *mgmt){
 PageNumber *getFrameContents (BM_BufferPool *const bm) {
     PageNumber *arrayPageNumbers = (PageNumber*)malloc(bm->numPages * sizeof(PageNumber));
     BM_MgmtData * mgmt = (BM_MgmtData*)bm->mgmtData;
-    BM_Frame *curr = mgmt->frameList->head;
-    while (curr) {
+    int i;
+    for (i = 0; i < mgmt->frameList->size; i++) {
+        BM_Frame *curr = &mgmt->frameList->frames[i];
         arrayPageNumbers[curr->frameNum] = curr->pageNum;
-        curr = curr->next;
     }
     return arrayPageNumbers;
 }
@@ -632,10 +1134,10 @@ PageNumber *getFrameContents (BM_BufferPool *const bm) {
 bool *getDirtyFlags (BM_BufferPool *const bm) {
     bool *arrayOfBools = (bool*)malloc(bm->numPages * sizeof(bool));
     BM_MgmtData * mgmt = (BM_MgmtData*)bm->mgmtData;
-    BM_Frame *curr = mgmt->frameList->head;
-    while (curr) {
+    int i;
+    for (i = 0; i < mgmt->frameList->size; i++) {
+        BM_Frame *curr = &mgmt->frameList->frames[i];
         arrayOfBools[curr->frameNum] = (bool)curr->dirtyflag;
-        curr = curr->next;
     }
     return arrayOfBools;
 }
@@ -650,10 +1152,10 @@ bool *getDirtyFlags (BM_BufferPool *const bm) {
 int *getFixCounts (BM_BufferPool *const bm) {
     int *arrayOfInts = (int*)malloc(bm->numPages * sizeof(int));
     BM_MgmtData * mgmt = (BM_MgmtData*)bm->mgmtData;
-    BM_Frame *curr = mgmt->frameList->head;
-    while (curr) {
+    int i;
+    for (i = 0; i < mgmt->frameList->size; i++) {
+        BM_Frame *curr = &mgmt->frameList->frames[i];
         arrayOfInts[curr->frameNum] = (bool)curr->fixCount;
-        curr = curr->next;
     }
     return arrayOfInts;
 }
@@ -667,7 +1169,7 @@ int *getFixCounts (BM_BufferPool *const bm) {
  */
 int getNumReadIO (BM_BufferPool *const bm) {
     BM_MgmtData *data = (BM_MgmtData *) bm->mgmtData;
-    return (data->readCount);
+    return (data->shared->readCount);
 }
 
 /**
@@ -679,5 +1181,92 @@ int getNumReadIO (BM_BufferPool *const bm) {
  */
 int getNumWriteIO (BM_BufferPool *const bm) {
     BM_MgmtData *data = (BM_MgmtData *) bm->mgmtData;
-    return (data->writeCount);
+    return (data->shared->writeCount);
+}
+
+/**
+ * @brief returns the average number of pages per write request
+ * 
+ * @param bm
+ * @return double 
+ */
+double getAverageWriteRun (BM_BufferPool *const bm) {
+    BM_MgmtData *data = (BM_MgmtData *) bm->mgmtData;
+    if (data->shared->writeRuns == 0) {
+        return 0;
+    }
+    return (double) data->shared->writeCount / data->shared->writeRuns;
+}
+
+// Durability Interface
+/**
+ * @brief sets when forcePage() and forceFlushPool() make their writes durable,
+ *        see setDurability()
+ * 
+ * @param bm
+ * @param mode
+ * @param periodMicros
+ * @return RC 
+ */
+RC setPoolDurability (BM_BufferPool *const bm, SM_DurabilityMode mode, long periodMicros) {
+    BM_MgmtData *data = (BM_MgmtData *) bm->mgmtData;
+    if (!data) {
+        return RC_FAIL;
+    }
+    return setDurability(data->fh, mode, periodMicros);
+}
+
+// Compressed Tier Interface
+/**
+ * @brief enables the compressed second tier, clean pages evicted from the pool
+ *        are kept there and misses check it before reading from disk
+ * 
+ * @param bm
+ * @param budgetBytes memory for compressed pages, 0 disables the tier
+ * @return RC 
+ */
+RC setCompressedTier (BM_BufferPool *const bm, long budgetBytes) {
+    BM_MgmtData *mgmt = (BM_MgmtData *) bm->mgmtData;
+    // private copies of pages could go stale next to a shared pool
+    if (!mgmt || budgetBytes < 0 || mgmt->shmBase) {
+        return RC_FAIL;
+    }
+    lockPool(mgmt);
+    if (mgmt->tier) {
+        destroyCompressedTier(mgmt->tier);
+        mgmt->tier = NULL;
+    }
+    if (budgetBytes > 0) {
+        mgmt->tier = initCompressedTier(budgetBytes);
+    }
+    unlockPool(mgmt);
+    return RC_OK;
+}
+
+/**
+ * @brief returns the share of pool misses served by the compressed tier
+ * 
+ * @param bm
+ * @return double 
+ */
+double getTierHitRatio (BM_BufferPool *const bm) {
+    BM_MgmtData *data = (BM_MgmtData *) bm->mgmtData;
+    if (!data->tier || data->tier->lookups == 0) {
+        return 0;
+    }
+    return (double) data->tier->hits / data->tier->lookups;
+}
+
+/**
+ * @brief returns uncompressed / compressed bytes of all pages stored in the tier
+ * 
+ * @param bm
+ * @return double 
+ */
+double getTierCompressionRatio (BM_BufferPool *const bm) {
+    BM_MgmtData *data = (BM_MgmtData *) bm->mgmtData;
+    if (!data->tier || data->tier->compressedBytes == 0) {
+        return 0;
+    }
+    return (double) data->tier->rawBytes / data->tier->compressedBytes;
 }
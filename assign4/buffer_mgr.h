@@ -7,6 +7,7 @@
 // Include bool DT
 #include "dt.h"
 #include "storage_mgr.h"
+#include "buffer_tier.h"
 
 // Replacement Strategies
 typedef enum ReplacementStrategy {
@@ -33,35 +34,64 @@ typedef struct BM_PageHandle {
 	char *data;
 } BM_PageHandle;
 
+// hot frame descriptor: the fields touched on every pin/unpin, 16 bytes each
+// so four descriptors share a cache line
 typedef struct BM_Frame {
-	bool dirtyflag;
 	PageNumber pageNum; //  current frame page size in list
-	int frameNum;       //  current frame number
-	SM_PageHandle data;
-
-	long timestamp;     //  for LRU replacement strategy
 	int fixCount;       //  pin counter
-	int refCount;       //  for LFU replacement strategy
-	int k_count;        //  for LRUK replacement strategy
-	int pointer;		// for CLOCK replacement strategy
-	struct BM_Frame *prev;
-	struct BM_Frame *next;
+	int frameNum;       //  current frame number
+	bool dirtyflag;
+	bool pointer;		// for CLOCK replacement strategy
 } BM_Frame;
 
+// all frames of a pool live in one cache line aligned arena:
+// the hot descriptors as a dense array, the replacement bookkeeping as
+// one array per field (victim searches only stream the field they compare)
+// and the page memory itself
 typedef struct BM_FrameList {
-	BM_Frame *head;
-	BM_Frame *tail;
+	int size;
+	BM_Frame *frames;
+	long *timestamp;    //  for LRU/LRUK replacement strategy
+	int *refCount;      //  for LFU replacement strategy
+	char *pages;        //  page memory, PAGE_SIZE per frame
+	void *arena;
 } BM_FrameList;
 
+#define BM_CACHE_LINE 64
 
-typedef struct BM_MgmtData {
-	int totalSize; // buffer pool size
+// page memory of a frame
+#define FRAME_DATA(frameList, frame) \
+		((frameList)->pages + (long)(frame)->frameNum * PAGE_SIZE)
+
+#define BM_SHM_FILE_MAX 256
+// longest run of adjacent dirty pages written with one request
+#define BM_MAX_WRITE_RUN 32
+
+// pool state every user of the pool has to see, it heads the frame arena
+// so that a shared pool keeps it in the shared memory segment as well
+typedef struct BM_PoolShared {
+	pthread_mutex_t mutexlock;// make the buffer pool thread safe
 	int readCount;
 	int writeCount;
+	int writeRuns; // write requests, a run of adjacent pages counts once
+	int loadCount; // pages brought into frames, from disk or the tier (FIFO order)
+	int numPages;
+	int attached;  // processes attached to a shared pool
+	int ready;     // the creator finished initializing the segment
+	char pageFile[BM_SHM_FILE_MAX];
+} BM_PoolShared;
+
+typedef struct BM_MgmtData {
+	int totalSize; // buffer pool size
+	BM_PoolShared *shared;
 	SM_FileHandle *fh;
 	BM_FrameList *frameList;
+	BM_CompressedTier *tier; // optional second tier for clean evicted pages
 	int k;
-	pthread_mutex_t mutexlock;// make the buffer pool thread safe
+	// POSIX shared memory placement, see initBufferPoolShared
+	char *shmName;
+	void *shmBase;
+	size_t shmSize;
 } BM_MgmtData;
 
 typedef struct BM_PINPAGE {
@@ -69,6 +99,12 @@ typedef struct BM_PINPAGE {
     BM_Frame *frame;
 } BM_PINPAGE;
 
+// a page of a pinPages batch that is not in the pool yet
+typedef struct BM_PageMiss {
+    PageNumber pageNum;
+    int index; // position in the batch
+} BM_PageMiss;
+
 typedef BM_Frame *(*handlers_t)(BM_FrameList *frameList, BM_MgmtData *mgmt);
 
 #define PIN_EMPTY 0
@@ -91,9 +127,6 @@ typedef BM_Frame *(*handlers_t)(BM_FrameList *frameList, BM_MgmtData *mgmt);
 #define MAKE_FRAME_LIST() \
 		((BM_FrameList *) malloc(sizeof(BM_FrameList)))
 
-#define MAKE_FRAME() \
-		((BM_Frame *) malloc(sizeof(BM_Frame)))
-
 #define MAKE_MEMPAGE() \
 		((SM_PageHandle *) malloc(sizeof(SM_PageHandle)))
 
@@ -109,6 +142,9 @@ BM_Frame *pinPageCLOCK(BM_FrameList *, BM_MgmtData *);
 RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName, 
 		const int numPages, ReplacementStrategy strategy,
 		void *stratData);
+RC initBufferPoolShared(BM_BufferPool *const bm, const char *const pageFileName, 
+		const int numPages, ReplacementStrategy strategy,
+		void *stratData, const char *const shmName);
 RC shutdownBufferPool(BM_BufferPool *const bm);
 RC forceFlushPool(BM_BufferPool *const bm);
 
@@ -118,6 +154,10 @@ RC unpinPage (BM_BufferPool *const bm, BM_PageHandle *const page);
 RC forcePage (BM_BufferPool *const bm, BM_PageHandle *const page);
 RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page, 
 		const PageNumber pageNum);
+RC pinPages (BM_BufferPool *const bm, BM_PageHandle *const handles, 
+		const PageNumber *pageNums, int n);
+RC unpinPages (BM_BufferPool *const bm, BM_PageHandle *const handles, int n);
+RC writePagesDirect (BM_BufferPool *const bm, PageNumber startPage, int numPages, char **pages);
 
 // Statistics Interface
 PageNumber *getFrameContents (BM_BufferPool *const bm);
@@ -125,5 +165,14 @@ bool *getDirtyFlags (BM_BufferPool *const bm);
 int *getFixCounts (BM_BufferPool *const bm);
 int getNumReadIO (BM_BufferPool *const bm);
 int getNumWriteIO (BM_BufferPool *const bm);
+double getAverageWriteRun (BM_BufferPool *const bm);
+
+// Durability Interface
+RC setPoolDurability (BM_BufferPool *const bm, SM_DurabilityMode mode, long periodMicros);
+
+// Compressed Tier Interface
+RC setCompressedTier (BM_BufferPool *const bm, long budgetBytes);
+double getTierHitRatio (BM_BufferPool *const bm);
+double getTierCompressionRatio (BM_BufferPool *const bm);
 
 #endif
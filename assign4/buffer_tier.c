@@ -0,0 +1,319 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "buffer_tier.h"
+#include "dberror.h"
+#include "dt.h"
+
+#define TIER_HASH_BITS 12
+#define TIER_MIN_MATCH 4
+#define TIER_MAX_OFFSET 65535
+// the last bytes of a page are always emitted as literals
+#define TIER_LAST_LITERALS 5
+
+/**
+ * @brief reads 4 bytes without alignment requirements
+ */
+static unsigned int readInt32(const char *p) {
+    unsigned int v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static int hashInt32(unsigned int v) {
+    return (int)((v * 2654435761U) >> (32 - TIER_HASH_BITS));
+}
+
+/**
+ * @brief writes a length that did not fit into the token nibble
+ */
+static int writeLength(char *dst, int len) {
+    int op = 0;
+    while (len >= 255) {
+        dst[op++] = (char)255;
+        len -= 255;
+    }
+    dst[op++] = (char)len;
+    return op;
+}
+
+/**
+ * @brief emits one sequence: token | literal length | literals | offset | match length
+ *        offset == 0 marks the final literal only sequence
+ */
+static int writeSequence(char *dst, const char *literals, int litLen, int offset, int matchLen) {
+    int op = 1;
+    int litNibble = litLen < 15 ? litLen : 15;
+    int matchNibble = 0;
+    if (offset > 0) {
+        matchNibble = matchLen - TIER_MIN_MATCH < 15 ? matchLen - TIER_MIN_MATCH : 15;
+    }
+    dst[0] = (char)((litNibble << 4) | matchNibble);
+    if (litNibble == 15) {
+        op += writeLength(dst + op, litLen - 15);
+    }
+    memcpy(dst + op, literals, litLen);
+    op += litLen;
+    if (offset > 0) {
+        dst[op++] = (char)(offset & 0xff);
+        dst[op++] = (char)(offset >> 8);
+        if (matchNibble == 15) {
+            op += writeLength(dst + op, matchLen - TIER_MIN_MATCH - 15);
+        }
+    }
+    return op;
+}
+
+/**
+ * @brief compresses src with a single pass LZ77 (hash of 4 byte sequences, 64KB window)
+ *
+ * @param src
+ * @param srcLen
+ * @param dst at least TIER_MAX_COMPRESSED bytes for a page
+ * @return int compressed size
+ */
+int tierCompress(const char *src, int srcLen, char *dst) {
+    int table[1 << TIER_HASH_BITS];
+    int ip = 0, anchor = 0, op = 0;
+    int limit = srcLen - TIER_LAST_LITERALS;
+
+    memset(table, 0, sizeof(table));
+    while (ip < limit) {
+        unsigned int seq = readInt32(src + ip);
+        int h = hashInt32(seq);
+        int ref = table[h] - 1;
+        table[h] = ip + 1;
+        if (ref < 0 || ip - ref > TIER_MAX_OFFSET || readInt32(src + ref) != seq) {
+            ip += 1;
+            continue;
+        }
+        int matchLen = TIER_MIN_MATCH;
+        while (ip + matchLen < srcLen && src[ref + matchLen] == src[ip + matchLen]) {
+            matchLen += 1;
+        }
+        op += writeSequence(dst + op, src + anchor, ip - anchor, ip - ref, matchLen);
+        ip += matchLen;
+        anchor = ip;
+    }
+    op += writeSequence(dst + op, src + anchor, srcLen - anchor, 0, 0);
+    return op;
+}
+
+/**
+ * @brief reads a length continued over 255 bytes
+ */
+static int readLength(const char *src, int srcLen, int *ip, int len) {
+    unsigned char b;
+    do {
+        if (*ip >= srcLen) {
+            return -1;
+        }
+        b = (unsigned char)src[(*ip)++];
+        len += b;
+    } while (b == 255);
+    return len;
+}
+
+/**
+ * @brief decompresses what tierCompress produced
+ *
+ * @param src
+ * @param srcLen
+ * @param dst
+ * @param dstLen capacity of dst
+ * @return int decompressed size, -1 on corrupt input
+ */
+int tierDecompress(const char *src, int srcLen, char *dst, int dstLen) {
+    int ip = 0, op = 0;
+    while (ip < srcLen) {
+        unsigned char token = (unsigned char)src[ip++];
+        int litLen = token >> 4;
+        if (litLen == 15 && (litLen = readLength(src, srcLen, &ip, litLen)) < 0) {
+            return -1;
+        }
+        if (ip + litLen > srcLen || op + litLen > dstLen) {
+            return -1;
+        }
+        memcpy(dst + op, src + ip, litLen);
+        ip += litLen;
+        op += litLen;
+        if (ip >= srcLen) {
+            break;
+        }
+        if (ip + 2 > srcLen) {
+            return -1;
+        }
+        int offset = (unsigned char)src[ip] | ((unsigned char)src[ip + 1] << 8);
+        ip += 2;
+        int matchLen = token & 15;
+        if (matchLen == 15 && (matchLen = readLength(src, srcLen, &ip, matchLen)) < 0) {
+            return -1;
+        }
+        matchLen += TIER_MIN_MATCH;
+        if (offset == 0 || offset > op || op + matchLen > dstLen) {
+            return -1;
+        }
+        // byte copy, the match may overlap what it produces
+        const char *ref = dst + op - offset;
+        int i;
+        for (i = 0; i < matchLen; i++) {
+            dst[op + i] = ref[i];
+        }
+        op += matchLen;
+    }
+    return op;
+}
+
+/**
+ * @brief creates an empty tier
+ *
+ * @param budget bytes of compressed pages the tier may hold
+ * @return BM_CompressedTier*
+ */
+BM_CompressedTier *initCompressedTier(long budget) {
+    BM_CompressedTier *tier = (BM_CompressedTier *) calloc(1, sizeof(BM_CompressedTier));
+    int numBuckets = 64;
+    // about one bucket per 1KB of budget, compressed pages are rarely smaller
+    while (numBuckets < budget / 1024 && numBuckets < (1 << 20)) {
+        numBuckets *= 2;
+    }
+    tier->budget = budget;
+    tier->numBuckets = numBuckets;
+    tier->buckets = (BM_TierEntry **) calloc(numBuckets, sizeof(BM_TierEntry *));
+    return tier;
+}
+
+/**
+ * @brief frees the tier and all pages in it
+ *
+ * @param tier
+ */
+void destroyCompressedTier(BM_CompressedTier *tier) {
+    BM_TierEntry *curr = tier->head;
+    while (curr) {
+        BM_TierEntry *next = curr->next;
+        free(curr->data);
+        free(curr);
+        curr = next;
+    }
+    free(tier->buckets);
+    free(tier);
+}
+
+static BM_TierEntry **findBucketSlot(BM_CompressedTier *tier, int pageNum) {
+    BM_TierEntry **slot = &tier->buckets[pageNum & (tier->numBuckets - 1)];
+    while (*slot && (*slot)->pageNum != pageNum) {
+        slot = &(*slot)->hashNext;
+    }
+    return slot;
+}
+
+/**
+ * @brief unlinks and frees the entry behind slot
+ */
+static void removeEntry(BM_CompressedTier *tier, BM_TierEntry **slot) {
+    BM_TierEntry *entry = *slot;
+    *slot = entry->hashNext;
+    if (entry->prev) {
+        entry->prev->next = entry->next;
+    } else {
+        tier->head = entry->next;
+    }
+    if (entry->next) {
+        entry->next->prev = entry->prev;
+    } else {
+        tier->tail = entry->prev;
+    }
+    tier->used -= entry->size;
+    free(entry->data);
+    free(entry);
+}
+
+/**
+ * @brief drops a page from the tier if it is there
+ *
+ * @param tier
+ * @param pageNum
+ */
+void tierInvalidate(BM_CompressedTier *tier, int pageNum) {
+    BM_TierEntry **slot = findBucketSlot(tier, pageNum);
+    if (*slot) {
+        removeEntry(tier, slot);
+    }
+}
+
+/**
+ * @brief compresses a clean page into the tier, the least recently stored
+ *        pages make room when the budget is exhausted
+ *
+ * @param tier
+ * @param pageNum
+ * @param page PAGE_SIZE bytes
+ * @return RC RC_FAIL if the page can never fit the budget
+ */
+RC tierStore(BM_CompressedTier *tier, int pageNum, const char *page) {
+    char buffer[TIER_MAX_COMPRESSED];
+    int size = tierCompress(page, PAGE_SIZE, buffer);
+    const char *src = buffer;
+    // incompressible pages are kept raw, a raw entry is exactly PAGE_SIZE
+    if (size >= PAGE_SIZE) {
+        size = PAGE_SIZE;
+        src = page;
+    }
+    tierInvalidate(tier, pageNum);
+    if (size > tier->budget) {
+        return RC_FAIL;
+    }
+    while (tier->used + size > tier->budget) {
+        removeEntry(tier, findBucketSlot(tier, tier->tail->pageNum));
+    }
+    BM_TierEntry *entry = (BM_TierEntry *) malloc(sizeof(BM_TierEntry));
+    entry->pageNum = pageNum;
+    entry->size = size;
+    entry->data = (char *) malloc(size);
+    memcpy(entry->data, src, size);
+    // hash chain and front of the recency list
+    BM_TierEntry **bucket = &tier->buckets[pageNum & (tier->numBuckets - 1)];
+    entry->hashNext = *bucket;
+    *bucket = entry;
+    entry->prev = NULL;
+    entry->next = tier->head;
+    if (tier->head) {
+        tier->head->prev = entry;
+    } else {
+        tier->tail = entry;
+    }
+    tier->head = entry;
+
+    tier->used += size;
+    tier->rawBytes += PAGE_SIZE;
+    tier->compressedBytes += size;
+    return RC_OK;
+}
+
+/**
+ * @brief looks a page up in the tier and decompresses it into page,
+ *        the entry leaves the tier since the pool holds the page now
+ *
+ * @param tier
+ * @param pageNum
+ * @param page PAGE_SIZE bytes
+ * @return RC RC_FAIL on a tier miss
+ */
+RC tierLoad(BM_CompressedTier *tier, int pageNum, char *page) {
+    BM_TierEntry **slot = findBucketSlot(tier, pageNum);
+    BM_TierEntry *entry = *slot;
+    tier->lookups += 1;
+    if (!entry) {
+        return RC_FAIL;
+    }
+    if (entry->size == PAGE_SIZE) {
+        memcpy(page, entry->data, PAGE_SIZE);
+    } else if (tierDecompress(entry->data, entry->size, page, PAGE_SIZE) != PAGE_SIZE) {
+        removeEntry(tier, slot);
+        return RC_FAIL;
+    }
+    removeEntry(tier, slot);
+    tier->hits += 1;
+    return RC_OK;
+}
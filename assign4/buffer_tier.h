@@ -0,0 +1,47 @@
+#ifndef BUFFER_TIER_H
+#define BUFFER_TIER_H
+
+#include "dberror.h"
+#include "dt.h"
+
+// worst case size of a compressed page (incompressible input)
+#define TIER_MAX_COMPRESSED (PAGE_SIZE + PAGE_SIZE / 255 + 16)
+
+// one evicted page held in compressed form
+typedef struct BM_TierEntry {
+	int pageNum;
+	int size;       // compressed bytes
+	char *data;
+	struct BM_TierEntry *hashNext;
+	struct BM_TierEntry *prev; // recency list, head is the most recent
+	struct BM_TierEntry *next;
+} BM_TierEntry;
+
+// second tier of a buffer pool: clean evicted pages, compressed,
+// inside their own memory budget
+typedef struct BM_CompressedTier {
+	long budget;    // bytes of compressed data the tier may hold
+	long used;
+	int numBuckets;
+	BM_TierEntry **buckets;
+	BM_TierEntry *head;
+	BM_TierEntry *tail;
+
+	long lookups;   // misses of the pool that asked the tier
+	long hits;
+	long rawBytes;  // bytes of pages stored so far
+	long compressedBytes;
+} BM_CompressedTier;
+
+// LZ-style page codec
+extern int tierCompress (const char *src, int srcLen, char *dst);
+extern int tierDecompress (const char *src, int srcLen, char *dst, int dstLen);
+
+// tier handling
+extern BM_CompressedTier *initCompressedTier (long budget);
+extern void destroyCompressedTier (BM_CompressedTier *tier);
+extern RC tierStore (BM_CompressedTier *tier, int pageNum, const char *page);
+extern RC tierLoad (BM_CompressedTier *tier, int pageNum, char *page);
+extern void tierInvalidate (BM_CompressedTier *tier, int pageNum);
+
+#endif
@@ -28,6 +28,9 @@ typedef int RC;
 #define RC_RM_TABLE_NOT_EXIST 207
 #define RC_RM_NONE_TUPLES 208
 #define RC_RM_DELETED_TUPLES 209
+#define RC_RM_HEADER_TOO_LARGE 210
+#define RC_RM_EXPR_NOT_COMPILABLE 211
+#define RC_RM_TOO_MANY_WORKERS 212
 
 #define RC_IM_KEY_NOT_FOUND 300
 #define RC_IM_KEY_ALREADY_EXISTS 301
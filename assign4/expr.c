@@ -50,6 +50,7 @@ valueSmaller (Value *left, Value *right, Value *result)
 		break;
 	case DT_BOOL:
 		result->v.boolV = (left->v.boolV < right->v.boolV);
+		break;
 	case DT_STRING:
 		result->v.boolV = (strcmp(left->v.stringV, right->v.stringV) < 0);
 		break;
@@ -74,6 +75,7 @@ boolAnd (Value *left, Value *right, Value *result)
 {
 	if (left->dt != DT_BOOL || right->dt != DT_BOOL)
 		THROW(RC_RM_BOOLEAN_EXPR_ARG_IS_NOT_BOOLEAN, "boolean AND requires boolean inputs");
+	result->dt = DT_BOOL;
 	result->v.boolV = (left->v.boolV && right->v.boolV);
 
 	return RC_OK;
@@ -84,6 +86,7 @@ boolOr (Value *left, Value *right, Value *result)
 {
 	if (left->dt != DT_BOOL || right->dt != DT_BOOL)
 		THROW(RC_RM_BOOLEAN_EXPR_ARG_IS_NOT_BOOLEAN, "boolean OR requires boolean inputs");
+	result->dt = DT_BOOL;
 	result->v.boolV = (left->v.boolV || right->v.boolV);
 
 	return RC_OK;
@@ -106,6 +109,15 @@ evalExpr (Record *record, Schema *schema, Expr *expr, Value **result)
 		//    rIn = (Value *) malloc(sizeof(Value));
 
 		CHECK(evalExpr(record, schema, op->args[0], &lIn));
+		// AND with a false or OR with a true left operand is decided
+		if (lIn->dt == DT_BOOL
+				&& ((op->type == OP_BOOL_AND && !lIn->v.boolV)
+						|| (op->type == OP_BOOL_OR && lIn->v.boolV)))
+		{
+			free(*result);
+			*result = lIn;
+			break;
+		}
 		if (twoArgs)
 			CHECK(evalExpr(record, schema, op->args[1], &rIn));
 
@@ -148,6 +160,559 @@ evalExpr (Record *record, Schema *schema, Expr *expr, Value **result)
 	return RC_OK;
 }
 
+// compiled conditions
+static RC
+compileOperand (Expr *expr, Schema *schema, ExprOperand *operand, DataType *dt)
+{
+	switch(expr->type)
+	{
+	case EXPR_CONST:
+		*dt = expr->expr.cons->dt;
+		operand->attr = -1;
+		operand->offset = -1;
+		operand->len = 0;
+		switch(*dt)
+		{
+		case DT_INT:
+			operand->v.intV = expr->expr.cons->v.intV;
+			break;
+		case DT_FLOAT:
+			operand->v.floatV = expr->expr.cons->v.floatV;
+			break;
+		case DT_BOOL:
+			operand->v.boolV = expr->expr.cons->v.boolV;
+			break;
+		case DT_STRING:
+			operand->len = strlen(expr->expr.cons->v.stringV);
+			operand->v.stringV = (char *) malloc(operand->len + 1);
+			strcpy(operand->v.stringV, expr->expr.cons->v.stringV);
+			break;
+		}
+		return RC_OK;
+	case EXPR_ATTRREF:
+		if (expr->expr.attrRef < 0 || expr->expr.attrRef >= schema->numAttr)
+			return RC_RM_UNKOWN_DATATYPE;
+		*dt = schema->dataTypes[expr->expr.attrRef];
+		operand->attr = expr->expr.attrRef;
+		operand->offset = schema->layout->offsets[expr->expr.attrRef];
+		operand->len = schema->layout->sizes[expr->expr.attrRef];
+		return RC_OK;
+	default:
+		// comparing the results of boolean operators is left to evalExpr
+		return RC_RM_EXPR_NOT_COMPILABLE;
+	}
+}
+
+static int
+emitInstr (ExprProgram *program, ExprOpcode opcode)
+{
+	ExprInstr *instr;
+	program->code = (ExprInstr *) realloc(program->code, (program->numInstr + 1) * sizeof(ExprInstr));
+	instr = &program->code[program->numInstr];
+	memset(instr, 0, sizeof(ExprInstr));
+	instr->opcode = opcode;
+	instr->left.attr = instr->left.offset = -1;
+	instr->right.attr = instr->right.offset = -1;
+	return program->numInstr++;
+}
+
+// emits the code leaving the value of a boolean expression in the register
+static RC
+emitExpr (Expr *expr, Schema *schema, ExprProgram *program)
+{
+	ExprInstr *instr;
+	DataType left, right;
+	int pc, jump;
+	RC rc;
+
+	if (expr->type != EXPR_OP)
+	{
+		pc = emitInstr(program, EXPR_LOAD_BOOL);
+		instr = &program->code[pc];
+		if ((rc = compileOperand(expr, schema, &instr->left, &left)) != RC_OK)
+		{
+			program->numInstr--;
+			return rc;
+		}
+		if (left != DT_BOOL)
+		{
+			if (left == DT_STRING && instr->left.offset < 0)
+				free(instr->left.v.stringV);
+			program->numInstr--;
+			return RC_RM_BOOLEAN_EXPR_ARG_IS_NOT_BOOLEAN;
+		}
+		return RC_OK;
+	}
+
+	Operator *op = expr->expr.op;
+	switch(op->type)
+	{
+	case OP_BOOL_NOT:
+		if ((rc = emitExpr(op->args[0], schema, program)) != RC_OK)
+			return rc;
+		emitInstr(program, EXPR_NOT);
+		return RC_OK;
+	case OP_BOOL_AND:
+	case OP_BOOL_OR:
+		// the right operand is skipped once the left one decides
+		if ((rc = emitExpr(op->args[0], schema, program)) != RC_OK)
+			return rc;
+		jump = emitInstr(program, op->type == OP_BOOL_AND ? EXPR_JUMP_IF_FALSE : EXPR_JUMP_IF_TRUE);
+		if ((rc = emitExpr(op->args[1], schema, program)) != RC_OK)
+			return rc;
+		program->code[jump].target = program->numInstr;
+		return RC_OK;
+	case OP_COMP_EQUAL:
+	case OP_COMP_SMALLER:
+		pc = emitInstr(program, EXPR_EQ_INT);
+		instr = &program->code[pc];
+		if ((rc = compileOperand(op->args[0], schema, &instr->left, &left)) != RC_OK)
+		{
+			program->numInstr--;
+			return rc;
+		}
+		rc = compileOperand(op->args[1], schema, &instr->right, &right);
+		if (rc == RC_OK && left != right)
+			rc = RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE;
+		if (rc != RC_OK)
+		{
+			// the instruction is not typed yet, freeExprProgram would miss its strings
+			if (left == DT_STRING && instr->left.offset < 0)
+				free(instr->left.v.stringV);
+			if (rc == RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE
+					&& right == DT_STRING && instr->right.offset < 0)
+				free(instr->right.v.stringV);
+			program->numInstr--;
+			return rc;
+		}
+		switch(left)
+		{
+		case DT_INT:
+			instr->opcode = op->type == OP_COMP_EQUAL ? EXPR_EQ_INT : EXPR_LT_INT;
+			break;
+		case DT_FLOAT:
+			instr->opcode = op->type == OP_COMP_EQUAL ? EXPR_EQ_FLOAT : EXPR_LT_FLOAT;
+			break;
+		case DT_BOOL:
+			instr->opcode = op->type == OP_COMP_EQUAL ? EXPR_EQ_BOOL : EXPR_LT_BOOL;
+			break;
+		case DT_STRING:
+			instr->opcode = op->type == OP_COMP_EQUAL ? EXPR_EQ_STRING : EXPR_LT_STRING;
+			break;
+		}
+		return RC_OK;
+	}
+	return RC_RM_EXPR_NOT_COMPILABLE;
+}
+
+// compiles the operands of the top level AND one by one
+static RC
+emitConjuncts (Expr *expr, Schema *schema, ExprProgram *program)
+{
+	ExprConjunct *conjunct;
+	int pc;
+	RC rc;
+
+	if (expr->type == EXPR_OP && expr->expr.op->type == OP_BOOL_AND)
+	{
+		if ((rc = emitConjuncts(expr->expr.op->args[0], schema, program)) != RC_OK)
+			return rc;
+		return emitConjuncts(expr->expr.op->args[1], schema, program);
+	}
+	program->conjuncts = (ExprConjunct *) realloc(program->conjuncts,
+			(program->numConjuncts + 1) * sizeof(ExprConjunct));
+	conjunct = &program->conjuncts[program->numConjuncts];
+	memset(conjunct, 0, sizeof(ExprConjunct));
+	conjunct->position = program->numConjuncts;
+	conjunct->start = program->numInstr;
+	if ((rc = emitExpr(expr, schema, program)) != RC_OK)
+		return rc;
+	conjunct->end = program->numInstr;
+	for (pc = conjunct->start; pc < conjunct->end; pc++)
+	{
+		ExprOpcode opcode = program->code[pc].opcode;
+		if (opcode == EXPR_EQ_STRING || opcode == EXPR_LT_STRING)
+			conjunct->cost += EXPR_COST_STRING;
+		else if (opcode != EXPR_NOT && opcode != EXPR_JUMP_IF_FALSE && opcode != EXPR_JUMP_IF_TRUE)
+			conjunct->cost += EXPR_COST_SCALAR;
+	}
+	program->numConjuncts++;
+	return RC_OK;
+}
+
+// a conjunct goes before another one that rejects fewer records per unit
+// of cost, before any statistics the cheaper one goes first
+static bool
+conjunctBefore (ExprConjunct *a, ExprConjunct *b)
+{
+	double rankA, rankB;
+	if (a->evaluated == 0 || b->evaluated == 0)
+		return a->cost < b->cost;
+	rankA = (1.0 - (double) a->passed / a->evaluated) / a->cost;
+	rankB = (1.0 - (double) b->passed / b->evaluated) / b->cost;
+	return rankA > rankB;
+}
+
+static void
+orderConjuncts (ExprProgram *program)
+{
+	ExprConjunct conjunct;
+	int i, j;
+	for (i = 1; i < program->numConjuncts; i++)
+	{
+		conjunct = program->conjuncts[i];
+		for (j = i; j > 0 && conjunctBefore(&conjunct, &program->conjuncts[j - 1]); j--)
+			program->conjuncts[j] = program->conjuncts[j - 1];
+		program->conjuncts[j] = conjunct;
+	}
+}
+
+/**
+ * compiles a condition for records of a schema into code that evaluates
+ * it without allocating; type errors are reported here instead of while
+ * evaluating. The operands of the top level AND become conjuncts that
+ * runExprProgram() reorders by what it observes
+ */
+RC
+compileExpr (Expr *expr, Schema *schema, ExprProgram **program)
+{
+	RC rc;
+
+	*program = (ExprProgram *) calloc(1, sizeof(ExprProgram));
+	rc = emitConjuncts(expr, schema, *program);
+	if (rc != RC_OK)
+	{
+		freeExprProgram(*program);
+		*program = NULL;
+		return rc;
+	}
+	orderConjuncts(*program);
+	return RC_OK;
+}
+
+static inline int
+loadInt (ExprOperand *operand, char *data)
+{
+	int value;
+	if (operand->offset < 0)
+		return operand->v.intV;
+	memcpy(&value, data + operand->offset, sizeof(int));
+	return value;
+}
+
+static inline float
+loadFloat (ExprOperand *operand, char *data)
+{
+	float value;
+	if (operand->offset < 0)
+		return operand->v.floatV;
+	memcpy(&value, data + operand->offset, sizeof(float));
+	return value;
+}
+
+static inline bool
+loadBool (ExprOperand *operand, char *data)
+{
+	bool value;
+	if (operand->offset < 0)
+		return operand->v.boolV;
+	memcpy(&value, data + operand->offset, sizeof(bool));
+	return value;
+}
+
+// orders strings like strcmp, an attribute ends at its first NUL
+static inline int
+compareStrings (ExprOperand *left, ExprOperand *right, char *data)
+{
+	char *l = left->offset < 0 ? left->v.stringV : data + left->offset;
+	char *r = right->offset < 0 ? right->v.stringV : data + right->offset;
+	int llen = left->offset < 0 ? left->len : (int) strnlen(l, left->len);
+	int rlen = right->offset < 0 ? right->len : (int) strnlen(r, right->len);
+	int cmp = memcmp(l, r, llen < rlen ? llen : rlen);
+	return cmp != 0 ? cmp : llen - rlen;
+}
+
+static bool
+runCode (ExprInstr *code, int start, int end, char *data)
+{
+	bool value = FALSE;
+	int pc = start;
+
+	while (pc < end)
+	{
+		ExprInstr *instr = &code[pc++];
+		switch(instr->opcode)
+		{
+		case EXPR_LOAD_BOOL:
+			value = loadBool(&instr->left, data);
+			break;
+		case EXPR_EQ_INT:
+			value = loadInt(&instr->left, data) == loadInt(&instr->right, data);
+			break;
+		case EXPR_LT_INT:
+			value = loadInt(&instr->left, data) < loadInt(&instr->right, data);
+			break;
+		case EXPR_EQ_FLOAT:
+			value = loadFloat(&instr->left, data) == loadFloat(&instr->right, data);
+			break;
+		case EXPR_LT_FLOAT:
+			value = loadFloat(&instr->left, data) < loadFloat(&instr->right, data);
+			break;
+		case EXPR_EQ_BOOL:
+			value = loadBool(&instr->left, data) == loadBool(&instr->right, data);
+			break;
+		case EXPR_LT_BOOL:
+			value = loadBool(&instr->left, data) < loadBool(&instr->right, data);
+			break;
+		case EXPR_EQ_STRING:
+			value = compareStrings(&instr->left, &instr->right, data) == 0;
+			break;
+		case EXPR_LT_STRING:
+			value = compareStrings(&instr->left, &instr->right, data) < 0;
+			break;
+		case EXPR_NOT:
+			value = !value;
+			break;
+		case EXPR_JUMP_IF_FALSE:
+			if (!value)
+				pc = instr->target;
+			break;
+		case EXPR_JUMP_IF_TRUE:
+			if (value)
+				pc = instr->target;
+			break;
+		}
+	}
+	return value;
+}
+
+// the conjuncts stop at the first one that fails
+bool
+runExprProgram (ExprProgram *program, char *data)
+{
+	bool value = TRUE;
+	int i;
+
+	for (i = 0; i < program->numConjuncts; i++)
+	{
+		ExprConjunct *conjunct = &program->conjuncts[i];
+		conjunct->evaluated++;
+		if (!runCode(program->code, conjunct->start, conjunct->end, data))
+		{
+			value = FALSE;
+			break;
+		}
+		conjunct->passed++;
+	}
+	if (program->numConjuncts > 1 && ++program->runs % EXPR_REORDER_INTERVAL == 0)
+		orderConjuncts(program);
+	return value;
+}
+
+// batches: the same code over columns of n values into bitmaps, int and
+// float comparisons by the kernels of expr_kernels.c
+
+// every bit of rows 0..n-1 set to value
+static void
+fillBitmap (uint64_t *out, int n, bool value)
+{
+	memset(out, value ? 0xff : 0, BITMAP_WORDS(n) * sizeof(uint64_t));
+	if (value && (n & 63))
+		out[BITMAP_WORDS(n) - 1] = ((uint64_t) 1 << (n & 63)) - 1;
+}
+
+// an int or float comparison, a constant on the left is turned around
+static void
+compareNumberBatch (ExprInstr *instr, char **columns, int n, uint64_t *out, ExprCmp cmp, bool isFloat)
+{
+	ExprOperand *left = &instr->left, *right = &instr->right;
+	bool value;
+
+	if (left->attr < 0 && right->attr >= 0)
+	{
+		left = &instr->right;
+		right = &instr->left;
+		if (cmp == EXPR_CMP_LT)
+			cmp = EXPR_CMP_GT;
+	}
+	if (left->attr < 0)
+	{
+		if (isFloat)
+			value = cmp == EXPR_CMP_EQ ? left->v.floatV == right->v.floatV : left->v.floatV < right->v.floatV;
+		else
+			value = cmp == EXPR_CMP_EQ ? left->v.intV == right->v.intV : left->v.intV < right->v.intV;
+		fillBitmap(out, n, value);
+		return;
+	}
+	if (isFloat)
+		bitmapCompareFloat(cmp, (float *) columns[left->attr],
+				right->attr >= 0 ? (float *) columns[right->attr] : NULL, right->v.floatV, n, out);
+	else
+		bitmapCompareInt(cmp, (int *) columns[left->attr],
+				right->attr >= 0 ? (int *) columns[right->attr] : NULL, right->v.intV, n, out);
+}
+
+static inline bool
+boolAt (ExprOperand *operand, char **columns, int i)
+{
+	return operand->attr < 0 ? operand->v.boolV : ((bool *) columns[operand->attr])[i];
+}
+
+// a string operand of row i, an attribute ends at its first NUL
+static inline char *
+stringAt (ExprOperand *operand, char **columns, int i, int *len)
+{
+	char *str;
+	if (operand->attr < 0)
+	{
+		*len = operand->len;
+		return operand->v.stringV;
+	}
+	str = columns[operand->attr] + (long) i * operand->len;
+	*len = strnlen(str, operand->len);
+	return str;
+}
+
+static void
+compareStringBatch (ExprInstr *instr, char **columns, int n, uint64_t *out, bool smaller)
+{
+	int i, llen, rlen, cmp;
+	fillBitmap(out, n, FALSE);
+	for (i = 0; i < n; i++)
+	{
+		char *l = stringAt(&instr->left, columns, i, &llen);
+		char *r = stringAt(&instr->right, columns, i, &rlen);
+		cmp = memcmp(l, r, llen < rlen ? llen : rlen);
+		if (cmp == 0)
+			cmp = llen - rlen;
+		out[i >> 6] |= (uint64_t) (smaller ? cmp < 0 : cmp == 0) << (i & 63);
+	}
+}
+
+static void
+runCodeBatch (ExprProgram *program, int start, int end, char **columns, int n, uint64_t *out)
+{
+	uint64_t right[BITMAP_WORDS(n)];
+	int pc = start, i;
+
+	while (pc < end)
+	{
+		ExprInstr *instr = &program->code[pc++];
+		switch(instr->opcode)
+		{
+		case EXPR_LOAD_BOOL:
+			fillBitmap(out, n, FALSE);
+			for (i = 0; i < n; i++)
+				out[i >> 6] |= (uint64_t) boolAt(&instr->left, columns, i) << (i & 63);
+			break;
+		case EXPR_EQ_INT:
+			compareNumberBatch(instr, columns, n, out, EXPR_CMP_EQ, FALSE);
+			break;
+		case EXPR_LT_INT:
+			compareNumberBatch(instr, columns, n, out, EXPR_CMP_LT, FALSE);
+			break;
+		case EXPR_EQ_FLOAT:
+			compareNumberBatch(instr, columns, n, out, EXPR_CMP_EQ, TRUE);
+			break;
+		case EXPR_LT_FLOAT:
+			compareNumberBatch(instr, columns, n, out, EXPR_CMP_LT, TRUE);
+			break;
+		case EXPR_EQ_BOOL:
+		case EXPR_LT_BOOL:
+			fillBitmap(out, n, FALSE);
+			for (i = 0; i < n; i++)
+			{
+				bool l = boolAt(&instr->left, columns, i), r = boolAt(&instr->right, columns, i);
+				out[i >> 6] |= (uint64_t) (instr->opcode == EXPR_EQ_BOOL ? l == r : l < r) << (i & 63);
+			}
+			break;
+		case EXPR_EQ_STRING:
+			compareStringBatch(instr, columns, n, out, FALSE);
+			break;
+		case EXPR_LT_STRING:
+			compareStringBatch(instr, columns, n, out, TRUE);
+			break;
+		case EXPR_NOT:
+			bitmapNot(out, n);
+			break;
+		case EXPR_JUMP_IF_FALSE:
+		case EXPR_JUMP_IF_TRUE:
+			// no row skips anything, the operand up to the target is combined
+			runCodeBatch(program, pc, instr->target, columns, n, right);
+			if (instr->opcode == EXPR_JUMP_IF_FALSE)
+				bitmapAnd(out, right, n);
+			else
+				bitmapOr(out, right, n);
+			pc = instr->target;
+			break;
+		}
+	}
+}
+
+/**
+ * evaluates the program on n rows given as columns, one array of values
+ * per attribute laid out like Record.data; the selection gets the rows
+ * matching in increasing order. Conjuncts are counted and reordered as in
+ * runExprProgram(), a conjunct only counts the rows still selected
+ */
+int
+runExprProgramBatch (ExprProgram *program, char **columns, int n, int *selection)
+{
+	uint64_t match[BITMAP_WORDS(n)], value[BITMAP_WORDS(n)];
+	long before = program->runs;
+	int alive = n, c, w, k;
+
+	fillBitmap(match, n, TRUE);
+	for (c = 0; c < program->numConjuncts && alive > 0; c++)
+	{
+		ExprConjunct *conjunct = &program->conjuncts[c];
+		runCodeBatch(program, conjunct->start, conjunct->end, columns, n, value);
+		conjunct->evaluated += alive;
+		bitmapAnd(match, value, n);
+		alive = 0;
+		for (w = 0; w < BITMAP_WORDS(n); w++)
+			alive += __builtin_popcountll(match[w]);
+		conjunct->passed += alive;
+	}
+	program->runs += n;
+	if (program->numConjuncts > 1 && program->runs / EXPR_REORDER_INTERVAL != before / EXPR_REORDER_INTERVAL)
+		orderConjuncts(program);
+
+	// one step per selected row
+	for (w = 0, k = 0; w < BITMAP_WORDS(n); w++)
+	{
+		uint64_t bits = match[w];
+		while (bits)
+		{
+			selection[k++] = (w << 6) + __builtin_ctzll(bits);
+			bits &= bits - 1;
+		}
+	}
+	return k;
+}
+
+void
+freeExprProgram (ExprProgram *program)
+{
+	int i;
+	if (program == NULL)
+		return;
+	for (i = 0; i < program->numInstr; i++)
+	{
+		ExprInstr *instr = &program->code[i];
+		if ((instr->opcode == EXPR_EQ_STRING || instr->opcode == EXPR_LT_STRING))
+		{
+			if (instr->left.offset < 0)
+				free(instr->left.v.stringV);
+			if (instr->right.offset < 0)
+				free(instr->right.v.stringV);
+		}
+	}
+	free(program->conjuncts);
+	free(program->code);
+	free(program);
+}
+
 RC
 freeExpr (Expr *expr)
 {
@@ -1,6 +1,8 @@
 #ifndef EXPR_H
 #define EXPR_H
 
+#include <stdint.h>
+
 #include "dberror.h"
 #include "tables.h"
 
@@ -34,6 +36,84 @@ typedef struct Operator {
   Expr **args;
 } Operator;
 
+// compiled conditions: flat code whose comparisons read attributes straight
+// from Record.data by their precomputed offsets, see compileExpr(). Every
+// instruction sets or tests one boolean, AND and OR jump over the operand
+// they do not need
+typedef enum ExprOpcode {
+  EXPR_LOAD_BOOL,       // a boolean attribute or constant
+  EXPR_EQ_INT,
+  EXPR_LT_INT,
+  EXPR_EQ_FLOAT,
+  EXPR_LT_FLOAT,
+  EXPR_EQ_BOOL,
+  EXPR_LT_BOOL,
+  EXPR_EQ_STRING,
+  EXPR_LT_STRING,
+  EXPR_NOT,
+  EXPR_JUMP_IF_FALSE,   // to target
+  EXPR_JUMP_IF_TRUE
+} ExprOpcode;
+
+typedef struct ExprOperand {
+  int attr;         // attribute number, -1 for a constant
+  int offset;       // in Record.data, -1 for a constant
+  int len;          // bytes of a string attribute, length of a string constant
+  union {
+    int intV;
+    float floatV;
+    bool boolV;
+    char *stringV;  // owned by the program
+  } v;
+} ExprOperand;
+
+typedef struct ExprInstr {
+  ExprOpcode opcode;
+  int target;       // instruction a jump goes to
+  ExprOperand left;
+  ExprOperand right;
+} ExprInstr;
+
+// one operand of the top level AND of a condition, with the counters the
+// conjuncts are ordered by: the most records rejected per unit of cost first
+typedef struct ExprConjunct {
+  int position;     // among the conjuncts of the condition as written
+  int start;        // its code
+  int end;
+  int cost;         // EXPR_COST_* of its comparisons
+  long evaluated;
+  long passed;
+} ExprConjunct;
+
+#define EXPR_COST_SCALAR 1
+#define EXPR_COST_STRING 4
+// evaluations between two reorderings of the conjuncts
+#define EXPR_REORDER_INTERVAL 1024
+
+typedef struct ExprProgram {
+  int numInstr;
+  ExprInstr *code;
+  int numConjuncts;
+  ExprConjunct *conjuncts;  // in evaluation order
+  long runs;
+} ExprProgram;
+
+// bitmaps of batch scans, bit i of word i / 64 for row i
+#define BITMAP_WORDS(n) (((n) + 63) / 64)
+
+typedef enum ExprCmp {
+  EXPR_CMP_EQ = 0,
+  EXPR_CMP_LT = 1,
+  EXPR_CMP_GT = 2
+} ExprCmp;
+
+// comparison kernels, the widest the CPU has is used unless set lower
+typedef enum ExprKernelLevel {
+  EXPR_KERNELS_SCALAR = 0,
+  EXPR_KERNELS_SSE2 = 1,
+  EXPR_KERNELS_AVX2 = 2
+} ExprKernelLevel;
+
 // expression evaluation methods
 extern RC valueEquals (Value *left, Value *right, Value *result);
 extern RC valueSmaller (Value *left, Value *right, Value *result);
@@ -42,6 +122,19 @@ extern RC boolAnd (Value *left, Value *right, Value *result);
 extern RC boolOr (Value *left, Value *right, Value *result);
 extern RC evalExpr (Record *record, Schema *schema, Expr *expr, Value **result);
 extern RC freeExpr (Expr *expr);
+extern RC compileExpr (Expr *expr, Schema *schema, ExprProgram **program);
+extern bool runExprProgram (ExprProgram *program, char *data);
+extern int runExprProgramBatch (ExprProgram *program, char **columns, int n, int *selection);
+extern void freeExprProgram (ExprProgram *program);
+
+// bitmap kernels (expr_kernels.c)
+extern ExprKernelLevel setExprKernels (ExprKernelLevel level);
+extern ExprKernelLevel getExprKernels (void);
+extern void bitmapCompareInt (ExprCmp cmp, int *left, int *right, int c, int n, uint64_t *out);
+extern void bitmapCompareFloat (ExprCmp cmp, float *left, float *right, float c, int n, uint64_t *out);
+extern void bitmapAnd (uint64_t *out, uint64_t *in, int n);
+extern void bitmapOr (uint64_t *out, uint64_t *in, int n);
+extern void bitmapNot (uint64_t *out, int n);
 extern void freeVal(Value *val);
 
 
@@ -0,0 +1,355 @@
+#include <string.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define EXPR_KERNELS_X86 1
+#endif
+
+#include "expr.h"
+
+// comparison kernels of batch scans: int and float columns compared with
+// a column or a constant into bitmaps, bit i of word i / 64 for row i, and
+// AND/OR/NOT of bitmaps. Every level computes the same bits, the widest
+// one the CPU has is picked on first use
+
+typedef struct ExprKernels {
+	void (*compareInt) (ExprCmp cmp, int *left, int *right, int c, int n, uint64_t *out);
+	void (*compareFloat) (ExprCmp cmp, float *left, float *right, float c, int n, uint64_t *out);
+	void (*andBits) (uint64_t *out, uint64_t *in, int words);
+	void (*orBits) (uint64_t *out, uint64_t *in, int words);
+} ExprKernels;
+
+static ExprKernels *kernels = NULL;
+static ExprKernelLevel kernelLevel;
+
+// the bits of rows from..n-1, the kernels only do whole vectors
+#define COMPARE_TAIL(from, op)					\
+	for (i = (from); i < n; i++)						\
+		out[i >> 6] |= (uint64_t) ((right ? left[i] op right[i] : left[i] op c)) << (i & 63)
+
+#define COMPARE_SCALAR(op)						\
+	do {								\
+		int w, j;						\
+		for (w = 0; w < n >> 6; w++)				\
+		{							\
+			uint64_t bits = 0;				\
+			for (j = 0; j < 64; j++)			\
+			{						\
+				i = (w << 6) + j;			\
+				bits |= (uint64_t) (right ? left[i] op right[i] : left[i] op c) << j; \
+			}						\
+			out[w] = bits;					\
+		}							\
+		COMPARE_TAIL(w << 6, op);				\
+	} while (0)
+
+static void
+compareIntScalar (ExprCmp cmp, int *left, int *right, int c, int n, uint64_t *out)
+{
+	int i;
+	switch(cmp) {
+	case EXPR_CMP_EQ:
+		COMPARE_SCALAR(==);
+		break;
+	case EXPR_CMP_LT:
+		COMPARE_SCALAR(<);
+		break;
+	case EXPR_CMP_GT:
+		COMPARE_SCALAR(>);
+		break;
+	}
+}
+
+static void
+compareFloatScalar (ExprCmp cmp, float *left, float *right, float c, int n, uint64_t *out)
+{
+	int i;
+	switch(cmp) {
+	case EXPR_CMP_EQ:
+		COMPARE_SCALAR(==);
+		break;
+	case EXPR_CMP_LT:
+		COMPARE_SCALAR(<);
+		break;
+	case EXPR_CMP_GT:
+		COMPARE_SCALAR(>);
+		break;
+	}
+}
+
+static void
+andScalar (uint64_t *out, uint64_t *in, int words)
+{
+	int w;
+	for (w = 0; w < words; w++)
+		out[w] &= in[w];
+}
+
+static void
+orScalar (uint64_t *out, uint64_t *in, int words)
+{
+	int w;
+	for (w = 0; w < words; w++)
+		out[w] |= in[w];
+}
+
+static ExprKernels scalarKernels = { compareIntScalar, compareFloatScalar, andScalar, orScalar };
+
+#ifdef EXPR_KERNELS_X86
+
+// one vector of width values gives width bits written as a byte (8) or
+// a nibble (4, two vectors per byte); x86 is little endian so the bytes
+// of a bitmap word are in row order
+#define COMPARE_VECTORS(width, load, vcmp, mask, op)		\
+	do {								\
+		unsigned char *bytes = (unsigned char *) out;		\
+		int full = n & ~7;					\
+		for (i = 0; i < full; i += 8)				\
+		{							\
+			int bits = 0, k;				\
+			for (k = 0; k < 8; k += width)			\
+			{						\
+				__typeof__(load(left)) l = load(left + i + k); \
+				__typeof__(l) r = right ? load(right + i + k) : constant; \
+				bits |= mask(vcmp(l, r)) << k;		\
+			}						\
+			bytes[i >> 3] = bits;				\
+		}							\
+		COMPARE_TAIL(full, op);					\
+	} while (0)
+
+#define SSE2_INT_LOAD(p) _mm_loadu_si128((__m128i *) (p))
+#define SSE2_INT_MASK(v) _mm_movemask_ps(_mm_castsi128_ps(v))
+
+static void
+compareIntSse2 (ExprCmp cmp, int *left, int *right, int c, int n, uint64_t *out)
+{
+	__m128i constant = _mm_set1_epi32(c);
+	int i;
+	switch(cmp) {
+	case EXPR_CMP_EQ:
+		COMPARE_VECTORS(4, SSE2_INT_LOAD, _mm_cmpeq_epi32, SSE2_INT_MASK, ==);
+		break;
+	case EXPR_CMP_LT:
+		COMPARE_VECTORS(4, SSE2_INT_LOAD, _mm_cmplt_epi32, SSE2_INT_MASK, <);
+		break;
+	case EXPR_CMP_GT:
+		COMPARE_VECTORS(4, SSE2_INT_LOAD, _mm_cmpgt_epi32, SSE2_INT_MASK, >);
+		break;
+	}
+}
+
+static void
+compareFloatSse2 (ExprCmp cmp, float *left, float *right, float c, int n, uint64_t *out)
+{
+	__m128 constant = _mm_set1_ps(c);
+	int i;
+	switch(cmp) {
+	case EXPR_CMP_EQ:
+		COMPARE_VECTORS(4, _mm_loadu_ps, _mm_cmpeq_ps, _mm_movemask_ps, ==);
+		break;
+	case EXPR_CMP_LT:
+		COMPARE_VECTORS(4, _mm_loadu_ps, _mm_cmplt_ps, _mm_movemask_ps, <);
+		break;
+	case EXPR_CMP_GT:
+		COMPARE_VECTORS(4, _mm_loadu_ps, _mm_cmpgt_ps, _mm_movemask_ps, >);
+		break;
+	}
+}
+
+static void
+andSse2 (uint64_t *out, uint64_t *in, int words)
+{
+	int w;
+	for (w = 0; w + 2 <= words; w += 2)
+	{
+		__m128i a = _mm_loadu_si128((__m128i *) (out + w));
+		__m128i b = _mm_loadu_si128((__m128i *) (in + w));
+		_mm_storeu_si128((__m128i *) (out + w), _mm_and_si128(a, b));
+	}
+	andScalar(out + w, in + w, words - w);
+}
+
+static void
+orSse2 (uint64_t *out, uint64_t *in, int words)
+{
+	int w;
+	for (w = 0; w + 2 <= words; w += 2)
+	{
+		__m128i a = _mm_loadu_si128((__m128i *) (out + w));
+		__m128i b = _mm_loadu_si128((__m128i *) (in + w));
+		_mm_storeu_si128((__m128i *) (out + w), _mm_or_si128(a, b));
+	}
+	orScalar(out + w, in + w, words - w);
+}
+
+static ExprKernels sse2Kernels = { compareIntSse2, compareFloatSse2, andSse2, orSse2 };
+
+#define AVX2_INT_LOAD(p) _mm256_loadu_si256((__m256i *) (p))
+#define AVX2_INT_MASK(v) _mm256_movemask_ps(_mm256_castsi256_ps(v))
+#define AVX2_INT_LT(l, r) _mm256_cmpgt_epi32(r, l)
+#define AVX2_FLOAT_EQ(l, r) _mm256_cmp_ps(l, r, _CMP_EQ_OQ)
+#define AVX2_FLOAT_LT(l, r) _mm256_cmp_ps(l, r, _CMP_LT_OQ)
+#define AVX2_FLOAT_GT(l, r) _mm256_cmp_ps(l, r, _CMP_GT_OQ)
+
+__attribute__((target("avx2"))) static void
+compareIntAvx2 (ExprCmp cmp, int *left, int *right, int c, int n, uint64_t *out)
+{
+	__m256i constant = _mm256_set1_epi32(c);
+	int i;
+	switch(cmp) {
+	case EXPR_CMP_EQ:
+		COMPARE_VECTORS(8, AVX2_INT_LOAD, _mm256_cmpeq_epi32, AVX2_INT_MASK, ==);
+		break;
+	case EXPR_CMP_LT:
+		COMPARE_VECTORS(8, AVX2_INT_LOAD, AVX2_INT_LT, AVX2_INT_MASK, <);
+		break;
+	case EXPR_CMP_GT:
+		COMPARE_VECTORS(8, AVX2_INT_LOAD, _mm256_cmpgt_epi32, AVX2_INT_MASK, >);
+		break;
+	}
+}
+
+__attribute__((target("avx2"))) static void
+compareFloatAvx2 (ExprCmp cmp, float *left, float *right, float c, int n, uint64_t *out)
+{
+	__m256 constant = _mm256_set1_ps(c);
+	int i;
+	switch(cmp) {
+	case EXPR_CMP_EQ:
+		COMPARE_VECTORS(8, _mm256_loadu_ps, AVX2_FLOAT_EQ, _mm256_movemask_ps, ==);
+		break;
+	case EXPR_CMP_LT:
+		COMPARE_VECTORS(8, _mm256_loadu_ps, AVX2_FLOAT_LT, _mm256_movemask_ps, <);
+		break;
+	case EXPR_CMP_GT:
+		COMPARE_VECTORS(8, _mm256_loadu_ps, AVX2_FLOAT_GT, _mm256_movemask_ps, >);
+		break;
+	}
+}
+
+__attribute__((target("avx2"))) static void
+andAvx2 (uint64_t *out, uint64_t *in, int words)
+{
+	int w;
+	for (w = 0; w + 4 <= words; w += 4)
+	{
+		__m256i a = _mm256_loadu_si256((__m256i *) (out + w));
+		__m256i b = _mm256_loadu_si256((__m256i *) (in + w));
+		_mm256_storeu_si256((__m256i *) (out + w), _mm256_and_si256(a, b));
+	}
+	andScalar(out + w, in + w, words - w);
+}
+
+__attribute__((target("avx2"))) static void
+orAvx2 (uint64_t *out, uint64_t *in, int words)
+{
+	int w;
+	for (w = 0; w + 4 <= words; w += 4)
+	{
+		__m256i a = _mm256_loadu_si256((__m256i *) (out + w));
+		__m256i b = _mm256_loadu_si256((__m256i *) (in + w));
+		_mm256_storeu_si256((__m256i *) (out + w), _mm256_or_si256(a, b));
+	}
+	orScalar(out + w, in + w, words - w);
+}
+
+static ExprKernels avx2Kernels = { compareIntAvx2, compareFloatAvx2, andAvx2, orAvx2 };
+
+#endif
+
+// the widest level this CPU runs
+static ExprKernelLevel
+supportedKernels (void)
+{
+#ifdef EXPR_KERNELS_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return EXPR_KERNELS_AVX2;
+	if (__builtin_cpu_supports("sse2"))
+		return EXPR_KERNELS_SSE2;
+#endif
+	return EXPR_KERNELS_SCALAR;
+}
+
+/**
+ * picks the kernels of a level, a level the CPU does not have falls back
+ * to the widest one it has; returns the level in use
+ */
+ExprKernelLevel
+setExprKernels (ExprKernelLevel level)
+{
+	ExprKernelLevel supported = supportedKernels();
+	if (level > supported)
+		level = supported;
+	switch(level) {
+#ifdef EXPR_KERNELS_X86
+	case EXPR_KERNELS_AVX2:
+		kernels = &avx2Kernels;
+		break;
+	case EXPR_KERNELS_SSE2:
+		kernels = &sse2Kernels;
+		break;
+#endif
+	default:
+		level = EXPR_KERNELS_SCALAR;
+		kernels = &scalarKernels;
+		break;
+	}
+	kernelLevel = level;
+	return level;
+}
+
+ExprKernelLevel
+getExprKernels (void)
+{
+	if (!kernels)
+		setExprKernels(EXPR_KERNELS_AVX2);
+	return kernelLevel;
+}
+
+/**
+ * sets bit i of out to left[i] cmp right[i], or left[i] cmp c when right
+ * is NULL; out has (n + 63) / 64 words, the bits past n are cleared
+ */
+void
+bitmapCompareInt (ExprCmp cmp, int *left, int *right, int c, int n, uint64_t *out)
+{
+	getExprKernels();
+	memset(out, 0, BITMAP_WORDS(n) * sizeof(uint64_t));
+	kernels->compareInt(cmp, left, right, c, n, out);
+}
+
+void
+bitmapCompareFloat (ExprCmp cmp, float *left, float *right, float c, int n, uint64_t *out)
+{
+	getExprKernels();
+	memset(out, 0, BITMAP_WORDS(n) * sizeof(uint64_t));
+	kernels->compareFloat(cmp, left, right, c, n, out);
+}
+
+void
+bitmapAnd (uint64_t *out, uint64_t *in, int n)
+{
+	getExprKernels();
+	kernels->andBits(out, in, BITMAP_WORDS(n));
+}
+
+void
+bitmapOr (uint64_t *out, uint64_t *in, int n)
+{
+	getExprKernels();
+	kernels->orBits(out, in, BITMAP_WORDS(n));
+}
+
+// one pass the compiler vectorizes on its own
+void
+bitmapNot (uint64_t *out, int n)
+{
+	int w;
+	for (w = 0; w < BITMAP_WORDS(n); w++)
+		out[w] = ~out[w];
+	if (n & 63)
+		out[w - 1] &= ((uint64_t) 1 << (n & 63)) - 1;
+}
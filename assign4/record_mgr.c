@@ -8,9 +8,115 @@
 #include <string.h>
 #include <stdlib.h>
 
-int MAX_BUFFER_NUMS = 10;
 ReplacementStrategy REPLACE_STRATEGY = RS_LFU;
 
+RM_SchemaCacheEntry *schemaCache[RM_SCHEMA_CACHE_BUCKETS];
+
+/**
+ * @brief the cache bucket of a table name
+ * 
+ * @param name 
+ * @return RM_SchemaCacheEntry** 
+ */
+RM_SchemaCacheEntry **schemaCacheBucket (char *name) {
+	unsigned int hash = 5381;
+	while (*name) {
+		hash = hash * 33 + (unsigned char) *name++;
+	}
+	return &schemaCache[hash % RM_SCHEMA_CACHE_BUCKETS];
+}
+
+/**
+ * @brief finds the cached schema of a table and takes a reference on it
+ * 
+ * @param name 
+ * @return Schema* NULL on a miss
+ */
+Schema *acquireCachedSchema (char *name) {
+	RM_SchemaCacheEntry *entry;
+	for (entry = *schemaCacheBucket(name); entry; entry = entry->next) {
+		if (!entry->dropped && strcmp(entry->name, name) == 0) {
+			entry->refs += 1;
+			return entry->schema;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief adds the schema of an opened table to the cache, referenced once
+ * 
+ * @param name 
+ * @param schema 
+ */
+void cacheSchema (char *name, Schema *schema) {
+	RM_SchemaCacheEntry **bucket = schemaCacheBucket(name);
+	RM_SchemaCacheEntry *entry = (RM_SchemaCacheEntry *) malloc(sizeof(RM_SchemaCacheEntry));
+	entry->name = strdup(name);
+	entry->schema = schema;
+	entry->refs = 1;
+	entry->dropped = FALSE;
+	entry->next = *bucket;
+	*bucket = entry;
+}
+
+/**
+ * @brief frees the entries of a bucket nobody uses that match name (any with NULL)
+ * 
+ * @param bucket 
+ * @param name 
+ * @param dropped only entries marked dropped
+ */
+void evictSchemas (RM_SchemaCacheEntry **bucket, char *name, bool dropped) {
+	while (*bucket) {
+		RM_SchemaCacheEntry *entry = *bucket;
+		if (entry->refs == 0 && (!dropped || entry->dropped)
+				&& (!name || strcmp(entry->name, name) == 0)) {
+			*bucket = entry->next;
+			freeTableSchema(entry->schema);
+			free(entry->name);
+			free(entry);
+		} else {
+			bucket = &entry->next;
+		}
+	}
+}
+
+/**
+ * @brief gives back the reference of a closed table
+ * 
+ * @param name 
+ * @param schema 
+ */
+void releaseCachedSchema (char *name, Schema *schema) {
+	RM_SchemaCacheEntry **bucket = schemaCacheBucket(name);
+	RM_SchemaCacheEntry *entry;
+	for (entry = *bucket; entry; entry = entry->next) {
+		if (entry->schema == schema) {
+			entry->refs -= 1;
+			break;
+		}
+	}
+	evictSchemas(bucket, name, TRUE);
+}
+
+/**
+ * @brief forgets the schema of a table that is deleted or re-created,
+ *        it is freed once the last open handle closes
+ * 
+ * @param name 
+ */
+void dropCachedSchema (char *name) {
+	RM_SchemaCacheEntry **bucket = schemaCacheBucket(name);
+	RM_SchemaCacheEntry *entry;
+	for (entry = *bucket; entry; entry = entry->next) {
+		if (strcmp(entry->name, name) == 0) {
+			entry->dropped = TRUE;
+		}
+	}
+	evictSchemas(bucket, name, TRUE);
+}
+
 // table and manager
 /**
  * @brief initialize record manager
@@ -29,6 +135,10 @@ RC initRecordManager (void *mgmtData) {
  * @return RC 
  */
 RC shutdownRecordManager () {
+	int i;
+	for (i = 0; i < RM_SCHEMA_CACHE_BUCKETS; i++) {
+		evictSchemas(&schemaCache[i], NULL, FALSE);
+	}
 	shutdownStorageManager();
 	return RC_OK;
 }
@@ -66,6 +176,69 @@ int calcSlotLen (Schema *schema) {
 	return len;
 }
 
+/**
+ * @brief calculate how many records of recordSize fit on a slotted page
+ * 
+ * @param recordSize 
+ * @return int 
+ */
+int calcSlotMax (int recordSize) {
+	return (PAGE_SIZE - sizeof(RM_PageHeader)) / (recordSize + sizeof(RM_Slot));
+}
+
+/**
+ * @brief the free space map entry for a number of free bytes
+ * 
+ * @param freeBytes 
+ * @return unsigned char 
+ */
+unsigned char fsmCategory (int freeBytes) {
+	int category = freeBytes / RM_FSM_UNIT;
+	return category > 255 ? 255 : category;
+}
+
+/**
+ * @brief records the free space of a pinned data page in the map
+ * 
+ * @param mgmtData 
+ * @param pageNum 
+ * @param page 
+ */
+void fsmUpdate (RM_RecordMtdt *mgmtData, int pageNum, char *page) {
+	if (pageNum > RM_FSM_PAGES) {
+		return;
+	}
+	unsigned char category;
+	if (mgmtData->layout == RM_LAYOUT_PAX) {
+		category = fsmCategory(paxFreeSpace(page, mgmtData->slotMax, mgmtData->slotLen));
+	} else {
+		category = fsmCategory(pageFreeSpace(page, mgmtData->varLength ? 0 : mgmtData->slotLen));
+	}
+	mgmtData->fsm[pageNum - 1] = category;
+	if (pageNum < mgmtData->fsmHint && category >= fsmCategory(mgmtData->slotLen + sizeof(RM_Slot))) {
+		mgmtData->fsmHint = pageNum;
+	}
+}
+
+/**
+ * @brief finds a page the map says has room for a record of len bytes
+ * @details the hint only moves back when space is freed, so a run of
+ *          inserts looks at every full page once
+ * @param mgmtData 
+ * @param len 
+ * @return int the page, 0 if no tracked page has room
+ */
+int fsmFindPage (RM_RecordMtdt *mgmtData, int len) {
+	unsigned char need = fsmCategory(len + sizeof(RM_Slot));
+	int last = mgmtData->pageOffset < RM_FSM_PAGES ? mgmtData->pageOffset : RM_FSM_PAGES;
+	for (; mgmtData->fsmHint <= last; mgmtData->fsmHint++) {
+		if (mgmtData->fsm[mgmtData->fsmHint - 1] >= need) {
+			return mgmtData->fsmHint;
+		}
+	}
+	return 0;
+}
+
 /**
  * @brief write any string to Page File
  * 
@@ -94,359 +267,1627 @@ RC writeStrToPage(char *name, int pageNum, char *str) {
 }
 
 /**
- * @brief update table header
+ * @brief writes page 0 of a new table: the binary header and the free space map
  * 
  * @param name 
  * @param recordMtdt 
+ * @param schema 
  * @return RC 
  */
-RC writeTableHeader(char *name, RM_RecordMtdt *recordMtdt) {
-	char * headerStr = serializeRecordMtdt(recordMtdt);
-	writeStrToPage(name, 0, headerStr);
-	free(headerStr);
-	return RC_OK;
+RC writeTableHeader(char *name, RM_RecordMtdt *recordMtdt, Schema *schema) {
+	char page[PAGE_SIZE];
+	if (getTableHeaderSize(schema) > RM_FSM_OFFSET) {
+		return RC_RM_HEADER_TOO_LARGE;
+	}
+	memset(page, 0, PAGE_SIZE);
+	writeTableHeaderPage(page, recordMtdt, schema);
+	// the first data page is empty
+	page[RM_FSM_OFFSET] = fsmCategory(PAGE_SIZE - sizeof(RM_PageHeader));
+	return writeStrToPage(name, 0, page);
 }
 
 /**
- * @brief Create a Table object
+ * @brief Create a Table object, its records are stored row by row
  * 
  * @param name 
  * @param schema 
  * @return RC 
  */
 RC createTable (char *name, Schema *schema) {
+	return createTableWithLayout(name, schema, RM_LAYOUT_ROW);
+}
+
+/**
+ * @brief Create a Table object with the given page layout
+ * @details a RM_LAYOUT_PAX page keeps the values of each attribute together
+ *          in a minipage, scans only touch the attributes they read; it
+ *          holds as many records as a slotted page of the same table and
+ *          records are not encoded, whatever the schema
+ * @param name 
+ * @param schema 
+ * @param layout RM_LAYOUT_ROW or RM_LAYOUT_PAX
+ * @return RC 
+ */
+RC createTableWithLayout (char *name, Schema *schema, int layout) {
+	if (layout != RM_LAYOUT_ROW && layout != RM_LAYOUT_PAX) {
+		return RC_FAIL;
+	}
 	if (fexist(name)) {
         return RC_RM_TABLE_EXISTENCE;
     }
 	RC result;
 	RM_RecordMtdt *recordMtdt = (RM_RecordMtdt *) malloc(sizeof(RM_RecordMtdt));
 	
-	recordMtdt->slotLen = calcSlotLen(schema);
-	recordMtdt->schemaStr = serializeSchema(schema);
-	recordMtdt->schemaLen = strlen(recordMtdt->schemaStr);
+	dropCachedSchema(name);
+	dropZoneMap(name);
+	recordMtdt->version = RM_FORMAT_LAYOUT;
+	recordMtdt->layout = layout;
+	recordMtdt->varLength = layout == RM_LAYOUT_ROW && isVarLengthSchema(schema);
+	recordMtdt->slotLen = recordMtdt->varLength ? getMaxEncodedSize(schema) : getRecordSize(schema);
 	recordMtdt->slotOffset = 0;
 	// The storage of tuple starts from the 1th page
 	recordMtdt->pageOffset = 1;
 	recordMtdt->tupleLen = 0;
 	
 	// Todo: schema overflow new block
-	recordMtdt->slotMax = (int)(floor(PAGE_SIZE/recordMtdt->slotLen));
+	recordMtdt->slotMax = calcSlotMax(recordMtdt->slotLen);
 
-	result = writeTableHeader(name, recordMtdt);
-	free(recordMtdt->schemaStr);
+	result = writeTableHeader(name, recordMtdt, schema);
+	if (result == RC_OK) {
+		result = createIndex(name, schema);
+	}
+	if (result != RC_OK) {
+		destroyPageFile(name);
+	}
 	free(recordMtdt);
 	return result;
 }
 
 /**
- * @brief opens the table with the provided name
+ * @brief rewrites the text slots of a table created before slotted pages
+ * @details record ids stay the same, a binary record with its slot entry is
+ *          always smaller than the text slot it replaces
+ * @param rel 
+ * @return RC 
+ */
+RC migrateTextTable (RM_TableData *rel) {
+	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) rel->mgmtData;
+	BM_PageHandle *ph = mgmtData->ph;
+	BM_BufferPool *bm = mgmtData->bm;
+	int recordSize = getRecordSize(rel->schema);
+	int slotMax = calcSlotMax(recordSize);
+	char text[PAGE_SIZE];
+	char slotText[mgmtData->slotLen + 1];
+	Record *record;
+	int page, slot;
+
+	if (mgmtData->slotMax > slotMax) {
+		return RC_FAIL;
+	}
+	createRecord(&record, rel->schema);
+	for (page = 1; page <= mgmtData->pageOffset; page++) {
+		pinPage(bm, ph, page);
+		memcpy(text, ph->data, PAGE_SIZE);
+		initDataPage(ph->data);
+		RM_PageHeader *header = (RM_PageHeader *) ph->data;
+		RM_Slot *slots = PAGE_SLOTS(ph->data);
+		for (slot = 0; slot < mgmtData->slotMax; slot++) {
+			char *str = text + slot * mgmtData->slotLen;
+			slots[slot].offset = 0;
+			slots[slot].length = 0;
+			if (str[0] == 0 && str[1] == 0) {
+				continue;
+			}
+			memcpy(slotText, str, mgmtData->slotLen);
+			slotText[mgmtData->slotLen] = '\0';
+			getRecordDataFromSerialize(slotText, rel->schema, &record);
+			header->freeOffset -= recordSize;
+			slots[slot].offset = header->freeOffset;
+			slots[slot].length = recordSize;
+			memcpy(ph->data + header->freeOffset, record->data, recordSize);
+			header->numSlots = slot + 1;
+			header->liveSlots += 1;
+		}
+		markDirty(bm, ph);
+		unpinPage(bm, ph);
+	}
+	freeRecord(record);
+
+	mgmtData->version = RM_FORMAT_SLOTTED;
+	mgmtData->slotLen = recordSize;
+	mgmtData->slotMax = slotMax;
+	return RC_OK;
+}
+
+/**
+ * @brief builds the free space map of a table written without one
  * 
  * @param rel 
+ * @return RC 
+ */
+RC rebuildFreeSpaceMap (RM_TableData *rel) {
+	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) rel->mgmtData;
+	BM_PageHandle *ph = mgmtData->ph;
+	int page;
+
+	for (page = 1; page <= mgmtData->pageOffset && page <= RM_FSM_PAGES; page++) {
+		pinPage(mgmtData->bm, ph, page);
+		fsmUpdate(mgmtData, page, ph->data);
+		unpinPage(mgmtData->bm, ph);
+	}
+	mgmtData->fsmHint = 1;
+	mgmtData->version = RM_FORMAT_FSM;
+	return markDirty(mgmtData->bm, mgmtData->phSchema);
+}
+
+/**
+ * @brief rewrites the header of a table written before the current binary header
+ * @details the free space map behind the header stays where it is, older
+ *          tables keep their records row by row
+ * @param rel 
+ * @return RC 
+ */
+RC convertTableHeader (RM_TableData *rel) {
+	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) rel->mgmtData;
+	RC result = RC_OK;
+	if (mgmtData->version == RM_FORMAT_TEXT) {
+		result = migrateTextTable(rel);
+	}
+	if (result == RC_OK && mgmtData->version < RM_FORMAT_FSM) {
+		result = rebuildFreeSpaceMap(rel);
+	}
+	if (result != RC_OK) {
+		return result;
+	}
+	mgmtData->version = RM_FORMAT_LAYOUT;
+	mgmtData->layout = RM_LAYOUT_ROW;
+	memset(mgmtData->phSchema->data, 0, RM_FSM_OFFSET);
+	writeTableHeaderPage(mgmtData->phSchema->data, mgmtData, rel->schema);
+	return markDirty(mgmtData->bm, mgmtData->phSchema);
+}
+
+/**
+ * @brief opens the table with the provided name
+ * @details the schema of a table opened before is taken from the schema
+ *          cache; tables with a text header are converted, text slots are
+ *          migrated to slotted pages and a free space map is built if
+ *          missing. The zone map is read, or built from the records
+ * @param rel 
  * @param name 
  * @return RC 
  */
 RC openTable (RM_TableData *rel, char *name) {
+	return openTableWithFrames(rel, name, MAX_BUFFER_NUMS);
+}
+
+/**
+ * @brief undoes an open that failed after the header page was read, the
+ *        pool is shut down and the schema reference given back
+ * 
+ * @param rel 
+ * @param result the failure
+ * @return RC result
+ */
+static RC abandonTable (RM_TableData *rel, RC result) {
+	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) rel->mgmtData;
+	closeIndex(rel);
+	free(mgmtData->zones);
+	unpinPage(mgmtData->bm, mgmtData->phSchema);
+	shutdownBufferPool(mgmtData->bm);
+	free(mgmtData->bm);
+	free(mgmtData->ph);
+	free(mgmtData->phSchema);
+	free(mgmtData);
+	rel->mgmtData = NULL;
+	releaseCachedSchema(rel->name, rel->schema);
+	rel->schema = NULL;
+	return result;
+}
+
+/**
+ * @brief opens the table with the provided name and a buffer pool of the
+ *        given size
+ * @details the header page stays pinned while the table is open, a
+ *          parallelScan() needs two more frames for every worker
+ * @param rel 
+ * @param name 
+ * @param numFrames at least RM_MIN_BUFFER_NUMS
+ * @return RC on a failure nothing of the table is left open
+ */
+RC openTableWithFrames (RM_TableData *rel, char *name, int numFrames) {
+	if (numFrames < RM_MIN_BUFFER_NUMS) {
+		return RC_FAIL;
+	}
 	if (!fexist(name)) {
 		return RC_RM_TABLE_NOT_EXIST;
 	}
 	BM_BufferPool *bm = MAKE_POOL();
 	BM_PageHandle *ph = MAKE_PAGE_HANDLE();
 	BM_PageHandle *phSchema = MAKE_PAGE_HANDLE();
-  	initBufferPool(bm, name, MAX_BUFFER_NUMS, REPLACE_STRATEGY, NULL);
+	RM_RecordMtdt *mgmtData;
+	RC result = initBufferPool(bm, name, numFrames, REPLACE_STRATEGY, NULL);
 	
-	pinPage(bm, phSchema, 0);
-	RM_RecordMtdt *mgmtData = deserializeRecordMtdt(phSchema->data);
-	rel->schema = deserializeSchema(mgmtData->schemaStr);
+	if (result == RC_OK) {
+		result = pinPage(bm, phSchema, 0);
+		if (result != RC_OK) {
+			shutdownBufferPool(bm);
+		}
+	}
+	if (result != RC_OK) {
+		free(bm);
+		free(ph);
+		free(phSchema);
+		return result;
+	}
+	if (isBinaryTableHeader(phSchema->data)) {
+		mgmtData = readTableHeaderPage(phSchema->data);
+		rel->schema = acquireCachedSchema(name);
+		if (rel->schema == NULL) {
+			rel->schema = readTableSchema(phSchema->data);
+			cacheSchema(name, rel->schema);
+		}
+	} else {
+		mgmtData = deserializeRecordMtdt(phSchema->data);
+		rel->schema = deserializeSchema(mgmtData->schemaStr);
+		free(mgmtData->schemaStr);
+		mgmtData->schemaStr = NULL;
+		cacheSchema(name, rel->schema);
+	}
 	
 	mgmtData->bm = bm;
 	mgmtData->ph = ph;
 	mgmtData->phSchema = phSchema;
+	mgmtData->fsm = (unsigned char *) phSchema->data + RM_FSM_OFFSET;
+	mgmtData->fsmHint = 1;
+	mgmtData->zones = NULL;
+	mgmtData->index = NULL;
+	mgmtData->indexName = NULL;
 	rel->mgmtData = mgmtData;
 	rel->name = name;
+	if (mgmtData->version < RM_FORMAT_LAYOUT) {
+		if (getTableHeaderSize(rel->schema) > RM_FSM_OFFSET) {
+			result = RC_RM_HEADER_TOO_LARGE;
+		} else {
+			result = convertTableHeader(rel);
+		}
+	}
+	if (result == RC_OK) {
+		result = loadZoneMap(rel);
+	}
+	if (result == RC_OK) {
+		result = openIndex(rel);
+	}
+	if (result != RC_OK) {
+		return abandonTable(rel, result);
+	}
+	return RC_OK;
+}
+
+/**
+ * @brief close table and free mgmtData, the schema goes back to the schema cache
+ * 
+ * @param rel 
+ * @return RC 
+ */
+RC closeTable (RM_TableData *rel) {
+	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) rel->mgmtData;
+	saveZoneMap(rel);
+	closeIndex(rel);
+	// write back the counters of the header and close buffer pool
+	updateTableHeaderPage(mgmtData->phSchema->data, mgmtData);
+	markDirty(mgmtData->bm, mgmtData->phSchema);
+
+	unpinPage(mgmtData->bm, mgmtData->phSchema);
+	shutdownBufferPool(mgmtData->bm);
+	free(mgmtData->bm);
+	free(mgmtData->ph);
+	free(mgmtData->phSchema);
+	free(rel->mgmtData);
+	releaseCachedSchema(rel->name, rel->schema);
 	return RC_OK;
 }
 
 /**
- * @brief close table and free mgmtData and schema
+ * @brief deletes the table with given name
+ * 
+ * @param name 
+ * @return RC 
+ */
+RC deleteTable (char *name) {
+	dropCachedSchema(name);
+	dropZoneMap(name);
+	dropIndex(name);
+	return destroyPageFile(name);
+}
+
+/**
+ * @brief Get the Num Tuples object
+ * 
+ * @param rel 
+ * @return int 
+ */
+int getNumTuples (RM_TableData *rel) {
+	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) rel->mgmtData;
+	return mgmtData->tupleLen;
+}
+
+/**
+ * @brief the bytes a record is stored as: the record itself, or its
+ *        encoding in a variable length table
+ * 
+ * @param rel 
+ * @param data 
+ * @param buf slotLen bytes
+ * @param len set to the stored length
+ * @return char* 
+ */
+char *recordBytes (RM_TableData *rel, char *data, char *buf, int *len) {
+	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) rel->mgmtData;
+	if (!mgmtData->varLength) {
+		*len = mgmtData->slotLen;
+		return data;
+	}
+	*len = encodeRecord(rel->schema, data, buf);
+	return buf;
+}
+
+/**
+ * @brief stores record bytes on a pinned data page in the layout of the table
  * 
  * @param rel 
+ * @param page 
+ * @param data 
+ * @param len 
+ * @return int the slot, -1 if the page is full
+ */
+int storeRecord (RM_TableData *rel, char *page, char *data, int len) {
+	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) rel->mgmtData;
+	if (mgmtData->layout == RM_LAYOUT_PAX) {
+		return paxInsertRecord(page, rel->schema, mgmtData->slotMax, data);
+	}
+	return pageInsertRecord(page, data, len);
+}
+
+/**
+ * @brief stores record bytes on a page with room for them
+ * @details the free space map picks the first page with room, a hole left
+ *          by a deleted record is filled before the table grows; a new page
+ *          is started when no page has room
+ * @param rel 
+ * @param data 
+ * @param len 
+ * @param flags RM_SLOT_* flags of the new slot
+ * @param id set to where the bytes went
+ * @return RC the error of pinPage() when a page does not pin, nothing is stored then
+ */
+RC placeRecord (RM_TableData *rel, char *data, int len, int flags, RID *id) {
+	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) rel->mgmtData;
+	BM_BufferPool *bm = mgmtData->bm;
+	BM_PageHandle ph;
+	int page, slot = -1;
+	RC result;
+
+	while (slot < 0 && (page = fsmFindPage(mgmtData, len)) > 0) {
+		result = pinPage(bm, &ph, page);
+		if (result != RC_OK) {
+			return result;
+		}
+		slot = storeRecord(rel, ph.data, data, len);
+		if (slot < 0) {
+			// the map rounds down, the space left was just too small
+			unpinPage(bm, &ph);
+			mgmtData->fsmHint = page + 1;
+		}
+	}
+	// the last page is not in the map once the table outgrew it
+	if (slot < 0 && mgmtData->pageOffset > RM_FSM_PAGES) {
+		page = mgmtData->pageOffset;
+		result = pinPage(bm, &ph, page);
+		if (result != RC_OK) {
+			return result;
+		}
+		slot = storeRecord(rel, ph.data, data, len);
+		if (slot < 0) {
+			unpinPage(bm, &ph);
+		}
+	}
+	if (slot < 0) {
+		page = mgmtData->pageOffset + 1;
+		result = pinPage(bm, &ph, page);
+		if (result != RC_OK) {
+			return result;
+		}
+		mgmtData->pageOffset = page;
+		initDataPage(ph.data);
+		slot = storeRecord(rel, ph.data, data, len);
+	}
+	PAGE_SLOTS(ph.data)[slot].length |= flags;
+	id->page = page;
+	id->slot = slot;
+	mgmtData->slotOffset = ((RM_PageHeader *) ph.data)->numSlots;
+	fsmUpdate(mgmtData, page, ph.data);
+
+	markDirty(bm, &ph);
+	return unpinPage(bm, &ph);
+}
+
+/**
+ * @brief pins the page holding the bytes of a record, through its forwarding slot
+ * @details a moved record is only found from its own slot
+ * @param mgmtData 
+ * @param id 
+ * @param ph pinned on RC_OK only
+ * @param slot set to the slot holding the bytes
+ * @return RC 
+ */
+RC pinRecord (RM_RecordMtdt *mgmtData, RID id, BM_PageHandle *ph, RM_Slot **slot) {
+	BM_BufferPool *bm = mgmtData->bm;
+	RID target;
+
+	if (id.page < 1 || id.page > mgmtData->pageOffset) {
+		return RC_RM_NO_MORE_TUPLES;
+	}
+	RC result = pinPage(bm, ph, id.page);
+	if (result != RC_OK) {
+		return result;
+	}
+	result = pageFindRecord(ph->data, id.slot, slot);
+	if (result == RC_OK && ((*slot)->length & RM_SLOT_MOVED)) {
+		result = RC_RM_DELETED_TUPLES;
+	}
+	if (result == RC_OK && ((*slot)->length & RM_SLOT_FORWARD)) {
+		memcpy(&target, ph->data + (*slot)->offset, sizeof(RID));
+		unpinPage(bm, ph);
+		result = pinPage(bm, ph, target.page);
+		if (result != RC_OK) {
+			return result;
+		}
+		result = pageFindRecord(ph->data, target.slot, slot);
+	}
+	if (result != RC_OK) {
+		unpinPage(bm, ph);
+	}
+	return result;
+}
+
+/**
+ * @brief inserts a record to the table
+ * 
+ * @param rel 
+ * @param record 
+ * @return RC 
+ */
+RC insertRecord (RM_TableData *rel, Record *record) {
+	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) rel->mgmtData;
+	char buf[mgmtData->slotLen];
+	int len;
+	char *data = recordBytes(rel, record->data, buf, &len);
+
+	RC result = indexAddKey(rel, record->data, RM_INDEX_PENDING);
+	if (result != RC_OK) {
+		return result;
+	}
+	result = placeRecord(rel, data, len, 0, &record->id);
+	if (result == RC_OK) {
+		mgmtData->tupleLen += 1;
+		zoneAddRecord(mgmtData, rel->schema, record->id.page, record->data);
+	}
+	indexSetKeys(rel, &record, result == RC_OK, 1);
+	return result;
+}
+
+/**
+ * @brief places records on a data page until the next one does not fit
+ * 
+ * @param rel 
+ * @param page 
+ * @param pageNum 
+ * @param records 
+ * @param from first record to place
+ * @param n 
+ * @param rids set for every record placed, may be NULL
+ * @return int the first record left over
+ */
+int fillDataPage (RM_TableData *rel, char *page, int pageNum, Record **records, int from, int n, RID *rids) {
+	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) rel->mgmtData;
+	char buf[mgmtData->slotLen];
+	int len, slot;
+	for (; from < n; from++) {
+		char *data = recordBytes(rel, records[from]->data, buf, &len);
+		slot = storeRecord(rel, page, data, len);
+		if (slot < 0) {
+			break;
+		}
+		records[from]->id.page = pageNum;
+		records[from]->id.slot = slot;
+		zoneAddRecord(mgmtData, rel->schema, pageNum, records[from]->data);
+		if (rids) {
+			rids[from] = records[from]->id;
+		}
+	}
+	return from;
+}
+
+/**
+ * @brief inserts n records, every page is pinned once
+ * @details pages the free space map has room on are filled first, the
+ *          rest goes on new pages built outside the buffer pool and written
+ *          RM_BULK_PAGES at a time; the counters of the table change once
+ *          per page
+ * @param rel 
+ * @param records their ids are set
+ * @param n 
+ * @param rids the ids as well, may be NULL
+ * @return RC RC_FAIL for a record larger than an empty page; the records
+ *         before it are inserted, it and those after it are not. A failed
+ *         write leaves out every record of its chunk, their ids and rids
+ *         are set to page and slot -1. A page that does not pin stops the
+ *         insert with the error of pinPage(), like an oversized record
+ */
+RC insertRecords (RM_TableData *rel, Record **records, int n, RID *rids) {
+	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) rel->mgmtData;
+	BM_BufferPool *bm = mgmtData->bm;
+	BM_PageHandle ph;
+	char buf[mgmtData->slotLen];
+	char *pages[RM_BULK_PAGES];
+	char *memory = NULL;
+	int i = 0, next, page, len, count, triedLast = FALSE;
+	RC result = RC_OK, written;
+
+	// keys are checked before anything is placed, a duplicate leaves the table as it was
+	for (i = 0; i < n; i++) {
+		result = indexAddKey(rel, records[i]->data, RM_INDEX_PENDING);
+		if (result != RC_OK) {
+			indexSetKeys(rel, records, 0, i);
+			return result;
+		}
+	}
+	i = 0;
+	while (i < n) {
+		recordBytes(rel, records[i]->data, buf, &len);
+		page = fsmFindPage(mgmtData, len);
+		// the last page is not in the map once the table outgrew it
+		if (page == 0 && mgmtData->pageOffset > RM_FSM_PAGES && !triedLast) {
+			page = mgmtData->pageOffset;
+			triedLast = TRUE;
+		}
+		if (page == 0) {
+			break;
+		}
+		result = pinPage(bm, &ph, page);
+		if (result != RC_OK) {
+			break;
+		}
+		next = fillDataPage(rel, ph.data, page, records, i, n, rids);
+		if (next == i) {
+			// the map rounds down, the space left was just too small
+			mgmtData->fsmHint = page + 1;
+		} else {
+			fsmUpdate(mgmtData, page, ph.data);
+			mgmtData->slotOffset = ((RM_PageHeader *) ph.data)->numSlots;
+			mgmtData->tupleLen += next - i;
+			markDirty(bm, &ph);
+		}
+		unpinPage(bm, &ph);
+		i = next;
+	}
+
+	if (i < n) {
+		memory = (char *) malloc(RM_BULK_PAGES * PAGE_SIZE);
+		for (count = 0; count < RM_BULK_PAGES; count++) {
+			pages[count] = memory + count * PAGE_SIZE;
+		}
+	}
+	while (i < n && result == RC_OK) {
+		int first = i;
+		for (count = 0; count < RM_BULK_PAGES && i < n; count++) {
+			memset(pages[count], 0, PAGE_SIZE);
+			initDataPage(pages[count]);
+			next = fillDataPage(rel, pages[count], mgmtData->pageOffset + 1 + count, records, i, n, rids);
+			if (next == i) {
+				// a record larger than an empty page, the pages filled before it are kept
+				result = RC_FAIL;
+				break;
+			}
+			i = next;
+		}
+		if (count == 0) {
+			break;
+		}
+		written = writePagesDirect(bm, mgmtData->pageOffset + 1, count, pages);
+		if (written != RC_OK) {
+			// the records of the chunk are not in the table, nor in the zones of its pages
+			for (next = first; next < i; next++) {
+				zoneRemoveRecord(mgmtData, records[next]->id.page);
+				records[next]->id.page = -1;
+				records[next]->id.slot = -1;
+				if (rids) {
+					rids[next] = records[next]->id;
+				}
+			}
+			i = first;
+			result = written;
+			break;
+		}
+		for (page = 0; page < count; page++) {
+			fsmUpdate(mgmtData, mgmtData->pageOffset + 1 + page, pages[page]);
+		}
+		mgmtData->slotOffset = ((RM_PageHeader *) pages[count - 1])->numSlots;
+		mgmtData->pageOffset += count;
+		mgmtData->tupleLen += i - first;
+	}
+	free(memory);
+	indexSetKeys(rel, records, i, n);
+	return result;
+}
+
+/**
+ * @brief deletes a record from the table
+ * @details the slot is marked free and the page's room goes back to the
+ *          free space map, the other records keep their place; a moved
+ *          record is deleted together with its forwarding slot
+ * @param rel 
+ * @param id 
+ * @return RC 
+ */
+RC deleteRecord (RM_TableData *rel, RID id) {
+	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) rel->mgmtData;
+	BM_PageHandle *ph = mgmtData->ph;
+	BM_BufferPool *bm = mgmtData->bm;
+	BM_PageHandle moved;
+	RM_Slot *slot;
+	RID target;
+	Record stored;
+	char storedData[getRecordSize(rel->schema)];
+
+	if (id.page < 1 || id.page > mgmtData->pageOffset) {
+		return RC_RM_NO_MORE_TUPLES;
+	}
+	// the key of the record leaves the index with it
+	stored.data = storedData;
+	if (mgmtData->index && getRecord(rel, id, &stored) != RC_OK) {
+		stored.data = NULL;
+	}
+	RC result = pinPage(bm, ph, id.page);
+	if (result != RC_OK) {
+		return result;
+	}
+	result = pageFindRecord(ph->data, id.slot, &slot);
+	if (result == RC_OK && (slot->length & RM_SLOT_MOVED)) {
+		result = RC_RM_DELETED_TUPLES;
+	}
+	if (result == RC_OK && (slot->length & RM_SLOT_FORWARD)) {
+		memcpy(&target, ph->data + slot->offset, sizeof(RID));
+		result = pinPage(bm, &moved, target.page);
+	}
+	if (result == RC_OK) {
+		if (slot->length & RM_SLOT_FORWARD) {
+			pageDeleteRecord(moved.data, target.slot);
+			fsmUpdate(mgmtData, target.page, moved.data);
+			markDirty(bm, &moved);
+			unpinPage(bm, &moved);
+		}
+		pageDeleteRecord(ph->data, id.slot);
+		mgmtData->tupleLen -= 1;
+		zoneRemoveRecord(mgmtData, id.page);
+		if (stored.data) {
+			indexRemoveKey(rel, stored.data);
+		}
+		fsmUpdate(mgmtData, id.page, ph->data);
+		markDirty(bm, ph);
+	}
+	unpinPage(bm, ph);
+	return result;
+}
+
+/**
+ * @brief updates table in a record
+ * @details a grown record that no longer fits its page moves to another
+ *          page, its slot keeps the RID it moved to so record ids stay valid
+ * @param rel
+ * @param record 
+ * @return RC 
+ */
+RC updateRecord (RM_TableData *rel, Record *record) {
+	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) rel->mgmtData;
+	BM_PageHandle *ph = mgmtData->ph;
+	BM_BufferPool *bm = mgmtData->bm;
+	BM_PageHandle moved;
+	RM_Slot *slot;
+	RID id = record->id, target, placed;
+	Record stored;
+	char buf[mgmtData->slotLen];
+	char storedData[getRecordSize(rel->schema)];
+	int len;
+	char *data = recordBytes(rel, record->data, buf, &len);
+
+	if (id.page < 1 || id.page > mgmtData->pageOffset) {
+		return RC_RM_NO_MORE_TUPLES;
+	}
+	// a new key must not belong to another record, the index follows once the record is written
+	if (mgmtData->index) {
+		stored.data = storedData;
+		RC checked = getRecord(rel, id, &stored);
+		if (checked == RC_OK) {
+			checked = indexCheckKey(rel, record->data, id);
+		}
+		if (checked != RC_OK) {
+			return checked;
+		}
+	}
+	RC result = pinPage(bm, ph, id.page);
+	if (result != RC_OK) {
+		return result;
+	}
+	result = pageFindRecord(ph->data, id.slot, &slot);
+	if (result == RC_OK && (slot->length & RM_SLOT_MOVED)) {
+		result = RC_RM_DELETED_TUPLES;
+	}
+	if (result == RC_OK && (slot->length & RM_SLOT_FORWARD)) {
+		memcpy(&target, ph->data + slot->offset, sizeof(RID));
+		result = pinPage(bm, &moved, target.page);
+	}
+	if (result != RC_OK) {
+		unpinPage(bm, ph);
+		return result;
+	}
+	// a moved record is scanned from the page of its id
+	zoneWiden(mgmtData, rel->schema, id.page, record->data);
+	if (mgmtData->layout == RM_LAYOUT_PAX) {
+		// a record of a PAX table always fits its slot
+		paxWriteRecord(ph->data, rel->schema, mgmtData->slotMax, id.slot, record->data);
+	} else if (!(slot->length & RM_SLOT_FORWARD)) {
+		if (pageReplaceRecord(ph->data, id.slot, data, len) != RC_OK) {
+			// leave the new location behind, a stored record is never shorter than a RID;
+			// the old record stays if there is no room anywhere
+			result = placeRecord(rel, data, len, RM_SLOT_MOVED, &target);
+			if (result == RC_OK) {
+				pageReplaceRecord(ph->data, id.slot, (char *) &target, sizeof(RID));
+				PAGE_SLOTS(ph->data)[id.slot].length |= RM_SLOT_FORWARD;
+			}
+		}
+	} else {
+		if (pageReplaceRecord(moved.data, target.slot, data, len) != RC_OK) {
+			// the old bytes are only freed once the record has its new place
+			result = placeRecord(rel, data, len, RM_SLOT_MOVED, &placed);
+			if (result == RC_OK) {
+				pageDeleteRecord(moved.data, target.slot);
+				memcpy(ph->data + PAGE_SLOTS(ph->data)[id.slot].offset, &placed, sizeof(RID));
+			}
+		}
+		fsmUpdate(mgmtData, target.page, moved.data);
+		markDirty(bm, &moved);
+		unpinPage(bm, &moved);
+	}
+	fsmUpdate(mgmtData, id.page, ph->data);
+	markDirty(bm, ph);
+	unpinPage(bm, ph);
+	if (result == RC_OK && mgmtData->index) {
+		result = indexChangeKey(rel, stored.data, record->data, id);
+	}
+	return result;
+}
+
+/**
+ * @brief gets data from serialize, only text slots of old tables are parsed
+ * 
+ * @param mgmtData 
+ * @return RC 
+ */
+RC getRecordDataFromSerialize(char *str, Schema *schema, Record **result) {
+	// [1-0] (a:0,b:aaaa,c:3)
+	char *temp;
+	int i;
+	char strcp[strlen(str) + 1];
+
+	// (*result)->data = (char *) malloc(getRecordSize(schema));
+	strcpy(strcp, str);
+	strtok(strcp, "(");
+
+	for (i = 0; i < schema->numAttr; i++) {
+		strtok(NULL, ":");
+		char *delim = (i == schema->numAttr - 1) ? ")" : ",";
+		Value *value = (Value *) malloc(sizeof(Value));
+		value->dt = schema->dataTypes[i];
+		if (schema->dataTypes[i] == DT_INT) {
+			value->v.intV = strtoi(delim, 1);
+		} else if (schema->dataTypes[i] == DT_BOOL) {
+			temp = strtok(NULL, delim);
+			value->v.boolV = temp[0] == 't' ? TRUE : FALSE;
+		} else if (schema->dataTypes[i] == DT_FLOAT) {
+			temp = strtok(NULL, delim);
+			value->v.floatV = strtof(temp, NULL);
+		} else if (schema->dataTypes[i] == DT_STRING) {
+			value->v.stringV = strtochar(delim, 1);
+		}
+		setAttr(*result, schema, i, value);
+		freeVal(value);
+	}
+	return RC_OK;
+}
+
+/**
+ * @brief gets a record from a provided table and RID 
+ * 
+ * @param rel
+ * @param id
+ * @param record 
+ * @return RC 
+ */
+RC getRecord (RM_TableData *rel, RID id, Record *record) {
+	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) rel->mgmtData;
+	// a handle of its own, workers of a parallel scan read at the same time
+	BM_PageHandle page;
+	BM_PageHandle *ph = &page;
+	RM_Slot *slot;
+
+	RC result = pinRecord(mgmtData, id, ph, &slot);
+	if (result != RC_OK) {
+		return result;
+	}
+	if (mgmtData->layout == RM_LAYOUT_PAX) {
+		paxReadRecord(ph->data, rel->schema, mgmtData->slotMax, id.slot, record->data, NULL);
+	} else if (mgmtData->varLength) {
+		decodeRecord(rel->schema, ph->data + slot->offset, record->data);
+	} else {
+		memcpy(record->data, ph->data + slot->offset, RM_SLOT_LENGTH(slot));
+	}
+	record->id.page = id.page;
+	record->id.slot = id.slot;
+	return unpinPage(mgmtData->bm, ph);
+}
+
+/**
+ * @brief pins the page of a record and points ref at the record inside it
+ * @details nothing is copied, the data stays valid until releaseRecordRef();
+ *          every ref holds a pin, so a caller holds at most as many refs
+ *          as the table's pool has frames. Records of variable length
+ *          tables are decoded, those of PAX tables gathered, into a copy
+ *          owned by the ref
+ * @param rel
+ * @param id
+ * @param ref 
+ * @return RC the error of pinPage() when no frame is free
+ */
+RC getRecordRef (RM_TableData *rel, RID id, RM_RecordRef *ref) {
+	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) rel->mgmtData;
+	RM_Slot *slot;
+
+	RC result = pinRecord(mgmtData, id, &ref->page, &slot);
+	if (result != RC_OK) {
+		return result;
+	}
+	ref->record.id = id;
+	ref->copy = NULL;
+	ref->record.data = ref->page.data + slot->offset;
+	if (mgmtData->layout == RM_LAYOUT_PAX) {
+		ref->copy = (char *) malloc(getRecordSize(rel->schema));
+		paxReadRecord(ref->page.data, rel->schema, mgmtData->slotMax, id.slot, ref->copy, NULL);
+		ref->record.data = ref->copy;
+	} else if (mgmtData->varLength) {
+		ref->copy = (char *) malloc(getRecordSize(rel->schema));
+		decodeRecord(rel->schema, ref->record.data, ref->copy);
+		ref->record.data = ref->copy;
+	}
+	return RC_OK;
+}
+
+/**
+ * @brief unpins the page behind a ref taken with getRecordRef()
+ * 
+ * @param rel
+ * @param ref 
+ * @return RC 
+ */
+RC releaseRecordRef (RM_TableData *rel, RM_RecordRef *ref) {
+	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) rel->mgmtData;
+	free(ref->copy);
+	ref->copy = NULL;
+	ref->record.data = NULL;
+	return unpinPage(mgmtData->bm, &ref->page);
+}
+
+/**
+ * @brief gets the record with the given values of the key attributes
+ * @details the primary key index is probed; a table that has no index,
+ *          because two of its records share a key, is scanned instead
+ * @param rel
+ * @param key one value per key attribute, in the order of schema->keyAttrs
+ * @param record
+ * @return RC RC_IM_KEY_NOT_FOUND if no record has the key
+ */
+RC getRecordByKey (RM_TableData *rel, Value **key, Record *record) {
+	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) rel->mgmtData;
+	Schema *schema = rel->schema;
+	RM_ScanHandle scan;
+	Expr *cond = NULL, *attr, *value, *equal, *both;
+	Value *indexed;
+	RID id;
+	RC result;
+	int i;
+
+	if (schema->keySize == 0) {
+		return RC_IM_KEY_NOT_FOUND;
+	}
+	for (i = 0; i < schema->keySize; i++) {
+		if (key[i]->dt != schema->dataTypes[schema->keyAttrs[i]]) {
+			return RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE;
+		}
+	}
+	if (mgmtData->index) {
+		indexed = indexKey(schema, key);
+		result = findKey(mgmtData->index, indexed, &id);
+		freeVal(indexed);
+		return result == RC_OK ? getRecord(rel, id, record) : RC_IM_KEY_NOT_FOUND;
+	}
+
+	for (i = 0; i < schema->keySize; i++) {
+		MAKE_ATTRREF(attr, schema->keyAttrs[i]);
+		MAKE_CONS(value, copyKey(key[i]));
+		MAKE_BINOP_EXPR(equal, attr, value, OP_COMP_EQUAL);
+		if (cond == NULL) {
+			cond = equal;
+		} else {
+			MAKE_BINOP_EXPR(both, cond, equal, OP_BOOL_AND);
+			cond = both;
+		}
+	}
+	startScan(rel, &scan, cond);
+	result = next(&scan, record);
+	closeScan(&scan);
+	freeExpr(cond);
+	return result == RC_RM_NO_MORE_TUPLES ? RC_IM_KEY_NOT_FOUND : result;
+}
+
+//scan
+/**
+ * @brief initializes a new scan
+ * 
+ * @param rel
+ * @param scan
+ * @param cond 
+ * @return RC 
+ */
+RC startScan (RM_TableData *rel, RM_ScanHandle *scan, Expr *cond) {
+	return startProjectedScan(rel, scan, cond, 0, NULL);
+}
+
+/**
+ * @brief marks the attributes an expression reads
+ * 
+ * @param expr
+ * @param numAttr
+ * @param attrs
+ * @return void
+ */
+static void markExprAttrs (Expr *expr, int numAttr, bool *attrs) {
+	Operator *op;
+	switch (expr->type) {
+	case EXPR_ATTRREF:
+		if (expr->expr.attrRef >= 0 && expr->expr.attrRef < numAttr) {
+			attrs[expr->expr.attrRef] = TRUE;
+		}
+		break;
+	case EXPR_OP:
+		op = expr->expr.op;
+		markExprAttrs(op->args[0], numAttr, attrs);
+		if (op->type != OP_BOOL_NOT) {
+			markExprAttrs(op->args[1], numAttr, attrs);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * @brief initializes a new scan that only reads some attributes
+ * @details next() and nextBatch() fill in the projected attributes, the
+ *          other bytes of the record or columns are left as they were;
+ *          records of variable length tables only decode the projected
+ *          attributes and those of the condition
+ * @param rel
+ * @param scan
+ * @param cond 
+ * @param numAttrs
+ * @param attrs attribute numbers, NULL reads all of them
+ * @return RC RC_RM_UNKOWN_DATATYPE for an attribute not in the schema
+ */
+RC startProjectedScan (RM_TableData *rel, RM_ScanHandle *scan, Expr *cond, int numAttrs, int *attrs) {
+	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) rel->mgmtData;
+	int numAttr = rel->schema->numAttr, i;
+	for (i = 0; attrs && i < numAttrs; i++) {
+		if (attrs[i] < 0 || attrs[i] >= numAttr) {
+			return RC_RM_UNKOWN_DATATYPE;
+		}
+	}
+	RM_ScanMtdt *scanMtdt = (RM_ScanMtdt *) malloc(sizeof(RM_ScanMtdt));
+	scanMtdt->expr = cond;
+	scanMtdt->program = NULL;
+	if (cond) {
+		RC result = compileExpr(cond, rel->schema, &scanMtdt->program);
+		if (result != RC_OK && result != RC_RM_EXPR_NOT_COMPILABLE) {
+			free(scanMtdt);
+			return result;
+		}
+	}
+	scanMtdt->numProjected = numAttr;
+	scanMtdt->projected = NULL;
+	scanMtdt->loaded = NULL;
+	if (attrs) {
+		// in schema order, each attribute once
+		scanMtdt->loaded = (bool *) calloc(numAttr, sizeof(bool));
+		scanMtdt->projected = (int *) malloc(sizeof(int) * numAttr);
+		for (i = 0; i < numAttrs; i++) {
+			scanMtdt->loaded[attrs[i]] = TRUE;
+		}
+		scanMtdt->numProjected = 0;
+		for (i = 0; i < numAttr; i++) {
+			if (scanMtdt->loaded[i]) {
+				scanMtdt->projected[scanMtdt->numProjected++] = i;
+			}
+		}
+		if (cond) {
+			markExprAttrs(cond, numAttr, scanMtdt->loaded);
+		}
+	}
+	scanMtdt->page = 1;
+	scanMtdt->lastPage = 0;
+	scanMtdt->skipped = 0;
+	scanMtdt->slot = 0;
+	scanMtdt->pageNum = mgmtData->pageOffset;
+	scanMtdt->slotNum = mgmtData->slotMax;
+	scanMtdt->pinned = FALSE;
+	scan->rel = rel;
+	scan->mgmtData = scanMtdt;
+	return RC_OK;
+}
+
+/**
+ * @brief tests a record against the condition of a scan
+ * 
+ * @param scan
+ * @param data Record.data bytes
+ * @return bool 
+ */
+bool scanMatches (RM_ScanHandle *scan, char *data) {
+	RM_ScanMtdt *scanMtdt = (RM_ScanMtdt *)scan->mgmtData;
+	Record record;
+	Value *value;
+	bool match;
+
+	if (scanMtdt->program) {
+		return runExprProgram(scanMtdt->program, data);
+	}
+	if (!scanMtdt->expr) {
+		return TRUE;
+	}
+	record.data = data;
+	evalExpr(&record, scan->rel->schema, scanMtdt->expr, &value);
+	match = value->v.boolV;
+	freeVal(value);
+	return match;
+}
+
+/**
+ * @brief copies the record in a slot of the scanned page if it matches
+ * @details records of fixed length tables are tested on the page bytes,
+ *          only matches are copied; PAX records are gathered from the
+ *          minipages of the attributes the scan reads
+ * @param scan
+ * @param slot
+ * @param record 
+ * @return RC RC_RM_DELETED_TUPLES if the slot holds no record of its own
+ *         or the record does not match
+ */
+RC scanSlot (RM_ScanHandle *scan, RM_Slot *slot, Record *record) {
+	RM_ScanMtdt *scanMtdt = (RM_ScanMtdt *)scan->mgmtData;
+	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) scan->rel->mgmtData;
+	char *bytes = scanMtdt->ph.data + slot->offset;
+
+	// a moved record is scanned under the id of its forwarding slot
+	if (RM_SLOT_IS_FREE(slot) || (slot->length & RM_SLOT_MOVED)) {
+		return RC_RM_DELETED_TUPLES;
+	}
+	if (slot->length & RM_SLOT_FORWARD) {
+		RC result = getRecord(scan->rel, record->id, record);
+		if (result == RC_OK && !scanMatches(scan, record->data)) {
+			return RC_RM_DELETED_TUPLES;
+		}
+		return result;
+	}
+	if (mgmtData->layout == RM_LAYOUT_PAX) {
+		paxReadRecord(scanMtdt->ph.data, scan->rel->schema, mgmtData->slotMax, record->id.slot, record->data, scanMtdt->loaded);
+		return scanMatches(scan, record->data) ? RC_OK : RC_RM_DELETED_TUPLES;
+	}
+	if (mgmtData->varLength) {
+		decodeRecordAttrs(scan->rel->schema, bytes, record->data, scanMtdt->loaded);
+		return scanMatches(scan, record->data) ? RC_OK : RC_RM_DELETED_TUPLES;
+	}
+	if (!scanMatches(scan, bytes)) {
+		return RC_RM_DELETED_TUPLES;
+	}
+	if (scanMtdt->projected) {
+		SchemaLayout *layout = scan->rel->schema->layout;
+		int i, attr;
+		for (i = 0; i < scanMtdt->numProjected; i++) {
+			attr = scanMtdt->projected[i];
+			memcpy(record->data + layout->offsets[attr], bytes + layout->offsets[attr], layout->sizes[attr]);
+		}
+		return RC_OK;
+	}
+	memcpy(record->data, bytes, RM_SLOT_LENGTH(slot));
+	return RC_OK;
+}
+
+/**
+ * @brief whether the cursor of a scan is still on one of its pages
+ * 
+ * @param scanMtdt
+ * @param mgmtData
+ * @return bool 
+ */
+static inline bool scanHasPage (RM_ScanMtdt *scanMtdt, RM_RecordMtdt *mgmtData) {
+	return scanMtdt->page <= mgmtData->pageOffset && (scanMtdt->lastPage == 0 || scanMtdt->page <= scanMtdt->lastPage);
+}
+
+/**
+ * @brief moves a scan past its next page if the zone map shows the page
+ *        holds no match
+ * 
+ * @param scan
+ * @return bool TRUE if the page was passed over without being pinned
+ */
+static bool scanSkipsPage (RM_ScanHandle *scan) {
+	RM_ScanMtdt *scanMtdt = (RM_ScanMtdt *)scan->mgmtData;
+	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) scan->rel->mgmtData;
+	if (zoneMayMatch(mgmtData, scan->rel->schema, scanMtdt->page, scanMtdt->expr)) {
+		return FALSE;
+	}
+	scanMtdt->skipped += 1;
+	scanMtdt->page += 1;
+	return TRUE;
+}
+
+/**
+ * @brief gets the next record in a table
+ * @details the current page stays pinned while its slots are walked,
+ *          pins only move at page boundaries; pages the zone map rules
+ *          out are never pinned, other pages without a live record are
+ *          passed over by their header
+ * @param scan
+ * @param record 
  * @return RC 
  */
-RC closeTable (RM_TableData *rel) {
-	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) rel->mgmtData;
-	// write back header file to file system close buffer pool
-	char *header = serializeRecordMtdt(mgmtData);
-	memcpy(mgmtData->phSchema->data, header, strlen(header));
-	markDirty(mgmtData->bm, mgmtData->phSchema);
-	free(header);
+RC next (RM_ScanHandle *scan, Record *record) {
+	RM_ScanMtdt *scanMtdt = (RM_ScanMtdt *)scan->mgmtData;
+	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) scan->rel->mgmtData;
 
-	shutdownBufferPool(mgmtData->bm);
-	free(mgmtData->ph);
-	free(mgmtData->phSchema);
-	free(mgmtData->schemaStr);
-	free(rel->mgmtData);
-	free(rel->schema->attrNames);
-	free(rel->schema->dataTypes);
-	free(rel->schema->keyAttrs);
-	free(rel->schema->typeLength);
-	free(rel->schema);
-	return RC_OK;
+	while (scanHasPage(scanMtdt, mgmtData)) {
+		if (!scanMtdt->pinned) {
+			if (scanSkipsPage(scan)) {
+				continue;
+			}
+			RC pinned = pinPage(mgmtData->bm, &scanMtdt->ph, scanMtdt->page);
+			if (pinned != RC_OK) {
+				return pinned;
+			}
+			scanMtdt->pinned = TRUE;
+		}
+		RM_PageHeader *header = (RM_PageHeader *) scanMtdt->ph.data;
+		RM_Slot *slots = PAGE_SLOTS(scanMtdt->ph.data);
+		int numSlots = header->freeOffset == 0 || header->liveSlots == 0 ? 0 : header->numSlots;
+
+		while (scanMtdt->slot < numSlots) {
+			record->id.page = scanMtdt->page;
+			record->id.slot = scanMtdt->slot;
+			RC result = scanSlot(scan, &slots[scanMtdt->slot], record);
+			scanMtdt->slot += 1;
+			if (result != RC_RM_DELETED_TUPLES) {
+				return result;
+			}
+		}
+		// past the last slot of the page
+		unpinPage(mgmtData->bm, &scanMtdt->ph);
+		scanMtdt->pinned = FALSE;
+		scanMtdt->slot = 0;
+		scanMtdt->page += 1;
+	}
+	return RC_RM_NO_MORE_TUPLES;
 }
 
 /**
- * @brief deletes the table with given name
+ * @brief closes the initalizes scan
  * 
- * @param name 
+ * @param scan 
  * @return RC 
  */
-RC deleteTable (char *name) {
-	return destroyPageFile(name);
+RC closeScan (RM_ScanHandle *scan) {
+	RM_ScanMtdt *scanMtdt = (RM_ScanMtdt *)scan->mgmtData;
+	if (scanMtdt->pinned) {
+		unpinPage(((RM_RecordMtdt *) scan->rel->mgmtData)->bm, &scanMtdt->ph);
+	}
+	freeExprProgram(scanMtdt->program);
+	free(scanMtdt->projected);
+	free(scanMtdt->loaded);
+	free(scan->mgmtData);
+	return RC_OK;
 }
 
 /**
- * @brief Get the Num Tuples object
+ * @brief the conjuncts of the scan condition in the order they are evaluated,
+ *        with how many records each one saw and passed
  * 
- * @param rel 
- * @return int 
+ * @param scan 
+ * @param conjuncts set to the scan's own array, valid until closeScan()
+ * @return int the number of conjuncts, 0 if the condition was not compiled
  */
-int getNumTuples (RM_TableData *rel) {
-	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) rel->mgmtData;
-	return mgmtData->tupleLen;
+int getScanConjuncts (RM_ScanHandle *scan, ExprConjunct **conjuncts) {
+	RM_ScanMtdt *scanMtdt = (RM_ScanMtdt *)scan->mgmtData;
+	if (!scanMtdt->program) {
+		*conjuncts = NULL;
+		return 0;
+	}
+	*conjuncts = scanMtdt->program->conjuncts;
+	return scanMtdt->program->numConjuncts;
 }
 
 /**
- * @brief updates offset of record
+ * @brief takes the next morsel of a parallel scan
  * 
- * @param mgmtData 
- * @param offset
- * @return void
+ * @param shared
+ * @return int its first page, 0 when the table is done or the scan failed
  */
-void updateRecordOffset (RM_RecordMtdt *mgmtData, int offset) {
-	// offset: 1 | -1
-	mgmtData->tupleLen = mgmtData->tupleLen + offset;
-	if (mgmtData->slotOffset + offset >= mgmtData->slotMax) {
-		mgmtData->slotOffset = 0;
-		mgmtData->pageOffset = mgmtData->pageOffset + offset;
-	} else if (mgmtData->slotOffset + offset < 0) {
-		mgmtData->slotOffset = mgmtData->slotMax;
-		mgmtData->pageOffset = mgmtData->pageOffset + offset;
-	} else {
-		mgmtData->slotOffset = mgmtData->slotOffset + offset;
+static int claimMorsel (RM_ParallelScan *shared) {
+	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) shared->rel->mgmtData;
+	int page = 0;
+	pthread_mutex_lock(&shared->lock);
+	if (shared->result == RC_OK && shared->nextPage <= mgmtData->pageOffset) {
+		page = shared->nextPage;
+		shared->nextPage += RM_MORSEL_PAGES;
 	}
+	pthread_mutex_unlock(&shared->lock);
+	return page;
 }
 
 /**
- * @brief inserts a record to the table
+ * @brief records the first failure of a parallel scan, the workers stop
+ *        at their next morsel
  * 
- * @param rel 
- * @param record 
- * @return RC 
+ * @param shared
+ * @param result
+ * @return void
  */
-RC insertRecord (RM_TableData *rel, Record *record) {
-	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) rel->mgmtData;
-	BM_PageHandle *ph = mgmtData->ph;
-	BM_BufferPool *bm = mgmtData->bm;
-
-	record->id.page = mgmtData->pageOffset;
-	record->id.slot = mgmtData->slotOffset;
-	char *newData = serializeRecord(record, rel->schema);
-
-	pinPage(bm, ph, record->id.page);
-	// find fit position and insert it
-	int offset = record->id.slot * mgmtData->slotLen;
-	memcpy(ph->data + offset, newData, strlen(newData));
-	
-	markDirty(bm, ph);
-	unpinPage(bm, ph);
-
-	updateRecordOffset(mgmtData, 1);
-	free(newData);
-	return RC_OK;
+static void failParallelScan (RM_ParallelScan *shared, RC result) {
+	pthread_mutex_lock(&shared->lock);
+	if (shared->result == RC_OK) {
+		shared->result = result;
+	}
+	pthread_mutex_unlock(&shared->lock);
 }
 
 /**
- * @brief deletes a record from the table
+ * @brief a worker of a parallel scan: scans morsels with a scan of its own,
+ *        so the compiled condition and its counters are not shared
  * 
- * @param rel 
- * @param id 
- * @return RC 
+ * @param arg the RM_ScanWorker
+ * @return void* 
  */
-RC deleteRecord (RM_TableData *rel, RID id) {
-	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) rel->mgmtData;
-	BM_PageHandle *ph = mgmtData->ph;
-	BM_BufferPool *bm = mgmtData->bm;
-	
-	pinPage(bm, ph, id.page);
-	// Todo: NOT SURE how to clear parts of memory
-	int offset = id.slot * mgmtData->slotLen;
-	char *str = (char *)calloc(mgmtData->slotLen, 1);
-
-	memcpy(ph->data + offset, str, mgmtData->slotLen);
-	markDirty(bm, ph);
-	unpinPage(bm, ph);
+static void *scanWorker (void *arg) {
+	RM_ScanWorker *worker = (RM_ScanWorker *) arg;
+	RM_ParallelScan *shared = worker->scan;
+	RM_ScanHandle scan;
+	RM_ScanMtdt *scanMtdt;
+	Record *record;
+	RC result;
+	int page;
 
-	updateRecordOffset(mgmtData, -1);
-	free(str);
-	return RC_OK;
+	result = startScan(shared->rel, &scan, shared->cond);
+	if (result != RC_OK) {
+		failParallelScan(shared, result);
+		return NULL;
+	}
+	scanMtdt = (RM_ScanMtdt *) scan.mgmtData;
+	createRecord(&record, shared->rel->schema);
+	while ((page = claimMorsel(shared)) > 0) {
+		scanMtdt->page = page;
+		scanMtdt->slot = 0;
+		scanMtdt->lastPage = page + RM_MORSEL_PAGES - 1;
+		while ((result = next(&scan, record)) == RC_OK) {
+			result = shared->callback(record, worker->id, shared->arg);
+			if (result != RC_OK) {
+				break;
+			}
+		}
+		if (result != RC_RM_NO_MORE_TUPLES) {
+			failParallelScan(shared, result);
+			break;
+		}
+	}
+	closeScan(&scan);
+	freeRecord(record);
+	return NULL;
 }
 
 /**
- * @brief updates table in a record
- * 
+ * @brief the most workers a parallelScan() of a table may start
+ * @details each worker holds a pin on its current page and one more while
+ *          it follows a forwarded record, that is half the frames of the
+ *          table's pool besides the header page; openTableWithFrames()
+ *          opens a table with more
  * @param rel
- * @param record 
- * @return RC 
+ * @return int
  */
-RC updateRecord (RM_TableData *rel, Record *record) {
+int getMaxScanWorkers (RM_TableData *rel) {
 	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) rel->mgmtData;
-	BM_PageHandle *ph = mgmtData->ph;
-	BM_BufferPool *bm = mgmtData->bm;
-
-	char *newData = serializeRecord(record, rel->schema);
-	pinPage(bm, ph, record->id.page);
-
-	int offset = record->id.slot * mgmtData->slotLen;
-	memcpy(ph->data + offset, newData, strlen(newData));
-
-	markDirty(bm, ph);
-	unpinPage(bm, ph);
-	free(newData);
-	return RC_OK;
+	return (mgmtData->bm->numPages - 1) / 2;
 }
 
 /**
- * @brief gets data from serialize
- * 
- * @param mgmtData 
- * @return RC 
+ * @brief scans a table with worker threads that split its pages into
+ *        morsels, every matching record goes to the callback
+ * @details the table must not change while the scan runs
+ * @param rel
+ * @param cond 
+ * @param numThreads at most getMaxScanWorkers()
+ * @param callback called by the workers at the same time, with the number
+ *        of the worker so results can go to buffers of their own
+ * @param arg passed to the callback
+ * @return RC the first failure of a worker or the callback,
+ *         RC_RM_TOO_MANY_WORKERS if the pool has no room for numThreads
  */
-RC getRecordDataFromSerialize(char *str, Schema *schema, Record **result) {
-	// [1-0] (a:0,b:aaaa,c:3)
-	char *temp;
-	int i;
-	char strcp[strlen(str)];
+RC parallelScan (RM_TableData *rel, Expr *cond, int numThreads, RM_ScanCallback callback, void *arg) {
+	RM_ParallelScan shared;
+	RM_ScanWorker *workers;
+	RM_ScanHandle probe;
+	int started, i;
 
-	// (*result)->data = (char *) malloc(getRecordSize(schema));
-	strcpy(strcp, str);
-	strtok(strcp, "(");
+	if (numThreads > getMaxScanWorkers(rel)) {
+		return RC_RM_TOO_MANY_WORKERS;
+	}
+	// a condition that does not compile fails here rather than in every worker
+	RC result = startScan(rel, &probe, cond);
+	if (result != RC_OK) {
+		return result;
+	}
+	closeScan(&probe);
+	if (numThreads < 1) {
+		numThreads = 1;
+	}
 
-	for (i = 0; i < schema->numAttr; i++) {
-		strtok(NULL, ":");
-		char *delim = (i == schema->numAttr - 1) ? ")" : ",";
-		Value *value = (Value *) malloc(sizeof(Value));
-		value->dt = schema->dataTypes[i];
-		if (schema->dataTypes[i] == DT_INT) {
-			value->v.intV = strtoi(delim, 1);
-		} else if (schema->dataTypes[i] == DT_BOOL) {
-			temp = strtok(NULL, delim);
-			value->v.boolV = temp[0] == 't' ? TRUE : FALSE;
-		} else if (schema->dataTypes[i] == DT_FLOAT) {
-			temp = strtok(NULL, delim);
-			value->v.floatV = strtof(temp, NULL);
-		} else if (schema->dataTypes[i] == DT_STRING) {
-			value->v.stringV = strtochar(delim, 1);
+	shared.rel = rel;
+	shared.cond = cond;
+	shared.callback = callback;
+	shared.arg = arg;
+	shared.nextPage = 1;
+	shared.result = RC_OK;
+	pthread_mutex_init(&shared.lock, NULL);
+	workers = (RM_ScanWorker *) malloc(sizeof(RM_ScanWorker) * numThreads);
+	for (started = 0; started < numThreads; started++) {
+		workers[started].scan = &shared;
+		workers[started].id = started;
+		if (pthread_create(&workers[started].thread, NULL, scanWorker, &workers[started]) != 0) {
+			break;
 		}
-		setAttr(*result, schema, i, value);
-		freeVal(value);
 	}
-	return RC_OK;
+	if (started == 0) {
+		// no thread to be had, the caller scans alone
+		workers[0].scan = &shared;
+		workers[0].id = 0;
+		scanWorker(&workers[0]);
+	}
+	for (i = 0; i < started; i++) {
+		pthread_join(workers[i].thread, NULL);
+	}
+	pthread_mutex_destroy(&shared.lock);
+	free(workers);
+	return shared.result;
 }
 
 /**
- * @brief gets a record from a provided table and RID 
+ * @brief creates an empty batch for nextBatch()
  * 
- * @param rel
- * @param id
- * @param record 
+ * @param batch
+ * @param schema
+ * @param capacity the most rows one batch holds, RM_BATCH_SIZE is a good start
  * @return RC 
  */
-RC getRecord (RM_TableData *rel, RID id, Record *record) {
-	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) rel->mgmtData;
-	BM_PageHandle *ph = mgmtData->ph;
-	BM_BufferPool *bm = mgmtData->bm;
-
-	int currIndex = (id.page - 1) * (mgmtData->slotMax - 1) + (id.slot + 1);
-	if (currIndex > mgmtData->tupleLen) {
-		return RC_RM_NO_MORE_TUPLES;
+RC createBatch (RM_Batch **batch, Schema *schema, int capacity) {
+	RM_Batch *result;
+	int attr;
+	if (capacity <= 0) {
+		return RC_FAIL;
 	}
-	char str[mgmtData->slotLen];
-	record->id.page = id.page;
-	record->id.slot = id.slot;
-
-	pinPage(bm, ph, id.page);
-	int offset = record->id.slot * mgmtData->slotLen;
-	memcpy(str, ph->data + offset, mgmtData->slotLen);
-
-	if (str[0] == 0 && str[1] == 0) {
-		unpinPage(bm, ph);
-		return RC_RM_DELETED_TUPLES;
+	result = (RM_Batch *) malloc(sizeof(RM_Batch));
+	result->capacity = capacity;
+	result->numRows = 0;
+	result->numSelected = 0;
+	result->selection = (int *) malloc(sizeof(int) * capacity);
+	result->rids = (RID *) malloc(sizeof(RID) * capacity);
+	result->columns = (char **) malloc(sizeof(char *) * schema->numAttr);
+	for (attr = 0; attr < schema->numAttr; attr++) {
+		result->columns[attr] = (char *) malloc((long) capacity * schema->layout->sizes[attr]);
 	}
-	getRecordDataFromSerialize(str, rel->schema, &record);
-	unpinPage(bm, ph);
+	result->row = (char *) malloc(getRecordSize(schema));
+	*batch = result;
 	return RC_OK;
 }
 
-//scan
 /**
- * @brief initializes a new scan
+ * @brief frees a batch and its columns
  * 
- * @param rel
- * @param scan
- * @param cond 
+ * @param batch
+ * @param schema the schema it was created for
  * @return RC 
  */
-RC startScan (RM_TableData *rel, RM_ScanHandle *scan, Expr *cond) {
-	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) rel->mgmtData;
-	RM_ScanMtdt *scanMtdt = (RM_ScanMtdt *) malloc(sizeof(RM_ScanMtdt));
-	scanMtdt->expr = cond;
-	scanMtdt->page = 1;
-	scanMtdt->slot = 0;
-	scanMtdt->pageNum = mgmtData->pageOffset;
-	scanMtdt->slotNum = mgmtData->slotMax;
-	scan->rel = rel;
-	scan->mgmtData = scanMtdt;
+RC freeBatch (RM_Batch *batch, Schema *schema) {
+	int attr;
+	for (attr = 0; attr < schema->numAttr; attr++) {
+		free(batch->columns[attr]);
+	}
+	free(batch->columns);
+	free(batch->selection);
+	free(batch->rids);
+	free(batch->row);
+	free(batch);
 	return RC_OK;
 }
 
 /**
- * @brief gets the next record in a table
+ * @brief appends the Record.data bytes of a row to the columns of a batch
  * 
- * @param scan
- * @param record 
- * @return RC 
+ * @param batch
+ * @param layout
+ * @param numAttr
+ * @param data
+ * @param id
+ * @param attrs the attributes to copy, NULL for all
+ * @return void
  */
-RC next (RM_ScanHandle *scan, Record *record) {
-	RM_ScanMtdt *scanMtdt = (RM_ScanMtdt *)scan->mgmtData;
-	Value *value;
-	record->id.page = scanMtdt->page;
-	record->id.slot = scanMtdt->slot;
-
-	int result = getRecord(scan->rel, record->id, record);
-	if (result != RC_OK) {
-		return result;
+static void batchAppend (RM_Batch *batch, SchemaLayout *layout, int numAttr, char *data, RID id, bool *attrs) {
+	int row = batch->numRows++, attr;
+	for (attr = 0; attr < numAttr; attr++) {
+		if (attrs && !attrs[attr]) {
+			continue;
+		}
+		char *to = batch->columns[attr] + (long) row * layout->sizes[attr];
+		memcpy(to, data + layout->offsets[attr], layout->sizes[attr]);
 	}
+	batch->rids[row] = id;
+}
 
-	evalExpr(record, scan->rel->schema, scanMtdt->expr, &value);
-	if (scanMtdt->slot + 1 >= scanMtdt->slotNum) {
-		scanMtdt->slot = 0;
-		scanMtdt->page += 1;
-	} else {
-		scanMtdt->slot += 1;
+/**
+ * @brief appends the records of a run of live slots on a PAX page to the
+ *        columns of a batch, one copy per minipage
+ * 
+ * @param batch
+ * @param schema
+ * @param page
+ * @param slotMax
+ * @param first the id of the first record of the run
+ * @param count
+ * @param attrs the attributes to copy, NULL for all
+ * @return void
+ */
+static void batchAppendRun (RM_Batch *batch, Schema *schema, char *page, int slotMax, RID first, int count, bool *attrs) {
+	SchemaLayout *layout = schema->layout;
+	int row = batch->numRows, attr, i;
+	for (attr = 0; attr < schema->numAttr; attr++) {
+		if (attrs && !attrs[attr]) {
+			continue;
+		}
+		memcpy(batch->columns[attr] + (long) row * layout->sizes[attr],
+			paxValue(page, layout, slotMax, attr, first.slot), (long) count * layout->sizes[attr]);
 	}
-	if (value->v.boolV != TRUE) {
-		return next(scan, record);
+	for (i = 0; i < count; i++) {
+		batch->rids[row + i].page = first.page;
+		batch->rids[row + i].slot = first.slot + i;
 	}
-	return RC_OK;
+	batch->numRows += count;
 }
 
 /**
- * @brief closes the initalizes scan
- * 
- * @param scan 
- * @return RC 
+ * @brief gets the next records of a scan as a batch of columns
+ * @details rows are loaded from the pinned pages first, then a compiled
+ *          condition runs over whole columns with runExprProgramBatch();
+ *          a condition left to evalExpr is tested row by row as rows are
+ *          loaded. next() and nextBatch() share the cursor of the scan. A
+ *          projected scan only loads its attributes and those of the
+ *          condition; the columns of a PAX table are copied a run of
+ *          records at a time unless the condition is tested row by row
+ * @param scan
+ * @param batch rows loaded and the selection of the matching ones, at
+ *        least one row is selected when RC_OK is returned
+ * @return RC RC_RM_NO_MORE_TUPLES at the end of the table
  */
-RC closeScan (RM_ScanHandle *scan) {
-	free(scan->mgmtData);
+RC nextBatch (RM_ScanHandle *scan, RM_Batch *batch) {
+	RM_ScanMtdt *scanMtdt = (RM_ScanMtdt *)scan->mgmtData;
+	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) scan->rel->mgmtData;
+	Schema *schema = scan->rel->schema;
+	Record record;
+	int i;
+
+	record.data = batch->row;
+	do {
+		batch->numRows = 0;
+		while (batch->numRows < batch->capacity && scanHasPage(scanMtdt, mgmtData)) {
+			if (!scanMtdt->pinned) {
+				if (scanSkipsPage(scan)) {
+					continue;
+				}
+				RC pinned = pinPage(mgmtData->bm, &scanMtdt->ph, scanMtdt->page);
+				if (pinned != RC_OK) {
+					// the rows gathered so far are returned, the next call fails
+					if (batch->numRows == 0) {
+						return pinned;
+					}
+					break;
+				}
+				scanMtdt->pinned = TRUE;
+			}
+			RM_PageHeader *header = (RM_PageHeader *) scanMtdt->ph.data;
+			RM_Slot *slots = PAGE_SLOTS(scanMtdt->ph.data);
+			int numSlots = header->freeOffset == 0 || header->liveSlots == 0 ? 0 : header->numSlots;
+
+			while (mgmtData->layout == RM_LAYOUT_PAX && (scanMtdt->program || !scanMtdt->expr)
+					&& scanMtdt->slot < numSlots && batch->numRows < batch->capacity) {
+				RID first = {scanMtdt->page, scanMtdt->slot};
+				int count = 0;
+				while (first.slot + count < numSlots && batch->numRows + count < batch->capacity
+						&& !RM_SLOT_IS_FREE(&slots[first.slot + count])) {
+					count++;
+				}
+				batchAppendRun(batch, schema, scanMtdt->ph.data, mgmtData->slotMax, first, count, scanMtdt->loaded);
+				// a free slot ends a run and is passed over
+				scanMtdt->slot = first.slot + count + (count == 0);
+			}
+			while (scanMtdt->slot < numSlots && batch->numRows < batch->capacity) {
+				RM_Slot *slot = &slots[scanMtdt->slot];
+				char *data = scanMtdt->ph.data + slot->offset;
+				record.id.page = scanMtdt->page;
+				record.id.slot = scanMtdt->slot;
+				scanMtdt->slot += 1;
+				if (RM_SLOT_IS_FREE(slot) || (slot->length & RM_SLOT_MOVED)) {
+					continue;
+				}
+				if (slot->length & RM_SLOT_FORWARD) {
+					RC result = getRecord(scan->rel, record.id, &record);
+					if (result != RC_OK) {
+						return result;
+					}
+					data = record.data;
+				} else if (mgmtData->layout == RM_LAYOUT_PAX) {
+					paxReadRecord(scanMtdt->ph.data, schema, mgmtData->slotMax, record.id.slot, record.data, scanMtdt->loaded);
+					data = record.data;
+				} else if (mgmtData->varLength) {
+					decodeRecordAttrs(schema, data, record.data, scanMtdt->loaded);
+					data = record.data;
+				}
+				if (!scanMtdt->program && !scanMatches(scan, data)) {
+					continue;
+				}
+				batchAppend(batch, schema->layout, schema->numAttr, data, record.id, scanMtdt->loaded);
+			}
+			if (scanMtdt->slot >= numSlots) {
+				unpinPage(mgmtData->bm, &scanMtdt->ph);
+				scanMtdt->pinned = FALSE;
+				scanMtdt->slot = 0;
+				scanMtdt->page += 1;
+			}
+		}
+		if (batch->numRows == 0) {
+			batch->numSelected = 0;
+			return RC_RM_NO_MORE_TUPLES;
+		}
+		if (scanMtdt->program) {
+			batch->numSelected = runExprProgramBatch(scanMtdt->program, batch->columns, batch->numRows, batch->selection);
+		} else {
+			for (i = 0; i < batch->numRows; i++) {
+				batch->selection[i] = i;
+			}
+			batch->numSelected = batch->numRows;
+		}
+	} while (batch->numSelected == 0);
 	return RC_OK;
 }
 
@@ -458,27 +1899,7 @@ RC closeScan (RM_ScanHandle *scan) {
  * @return int 
  */
 int getRecordSize (Schema *schema) {
-	int len = 0, i = 0;
-	for (i = 0; i < schema->numAttr; i++) {
-		switch (schema->dataTypes[i])
-		{
-			case DT_INT:
-				len += sizeof(int);
-				break;
-			case DT_FLOAT:
-				len += sizeof(float);
-				break;
-			case DT_BOOL:
-				len += sizeof(bool);
-				break;
-			case DT_STRING:
-				len += schema->typeLength[i];
-				break;
-			default:
-				break;
-		}
-	}
-	return len;
+	return schema->layout->recordSize;
 }
 
 /**
@@ -500,6 +1921,7 @@ Schema *createSchema (int numAttr, char **attrNames, DataType *dataTypes, int *t
 	schema->typeLength = typeLength;
 	schema->keySize = keySize;
 	schema->keyAttrs = keys;
+	buildSchemaLayout(schema);
 	return schema;
 }
 
@@ -510,6 +1932,7 @@ Schema *createSchema (int numAttr, char **attrNames, DataType *dataTypes, int *t
  * @return RC 
  */
 RC freeSchema (Schema *schema) {
+	freeSchemaLayout(schema);
 	free(schema);
 	return RC_OK;
 }
@@ -550,11 +1973,11 @@ RC freeRecord (Record *record) {
  * @return RC 
  */
 RC getAttr (Record *record, Schema *schema, int attrNum, Value **value) {
-	*value = (Value *) malloc(sizeof(Value*));
+	*value = (Value *) malloc(sizeof(Value));
 	int offset;
 	char *attrData;
 
-	attrOffset(schema, attrNum, &offset);
+	offset = schema->layout->offsets[attrNum];
 	attrData = record->data + offset;
 	(*value)->dt = schema->dataTypes[attrNum];
 	
@@ -593,7 +2016,7 @@ RC setAttr (Record *record, Schema *schema, int attrNum, Value *value) {
 	int offset;
 	char *attrData;
 
-	attrOffset(schema, attrNum, &offset);
+	offset = schema->layout->offsets[attrNum];
 	attrData = record->data + offset;
 
 	switch(schema->dataTypes[attrNum]) {
@@ -612,3 +2035,60 @@ RC setAttr (Record *record, Schema *schema, int attrNum, Value *value) {
 	}
 	return RC_OK;
 }
+
+/**
+ * @brief reads an int attribute in place
+ * 
+ * @param record
+ * @param schema
+ * @param attrNum 
+ * @return int 
+ */
+int getIntAttr (Record *record, Schema *schema, int attrNum) {
+	int value;
+	memcpy(&value, record->data + schema->layout->offsets[attrNum], sizeof(int));
+	return value;
+}
+
+/**
+ * @brief reads a float attribute in place
+ * 
+ * @param record
+ * @param schema
+ * @param attrNum 
+ * @return float 
+ */
+float getFloatAttr (Record *record, Schema *schema, int attrNum) {
+	float value;
+	memcpy(&value, record->data + schema->layout->offsets[attrNum], sizeof(float));
+	return value;
+}
+
+/**
+ * @brief reads a bool attribute in place
+ * 
+ * @param record
+ * @param schema
+ * @param attrNum 
+ * @return bool 
+ */
+bool getBoolAttr (Record *record, Schema *schema, int attrNum) {
+	bool value;
+	memcpy(&value, record->data + schema->layout->offsets[attrNum], sizeof(bool));
+	return value;
+}
+
+/**
+ * @brief points at a string attribute inside the record
+ * @details the string is not NUL terminated when it fills the attribute
+ * @param record
+ * @param schema
+ * @param attrNum
+ * @param len set to the length of the string
+ * @return char* 
+ */
+char *getStringAttrRef (Record *record, Schema *schema, int attrNum, int *len) {
+	char *str = record->data + schema->layout->offsets[attrNum];
+	*len = strnlen(str, schema->typeLength[attrNum]);
+	return str;
+}
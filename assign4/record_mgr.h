@@ -6,6 +6,7 @@
 #include "tables.h"
 #include "storage_mgr.h"
 #include "buffer_mgr.h"
+#include "btree_mgr.h"
 
 
 // Bookkeeping for scans
@@ -18,51 +19,253 @@ typedef struct RM_ScanHandle
 typedef struct RM_ScanMtdt
 {
 	Expr *expr;
+	ExprProgram *program; // expr compiled, NULL leaves it to evalExpr
 	int page;
 	int slot;
 	
 	int slotNum;
 	int pageNum;
+	BM_PageHandle ph; // the current page, pinned between next() calls
+	bool pinned;
+	int numProjected; // attributes next() copies, all for a NULL projected
+	int *projected;
+	bool *loaded;     // projected plus the attributes of the condition
+	int lastPage;     // the scan ends after it, 0 scans to the end of the table
+	int skipped;      // pages passed over by their zone map, never pinned
 } RM_ScanMtdt;
 
+// parallel scans: worker threads take morsels of RM_MORSEL_PAGES pages
+// off a shared counter, each with a scan of its own
+#define RM_MORSEL_PAGES 16
+
+// gets each matching record from the worker that found it, workers run
+// at the same time; anything but RC_OK stops the scan
+typedef RC (*RM_ScanCallback) (Record *record, int worker, void *arg);
+
+typedef struct RM_ParallelScan {
+	RM_TableData *rel;
+	Expr *cond;
+	RM_ScanCallback callback;
+	void *arg;
+	pthread_mutex_t lock;
+	int nextPage; // first page of the next morsel
+	RC result;    // first failure of a worker or the callback
+} RM_ParallelScan;
+
+typedef struct RM_ScanWorker {
+	RM_ParallelScan *scan;
+	int id;
+	pthread_t thread;
+} RM_ScanWorker;
+
+// a batch of records from nextBatch(), stored by column
+#define RM_BATCH_SIZE 1024
+
+typedef struct RM_Batch
+{
+	int capacity;
+	int numRows;     // rows loaded into the columns
+	int numSelected; // rows matching the scan condition
+	int *selection;  // their row numbers, increasing
+	RID *rids;
+	char **columns;  // per attribute capacity values: arrays of int, float
+	                 // or bool, strings typeLength bytes apart as in Record.data
+	char *row;       // one record, for decoded and forwarded rows
+} RM_Batch;
+
+// page format of a table, kept in the table header
+#define RM_FORMAT_TEXT 1    // text slots of serializeRecord, migrated on open
+#define RM_FORMAT_SLOTTED 2 // binary slotted pages
+#define RM_FORMAT_FSM 3     // slotted pages and a free space map, rebuilt for older tables
+#define RM_FORMAT_BINARY 4  // binary table header
+#define RM_FORMAT_LAYOUT 5  // the binary header names the page layout, older headers are rewritten on open
+
+// page layout of a table, chosen by createTableWithLayout()
+#define RM_LAYOUT_ROW 0 // records whole on slotted pages
+#define RM_LAYOUT_PAX 1 // per page one minipage of values for each attribute
+
+// binary table header at the start of page 0, followed by numAttr
+// RM_AttrEntry, keySize key attribute numbers and the attribute names
+#define RM_HEADER_MAGIC 0x31484d52 // "RMH1"
+
+typedef struct RM_TableHeader {
+	int magic;
+	int version;
+	int tupleLen;
+	int slotLen;
+	int slotMax;
+	int slotOffset;
+	int pageOffset;
+	int varLength;
+	int numAttr;
+	int keySize;
+	int layout; // RM_LAYOUT_*, not in RM_FORMAT_BINARY headers
+} RM_TableHeader;
+
+typedef struct RM_AttrEntry {
+	int dataType;
+	int typeLength;
+	int offset;  // in Record.data
+	int nameLen; // without the terminating NUL
+} RM_AttrEntry;
+
+// free space map: page 0 holds the header and from RM_FSM_OFFSET one
+// byte per data page, the free bytes of the page in units of RM_FSM_UNIT;
+// pages past RM_FSM_PAGES are not tracked and only the last one is filled
+#define RM_FSM_OFFSET (PAGE_SIZE / 4)
+#define RM_FSM_UNIT 16
+#define RM_FSM_PAGES (PAGE_SIZE - RM_FSM_OFFSET)
+
+// header of a slotted data page, the slot directory follows it and the
+// raw Record.data bytes are packed from the end of the page towards it
+typedef struct RM_PageHeader {
+	int numSlots;   // entries in the slot directory
+	int liveSlots;  // entries holding a record
+	int freeOffset; // start of the record area, 0 on a page never used
+} RM_PageHeader;
+
+typedef struct RM_Slot {
+	unsigned short offset;
+	unsigned short length; // bytes of the record and RM_SLOT_* flags, 0 is a free slot
+} RM_Slot;
+
+// new pages a bulk insert builds before writing them out as one request
+#define RM_BULK_PAGES 32
+
+#define RM_SLOT_FREE 0x8000    // deleted, the length of the hole is kept
+#define RM_SLOT_FORWARD 0x4000 // holds the RID the record moved to
+#define RM_SLOT_MOVED 0x2000   // a record living away from its own slot
+#define RM_SLOT_FLAGS 0xe000
+#define RM_SLOT_LENGTH(s) ((s)->length & ~RM_SLOT_FLAGS)
+#define RM_SLOT_IS_FREE(s) ((s)->length == 0 || ((s)->length & RM_SLOT_FREE))
+
+#define PAGE_SLOTS(page) ((RM_Slot *) ((page) + sizeof(RM_PageHeader)))
+
+// string attributes of at least this length make a table store its records
+// with variable length: every string takes its length and its bytes only
+#define RM_VARLEN_MIN_STRING 16
+
+// a record read in place: record.data points into the buffer frame, which
+// stays pinned until releaseRecordRef
+typedef struct RM_RecordRef {
+	Record record;
+	BM_PageHandle page;
+	char *copy;   // records of variable length tables are decoded into it
+} RM_RecordRef;
+
+// zone maps: for every data page the count of records whose id is on it
+// and the smallest and largest value of each int, float and bool attribute
+// among them. Bounds only widen, a deleted record leaves them as they are.
+// The map lives in memory while the table is open and in the page file
+// <table>RM_ZONE_SUFFIX while it is closed
+#define RM_ZONE_SUFFIX ".zone"
+#define RM_ZONE_MAGIC 0x5a4f4e45 // "ZONE"
+
+typedef union RM_ZoneValue {
+	int intV; // ints and bools
+	float floatV;
+} RM_ZoneValue;
+
+typedef struct RM_Zone {
+	int count;             // live records, a page without any is never pinned by a scan
+	RM_ZoneValue bounds[]; // the smallest value of each attribute, then the largest
+} RM_Zone;
+
+// first page of a saved zone map, the zones follow it and go on over the
+// next pages of the file
+typedef struct RM_ZoneFileHeader {
+	int magic;
+	int zoneSize;
+	int numPages;
+} RM_ZoneFileHeader;
+
+// primary key index: a B+-tree over the key attributes of a table whose
+// schema has any, kept in memory while the table is open and built from
+// its records by openTable(). A key of several attributes is one string
+#define RM_INDEX_SUFFIX ".idx"
+#define RM_INDEX_FANOUT 64
+#define RM_INDEX_PENDING ((RID) {0, 0}) // id of a key whose record is not placed yet
+
 typedef struct RM_RecordMtdt{
+	int version;  // page format, RM_FORMAT_*
 	int tupleLen; // exist's number of tuple 
 
 	int schemaLen;// schema length
 	char *schemaStr;// schema string
 
-	int slotLen;// single slot length
+	int slotLen;// single slot length, the largest stored record on slotted pages
+	int varLength;// records are stored encoded, see encodeRecord
+	int layout;// RM_LAYOUT_*
 	int slotMax;// the count of slot on one single page
 	
 	int slotOffset;// free slot offset
-	int pageOffset;// page(block) offset
+	int pageOffset;// page(block) offset, the last page with records
 	
 	BM_PageHandle *ph;// openTable -> page file
 	BM_BufferPool *bm;
 	BM_PageHandle *phSchema;
 
+	unsigned char *fsm;// free space map inside the pinned page 0, fsm[page - 1]
+	int fsmHint;// no page before it has room for a record
+
+	char *zones;// zone map, zoneSize bytes per data page
+	int zoneSize;
+	int zonePages;// pages the zone map has room for
+	bool zoneReady;// scans only trust the map once it was loaded or built
+
+	BTreeHandle *index;// primary key index, NULL without key attributes
+	char *indexName;// file of the index, kept for the tree's idxId
 } RM_RecordMtdt;
 
 
+// schemas of tables opened in this process, by table name
+#define RM_SCHEMA_CACHE_BUCKETS 64
+
+typedef struct RM_SchemaCacheEntry {
+	char *name;
+	Schema *schema;
+	int refs;     // open tables using the schema
+	int dropped;  // the table was deleted or re-created while open
+	struct RM_SchemaCacheEntry *next;
+} RM_SchemaCacheEntry;
+
+// frames of the buffer pool of a table opened by openTable()
+#define MAX_BUFFER_NUMS 10
+// fewest frames of a table pool: the header page, a page and the page it forwards to
+#define RM_MIN_BUFFER_NUMS 3
+
 // table and manager
 extern RC initRecordManager (void *mgmtData);
 extern RC shutdownRecordManager (void);
 extern RC createTable (char *name, Schema *schema);
+extern RC createTableWithLayout (char *name, Schema *schema, int layout);
 extern RC openTable (RM_TableData *rel, char *name);
+extern RC openTableWithFrames (RM_TableData *rel, char *name, int numFrames);
 extern RC closeTable (RM_TableData *rel);
 extern RC deleteTable (char *name);
 extern int getNumTuples (RM_TableData *rel);
 
 // handling records in a table
 extern RC insertRecord (RM_TableData *rel, Record *record);
+extern RC insertRecords (RM_TableData *rel, Record **records, int n, RID *rids);
 extern RC deleteRecord (RM_TableData *rel, RID id);
 extern RC updateRecord (RM_TableData *rel, Record *record);
 extern RC getRecord (RM_TableData *rel, RID id, Record *record);
+extern RC getRecordRef (RM_TableData *rel, RID id, RM_RecordRef *ref);
+extern RC releaseRecordRef (RM_TableData *rel, RM_RecordRef *ref);
+extern RC getRecordByKey (RM_TableData *rel, Value **key, Record *record);
 
 // scans
 extern RC startScan (RM_TableData *rel, RM_ScanHandle *scan, Expr *cond);
+extern RC startProjectedScan (RM_TableData *rel, RM_ScanHandle *scan, Expr *cond, int numAttrs, int *attrs);
 extern RC next (RM_ScanHandle *scan, Record *record);
 extern RC closeScan (RM_ScanHandle *scan);
+extern int getScanConjuncts (RM_ScanHandle *scan, ExprConjunct **conjuncts);
+extern int getMaxScanWorkers (RM_TableData *rel);
+extern RC parallelScan (RM_TableData *rel, Expr *cond, int numThreads, RM_ScanCallback callback, void *arg);
+extern RC createBatch (RM_Batch **batch, Schema *schema, int capacity);
+extern RC freeBatch (RM_Batch *batch, Schema *schema);
+extern RC nextBatch (RM_ScanHandle *scan, RM_Batch *batch);
 
 // dealing with schemas
 extern int getRecordSize (Schema *schema);
@@ -75,11 +278,77 @@ extern RC freeRecord (Record *record);
 extern RC getAttr (Record *record, Schema *schema, int attrNum, Value **value);
 extern RC setAttr (Record *record, Schema *schema, int attrNum, Value *value);
 
+// typed attribute reads without allocation, they work on refs as well
+extern int getIntAttr (Record *record, Schema *schema, int attrNum);
+extern float getFloatAttr (Record *record, Schema *schema, int attrNum);
+extern bool getBoolAttr (Record *record, Schema *schema, int attrNum);
+extern char *getStringAttrRef (Record *record, Schema *schema, int attrNum, int *len);
+
+extern int calcSlotLen (Schema *schema);
+extern int calcSlotMax (int recordSize);
+
+// slotted pages
+extern void initDataPage (char *page);
+extern int pageFreeBytes (char *page);
+extern int pageFreeSpace (char *page, int holeLen);
+extern void pageCompact (char *page);
+extern int pageInsertRecord (char *page, char *data, int len);
+extern RC pageReplaceRecord (char *page, int slot, char *data, int len);
+extern void pageDeleteRecord (char *page, int slot);
+extern RC pageFindRecord (char *page, int slot, RM_Slot **result);
+extern char *paxValue (char *page, SchemaLayout *layout, int slotMax, int attr, int slot);
+extern int paxFreeSpace (char *page, int slotMax, int recordSize);
+extern int paxInsertRecord (char *page, Schema *schema, int slotMax, char *data);
+extern void paxWriteRecord (char *page, Schema *schema, int slotMax, int slot, char *data);
+extern void paxReadRecord (char *page, Schema *schema, int slotMax, int slot, char *data, bool *attrs);
+
+// zone maps
+extern int zoneSize (Schema *schema);
+extern RM_Zone *getZone (RM_RecordMtdt *mgmtData, int page);
+extern void zoneWiden (RM_RecordMtdt *mgmtData, Schema *schema, int page, char *data);
+extern void zoneAddRecord (RM_RecordMtdt *mgmtData, Schema *schema, int page, char *data);
+extern void zoneRemoveRecord (RM_RecordMtdt *mgmtData, int page);
+extern bool zoneMayMatch (RM_RecordMtdt *mgmtData, Schema *schema, int page, Expr *cond);
+extern RC loadZoneMap (RM_TableData *rel);
+extern RC saveZoneMap (RM_TableData *rel);
+extern RC dropZoneMap (char *name);
+
+// primary key index
+extern Value *indexKey (Schema *schema, Value **values);
+extern Value *recordKey (Schema *schema, char *data);
+extern RC indexAddKey (RM_TableData *rel, char *data, RID id);
+extern RC indexCheckKey (RM_TableData *rel, char *data, RID id);
+extern RC indexChangeKey (RM_TableData *rel, char *oldData, char *newData, RID id);
+extern void indexSetKeys (RM_TableData *rel, Record **records, int placed, int n);
+extern void indexRemoveKey (RM_TableData *rel, char *data);
+extern RC createIndex (char *name, Schema *schema);
+extern RC openIndex (RM_TableData *rel);
+extern RC closeIndex (RM_TableData *rel);
+extern RC dropIndex (char *name);
+
+// variable length records
+extern int isVarLengthSchema (Schema *schema);
+extern int getMaxEncodedSize (Schema *schema);
+extern int encodeRecord (Schema *schema, char *data, char *buf);
+extern void decodeRecord (Schema *schema, char *buf, char *data);
+extern void decodeRecordAttrs (Schema *schema, char *buf, char *data, bool *attrs);
+// table header
+extern int getTableHeaderSize (Schema *schema);
+extern int isBinaryTableHeader (char *page);
+extern void writeTableHeaderPage (char *page, RM_RecordMtdt *recordMtdt, Schema *schema);
+extern void updateTableHeaderPage (char *page, RM_RecordMtdt *recordMtdt);
+extern RM_RecordMtdt *readTableHeaderPage (char *page);
+extern Schema *readTableSchema (char *page);
+extern void freeTableSchema (Schema *schema);
+
 extern RC writeStrToPage(char *, int , char *);
 extern char *serializeRecordMtdt(RM_RecordMtdt *);
 extern RM_RecordMtdt *deserializeRecordMtdt(char *);
+extern RC getRecordDataFromSerialize(char *, Schema *, Record **);
 extern Schema *deserializeSchema(char * str);
 extern RC attrOffset (Schema *, int, int *);
+extern void buildSchemaLayout (Schema *schema);
+extern void freeSchemaLayout (Schema *schema);
 extern int strtoi(char *, int);
 extern char *strtochar(char *, int);
 
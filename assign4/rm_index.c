@@ -0,0 +1,331 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dberror.h"
+#include "record_mgr.h"
+
+/**
+ * @brief the key the index keeps for the values of the key attributes
+ * @details a single attribute is its own key; the values of several are
+ *          written into one string that two different combinations never
+ *          share: ints and the bits of floats in hex, strings after their
+ *          length
+ * @param schema
+ * @param values one per key attribute, in the order of schema->keyAttrs
+ * @return Value* freed with freeVal()
+ */
+Value *indexKey (Schema *schema, Value **values) {
+	Value *key;
+	unsigned int bits;
+	int i, size = 1, pos = 0;
+	if (schema->keySize == 1) {
+		return copyKey(values[0]);
+	}
+	for (i = 0; i < schema->keySize; i++) {
+		size += values[i]->dt == DT_STRING ? strlen(values[i]->v.stringV) + 22 : 10;
+	}
+	key = (Value *) malloc(sizeof(Value));
+	key->dt = DT_STRING;
+	key->v.stringV = (char *) malloc(size);
+	key->v.stringV[0] = '\0';
+	for (i = 0; i < schema->keySize; i++) {
+		char *sep = i > 0 ? "," : "";
+		switch (values[i]->dt) {
+			case DT_INT:
+				pos += sprintf(key->v.stringV + pos, "%s%x", sep, values[i]->v.intV);
+				break;
+			case DT_FLOAT:
+				memcpy(&bits, &values[i]->v.floatV, sizeof(float));
+				pos += sprintf(key->v.stringV + pos, "%s%x", sep, bits);
+				break;
+			case DT_BOOL:
+				pos += sprintf(key->v.stringV + pos, "%s%d", sep, values[i]->v.boolV != 0);
+				break;
+			case DT_STRING:
+				pos += sprintf(key->v.stringV + pos, "%s%zu:%s", sep, strlen(values[i]->v.stringV), values[i]->v.stringV);
+				break;
+		}
+	}
+	return key;
+}
+
+/**
+ * @brief the index key of a record
+ *
+ * @param schema
+ * @param data Record.data bytes
+ * @return Value* freed with freeVal()
+ */
+Value *recordKey (Schema *schema, char *data) {
+	Record record;
+	Value *values[schema->keySize];
+	Value *key;
+	int i;
+	record.data = data;
+	for (i = 0; i < schema->keySize; i++) {
+		getAttr(&record, schema, schema->keyAttrs[i], &values[i]);
+	}
+	key = indexKey(schema, values);
+	for (i = 0; i < schema->keySize; i++) {
+		freeVal(values[i]);
+	}
+	return key;
+}
+
+/**
+ * @brief adds the key of a record to the index of its table
+ *
+ * @param rel
+ * @param data Record.data bytes
+ * @param id RM_INDEX_PENDING while the record has no place yet
+ * @return RC RC_IM_KEY_ALREADY_EXISTS if another record has the key
+ */
+RC indexAddKey (RM_TableData *rel, char *data, RID id) {
+	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) rel->mgmtData;
+	Value *key;
+	RC result;
+	if (mgmtData->index == NULL) {
+		return RC_OK;
+	}
+	key = recordKey(rel->schema, data);
+	result = insertKey(mgmtData->index, key, id);
+	freeVal(key);
+	return result;
+}
+
+/**
+ * @brief whether a record may take a key
+ *
+ * @param rel
+ * @param data the record as it is going to be stored
+ * @param id
+ * @return RC RC_IM_KEY_ALREADY_EXISTS if another record has the key
+ */
+RC indexCheckKey (RM_TableData *rel, char *data, RID id) {
+	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) rel->mgmtData;
+	Value *key;
+	RID found;
+	RC result = RC_OK;
+	if (mgmtData->index == NULL) {
+		return RC_OK;
+	}
+	key = recordKey(rel->schema, data);
+	if (findKey(mgmtData->index, key, &found) == RC_OK
+			&& (found.page != id.page || found.slot != id.slot)) {
+		result = RC_IM_KEY_ALREADY_EXISTS;
+	}
+	freeVal(key);
+	return result;
+}
+
+/**
+ * @brief moves a record in the index from its old key to its new one
+ * @details the new key goes in before the old one goes out, a failure
+ *          leaves the index as it was
+ * @param rel
+ * @param oldData the record as it was stored
+ * @param newData the record as it is stored now
+ * @param id
+ * @return RC RC_IM_KEY_ALREADY_EXISTS if another record has the new key
+ */
+RC indexChangeKey (RM_TableData *rel, char *oldData, char *newData, RID id) {
+	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) rel->mgmtData;
+	Value *oldKey, *newKey;
+	RC result;
+	if (mgmtData->index == NULL) {
+		return RC_OK;
+	}
+	result = indexCheckKey(rel, newData, id);
+	if (result != RC_OK) {
+		return result;
+	}
+	newKey = recordKey(rel->schema, newData);
+	oldKey = recordKey(rel->schema, oldData);
+	result = insertKey(mgmtData->index, newKey, id);
+	if (result == RC_IM_KEY_ALREADY_EXISTS) {
+		// the key is the record's own, it did not change
+		result = RC_OK;
+	} else if (result == RC_OK) {
+		result = deleteKey(mgmtData->index, oldKey);
+	}
+	freeVal(oldKey);
+	freeVal(newKey);
+	return result;
+}
+
+/**
+ * @brief points the keys added for a bulk insert at the records placed,
+ *        the keys of those left over are removed
+ *
+ * @param rel
+ * @param records
+ * @param placed the records before it have their ids
+ * @param n
+ * @return void
+ */
+void indexSetKeys (RM_TableData *rel, Record **records, int placed, int n) {
+	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) rel->mgmtData;
+	Value *key;
+	int i;
+	if (mgmtData->index == NULL) {
+		return;
+	}
+	for (i = 0; i < n; i++) {
+		key = recordKey(rel->schema, records[i]->data);
+		if (i < placed) {
+			updateKey(mgmtData->index, key, records[i]->id);
+		} else {
+			deleteKey(mgmtData->index, key);
+		}
+		freeVal(key);
+	}
+}
+
+/**
+ * @brief removes the key of a record from the index of its table
+ *
+ * @param rel
+ * @param data Record.data bytes
+ * @return void
+ */
+void indexRemoveKey (RM_TableData *rel, char *data) {
+	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) rel->mgmtData;
+	Value *key;
+	if (mgmtData->index == NULL) {
+		return;
+	}
+	key = recordKey(rel->schema, data);
+	deleteKey(mgmtData->index, key);
+	freeVal(key);
+}
+
+/**
+ * @brief the name of the index file of a table
+ *
+ * @param name
+ * @return char*
+ */
+static char *indexFileName (char *name) {
+	char *result = (char *) malloc(strlen(name) + strlen(RM_INDEX_SUFFIX) + 1);
+	sprintf(result, "%s%s", name, RM_INDEX_SUFFIX);
+	return result;
+}
+
+/**
+ * @brief the type of the keys of the index of a schema
+ *
+ * @param schema
+ * @return DataType
+ */
+static DataType indexKeyType (Schema *schema) {
+	return schema->keySize == 1 ? schema->dataTypes[schema->keyAttrs[0]] : DT_STRING;
+}
+
+/**
+ * @brief creates the index file of a new table, if its schema has a key
+ *
+ * @param name
+ * @param schema
+ * @return RC
+ */
+RC createIndex (char *name, Schema *schema) {
+	char *indexName;
+	RC result;
+	if (schema->keySize == 0) {
+		return RC_OK;
+	}
+	indexName = indexFileName(name);
+	result = createBtree(indexName, indexKeyType(schema), RM_INDEX_FANOUT);
+	free(indexName);
+	return result;
+}
+
+/**
+ * @brief opens the index of a table and adds the key of every record to it
+ * @details the tree only lives in memory, it is built again on every open;
+ *          a table from before the index gets its file here. A table with
+ *          two records of the same key cannot be indexed, it is used
+ *          without an index and its keys are not checked
+ * @param rel
+ * @return RC on a failure the tree is left open for closeIndex()
+ */
+RC openIndex (RM_TableData *rel) {
+	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) rel->mgmtData;
+	Schema *schema = rel->schema;
+	RM_ScanHandle scan;
+	Record *record;
+	SM_FileHandle fh;
+	RC result;
+
+	if (schema->keySize == 0) {
+		return RC_OK;
+	}
+	mgmtData->indexName = indexFileName(rel->name);
+	if (openPageFile(mgmtData->indexName, &fh) == RC_OK) {
+		closePageFile(&fh);
+	} else {
+		result = createBtree(mgmtData->indexName, indexKeyType(schema), RM_INDEX_FANOUT);
+		if (result != RC_OK) {
+			return result;
+		}
+	}
+	result = openBtree(&mgmtData->index, mgmtData->indexName);
+	if (result != RC_OK) {
+		mgmtData->index = NULL;
+		return result;
+	}
+
+	createRecord(&record, schema);
+	result = startScan(rel, &scan, NULL);
+	if (result == RC_OK) {
+		while ((result = next(&scan, record)) == RC_OK) {
+			result = indexAddKey(rel, record->data, record->id);
+			if (result != RC_OK) {
+				break;
+			}
+		}
+		closeScan(&scan);
+	}
+	freeRecord(record);
+	if (result == RC_IM_KEY_ALREADY_EXISTS) {
+		closeBtree(mgmtData->index);
+		mgmtData->index = NULL;
+		return RC_OK;
+	}
+	return result == RC_RM_NO_MORE_TUPLES ? RC_OK : result;
+}
+
+/**
+ * @brief closes the index of a table
+ *
+ * @param rel
+ * @return RC
+ */
+RC closeIndex (RM_TableData *rel) {
+	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) rel->mgmtData;
+	if (mgmtData->index) {
+		closeBtree(mgmtData->index);
+		mgmtData->index = NULL;
+	}
+	free(mgmtData->indexName);
+	mgmtData->indexName = NULL;
+	return RC_OK;
+}
+
+/**
+ * @brief removes the index file of a table, if it has one
+ *
+ * @param name
+ * @return RC
+ */
+RC dropIndex (char *name) {
+	char *indexName = indexFileName(name);
+	SM_FileHandle fh;
+	if (openPageFile(indexName, &fh) == RC_OK) {
+		closePageFile(&fh);
+		deleteBtree(indexName);
+	}
+	free(indexName);
+	return RC_OK;
+}
@@ -0,0 +1,332 @@
+#include <string.h>
+
+#include "dberror.h"
+#include "record_mgr.h"
+
+/**
+ * @brief prepares an empty slotted page
+ *
+ * @param page
+ * @return void
+ */
+void initDataPage (char *page) {
+	RM_PageHeader *header = (RM_PageHeader *) page;
+	header->numSlots = 0;
+	header->liveSlots = 0;
+	header->freeOffset = PAGE_SIZE;
+}
+
+/**
+ * @brief bytes of a page not taken by the header, the slot directory or a record
+ * @details holes of deleted records and the ends of shrunk records count,
+ *          pageCompact() turns them into one free area
+ * @param page
+ * @return int
+ */
+int pageFreeBytes (char *page) {
+	RM_PageHeader *header = (RM_PageHeader *) page;
+	RM_Slot *slots = PAGE_SLOTS(page);
+	int used = 0, slot;
+	if (header->freeOffset == 0) {
+		return PAGE_SIZE - sizeof(RM_PageHeader);
+	}
+	for (slot = 0; slot < header->numSlots; slot++) {
+		if (!RM_SLOT_IS_FREE(&slots[slot])) {
+			used += RM_SLOT_LENGTH(&slots[slot]);
+		}
+	}
+	return PAGE_SIZE - sizeof(RM_PageHeader) - header->numSlots * sizeof(RM_Slot) - used;
+}
+
+/**
+ * @brief room for a new record as the free space map sees it: the free area,
+ *        the holes and slot entries of deleted records
+ * @details the ends of shrunk records are left out; a page with all slots
+ *          live, or one whose holes are known to be holeLen bytes, costs no
+ *          walk over the slot directory
+ * @param page
+ * @param holeLen the size of every hole in a fixed length table, 0 if unknown
+ * @return int
+ */
+int pageFreeSpace (char *page, int holeLen) {
+	RM_PageHeader *header = (RM_PageHeader *) page;
+	RM_Slot *slots = PAGE_SLOTS(page);
+	int space, slot;
+	if (header->freeOffset == 0) {
+		return PAGE_SIZE - sizeof(RM_PageHeader);
+	}
+	space = header->freeOffset - sizeof(RM_PageHeader) - header->numSlots * sizeof(RM_Slot);
+	if (header->liveSlots == header->numSlots || holeLen > 0) {
+		return space + (header->numSlots - header->liveSlots) * (holeLen + sizeof(RM_Slot));
+	}
+	for (slot = 0; slot < header->numSlots; slot++) {
+		if (RM_SLOT_IS_FREE(&slots[slot])) {
+			space += RM_SLOT_LENGTH(&slots[slot]) + sizeof(RM_Slot);
+		}
+	}
+	return space;
+}
+
+/**
+ * @brief moves the records of a page together at its end, slot numbers stay
+ *
+ * @param page
+ * @return void
+ */
+void pageCompact (char *page) {
+	RM_PageHeader *header = (RM_PageHeader *) page;
+	RM_Slot *slots = PAGE_SLOTS(page);
+	char copy[PAGE_SIZE];
+	int offset = PAGE_SIZE, slot;
+
+	memcpy(copy, page, PAGE_SIZE);
+	for (slot = 0; slot < header->numSlots; slot++) {
+		if (RM_SLOT_IS_FREE(&slots[slot])) {
+			// the hole is gone
+			slots[slot].length = 0;
+			continue;
+		}
+		offset -= RM_SLOT_LENGTH(&slots[slot]);
+		memcpy(page + offset, copy + slots[slot].offset, RM_SLOT_LENGTH(&slots[slot]));
+		slots[slot].offset = offset;
+	}
+	header->freeOffset = offset;
+}
+
+/**
+ * @brief takes len bytes from the free area of a page, compacting it first if needed
+ *
+ * @param page
+ * @param len
+ * @param newSlot the bytes go with a new slot entry
+ * @return int the offset, -1 if the page is full
+ */
+static int pageAllocate (char *page, int len, int newSlot) {
+	RM_PageHeader *header = (RM_PageHeader *) page;
+	int entry = newSlot ? sizeof(RM_Slot) : 0;
+	int directoryEnd = sizeof(RM_PageHeader) + header->numSlots * sizeof(RM_Slot) + entry;
+	if (header->freeOffset - len < directoryEnd) {
+		if (pageFreeBytes(page) - entry < len) {
+			return -1;
+		}
+		pageCompact(page);
+	}
+	header->freeOffset -= len;
+	return header->freeOffset;
+}
+
+/**
+ * @brief places a record on a slotted page
+ * @details a hole of a deleted record that is large enough is filled first,
+ *          then the slot entry of a deleted record is reused with bytes from
+ *          the free area
+ * @param page
+ * @param data
+ * @param len
+ * @return int the slot, -1 if the page is full
+ */
+int pageInsertRecord (char *page, char *data, int len) {
+	RM_PageHeader *header = (RM_PageHeader *) page;
+	RM_Slot *slots = PAGE_SLOTS(page);
+	int slot = -1, entry, i, offset;
+	if (header->freeOffset == 0) {
+		initDataPage(page);
+	}
+	entry = header->numSlots;
+	if (header->liveSlots < header->numSlots) {
+		for (i = 0; i < header->numSlots; i++) {
+			if (!RM_SLOT_IS_FREE(&slots[i])) {
+				continue;
+			}
+			if (entry == header->numSlots) {
+				entry = i;
+			}
+			if (RM_SLOT_LENGTH(&slots[i]) >= len) {
+				slot = i;
+				break;
+			}
+		}
+	}
+	if (slot < 0) {
+		offset = pageAllocate(page, len, entry == header->numSlots);
+		if (offset < 0) {
+			return -1;
+		}
+		slot = entry;
+		if (slot == header->numSlots) {
+			header->numSlots += 1;
+		}
+		slots[slot].offset = offset;
+	}
+	slots[slot].length = len;
+	memcpy(page + slots[slot].offset, data, len);
+	header->liveSlots += 1;
+	return slot;
+}
+
+/**
+ * @brief writes new bytes for the record in a slot, the slot number and its flags stay
+ *
+ * @param page
+ * @param slot
+ * @param data
+ * @param len
+ * @return RC RC_FAIL if the page has no room for the new bytes
+ */
+RC pageReplaceRecord (char *page, int slot, char *data, int len) {
+	RM_Slot *entry = &PAGE_SLOTS(page)[slot];
+	int flags = entry->length & RM_SLOT_FLAGS;
+	if (len > RM_SLOT_LENGTH(entry)) {
+		if (pageFreeBytes(page) + RM_SLOT_LENGTH(entry) < len) {
+			return RC_FAIL;
+		}
+		// the old bytes become free space before the record is placed again
+		entry->length = RM_SLOT_FREE;
+		int offset = pageAllocate(page, len, 0);
+		entry->offset = offset;
+	}
+	entry->length = len | flags;
+	memcpy(page + entry->offset, data, len);
+	return RC_OK;
+}
+
+/**
+ * @brief frees the slot of a record, its bytes stay a hole for a record that fits
+ *
+ * @param page
+ * @param slot
+ * @return void
+ */
+void pageDeleteRecord (char *page, int slot) {
+	RM_Slot *entry = &PAGE_SLOTS(page)[slot];
+	entry->length = RM_SLOT_LENGTH(entry) | RM_SLOT_FREE;
+	((RM_PageHeader *) page)->liveSlots -= 1;
+}
+
+/**
+ * @brief finds the slot of a record on a pinned page
+ *
+ * @param page
+ * @param slot
+ * @param result set to the slot entry
+ * @return RC RC_RM_NO_MORE_TUPLES if the page has no such slot, RC_RM_DELETED_TUPLES if it is free
+ */
+RC pageFindRecord (char *page, int slot, RM_Slot **result) {
+	RM_PageHeader *header = (RM_PageHeader *) page;
+	if (header->freeOffset == 0 || slot < 0 || slot >= header->numSlots) {
+		return RC_RM_NO_MORE_TUPLES;
+	}
+	*result = &PAGE_SLOTS(page)[slot];
+	if (RM_SLOT_IS_FREE(*result)) {
+		return RC_RM_DELETED_TUPLES;
+	}
+	return RC_OK;
+}
+
+/**
+ * @brief where the value of an attribute of a slot lives on a PAX page
+ * @details the slot directory has room for slotMax entries; the minipage of
+ *          an attribute follows it at slotMax times the attribute's offset in
+ *          Record.data, its values are packed one after the other
+ * @param page
+ * @param layout
+ * @param slotMax
+ * @param attr
+ * @param slot
+ * @return char*
+ */
+char *paxValue (char *page, SchemaLayout *layout, int slotMax, int attr, int slot) {
+	return page + sizeof(RM_PageHeader) + slotMax * sizeof(RM_Slot)
+		+ slotMax * layout->offsets[attr] + slot * layout->sizes[attr];
+}
+
+/**
+ * @brief room of a PAX page as the free space map sees it, a record and its
+ *        slot entry for every slot not live
+ *
+ * @param page
+ * @param slotMax
+ * @param recordSize
+ * @return int
+ */
+int paxFreeSpace (char *page, int slotMax, int recordSize) {
+	RM_PageHeader *header = (RM_PageHeader *) page;
+	if (header->freeOffset == 0) {
+		return PAGE_SIZE - sizeof(RM_PageHeader);
+	}
+	return (slotMax - header->liveSlots) * (recordSize + sizeof(RM_Slot));
+}
+
+/**
+ * @brief places a record on a PAX page, in the first free slot
+ *
+ * @param page
+ * @param schema
+ * @param slotMax
+ * @param data Record.data bytes
+ * @return int the slot, -1 if the page is full
+ */
+int paxInsertRecord (char *page, Schema *schema, int slotMax, char *data) {
+	RM_PageHeader *header = (RM_PageHeader *) page;
+	RM_Slot *slots = PAGE_SLOTS(page);
+	int slot = -1, i;
+	if (header->freeOffset == 0) {
+		initDataPage(page);
+	}
+	if (header->liveSlots < header->numSlots) {
+		for (i = 0; i < header->numSlots && slot < 0; i++) {
+			if (RM_SLOT_IS_FREE(&slots[i])) {
+				slot = i;
+			}
+		}
+	} else if (header->numSlots < slotMax) {
+		slot = header->numSlots++;
+	} else {
+		return -1;
+	}
+	slots[slot].offset = 0;
+	slots[slot].length = schema->layout->recordSize;
+	paxWriteRecord(page, schema, slotMax, slot, data);
+	header->liveSlots += 1;
+	return slot;
+}
+
+/**
+ * @brief spreads the attributes of a record over the minipages of its slot
+ *
+ * @param page
+ * @param schema
+ * @param slotMax
+ * @param slot
+ * @param data
+ * @return void
+ */
+void paxWriteRecord (char *page, Schema *schema, int slotMax, int slot, char *data) {
+	SchemaLayout *layout = schema->layout;
+	int attr;
+	for (attr = 0; attr < schema->numAttr; attr++) {
+		memcpy(paxValue(page, layout, slotMax, attr, slot), data + layout->offsets[attr], layout->sizes[attr]);
+	}
+}
+
+/**
+ * @brief gathers the attributes of the record in a slot from the minipages
+ *
+ * @param page
+ * @param schema
+ * @param slotMax
+ * @param slot
+ * @param data
+ * @param attrs the attributes to read, NULL for all; the other bytes stay
+ * @return void
+ */
+void paxReadRecord (char *page, Schema *schema, int slotMax, int slot, char *data, bool *attrs) {
+	SchemaLayout *layout = schema->layout;
+	int attr;
+	for (attr = 0; attr < schema->numAttr; attr++) {
+		if (attrs && !attrs[attr]) {
+			continue;
+		}
+		memcpy(data + layout->offsets[attr], paxValue(page, layout, slotMax, attr, slot), layout->sizes[attr]);
+	}
+}
@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stddef.h>
 
 #include "dberror.h"
 #include "tables.h"
@@ -108,22 +109,149 @@ serializeTableContent(RM_TableData *rel)
 
 char *
 serializeRecordMtdt(RM_RecordMtdt * recordMtdt) {
-	int i;
 	VarString *result;
 	MAKE_VARSTRING(result);
 
-	APPEND(result, "tupleLen {%i} schemaLen {%i} slotLen {%i} slotMax {%i} slotOffset {%i} pageOffset {%i} schemaStr {%s}",
+	APPEND(result, "tupleLen {%i} schemaLen {%i} slotLen {%i} slotMax {%i} slotOffset {%i} pageOffset {%i} schemaStr {%s} version {%i} varLength {%i}",
 		recordMtdt->tupleLen,
 		recordMtdt->schemaLen,
 		recordMtdt->slotLen,
 		recordMtdt->slotMax,
 		recordMtdt->slotOffset,
 		recordMtdt->pageOffset,
-		recordMtdt->schemaStr
+		recordMtdt->schemaStr,
+		recordMtdt->version,
+		recordMtdt->varLength
 	);
 	RETURN_STRING(result);
 }
 
+// binary table header
+// RM_FORMAT_BINARY headers end before the layout
+static int
+tableHeaderLength (int version)
+{
+	return version >= RM_FORMAT_LAYOUT ? (int) sizeof(RM_TableHeader) : (int) offsetof(RM_TableHeader, layout);
+}
+
+int
+getTableHeaderSize (Schema *schema)
+{
+	int size = sizeof(RM_TableHeader) + schema->numAttr * sizeof(RM_AttrEntry) + schema->keySize * sizeof(int);
+	int i;
+	for (i = 0; i < schema->numAttr; i++)
+		size += strlen(schema->attrNames[i]) + 1;
+	return size;
+}
+
+int
+isBinaryTableHeader (char *page)
+{
+	return ((RM_TableHeader *) page)->magic == RM_HEADER_MAGIC;
+}
+
+// counters of the table only, the schema part never changes
+void
+updateTableHeaderPage (char *page, RM_RecordMtdt *recordMtdt)
+{
+	RM_TableHeader *header = (RM_TableHeader *) page;
+	header->magic = RM_HEADER_MAGIC;
+	header->version = recordMtdt->version;
+	header->tupleLen = recordMtdt->tupleLen;
+	header->slotLen = recordMtdt->slotLen;
+	header->slotMax = recordMtdt->slotMax;
+	header->slotOffset = recordMtdt->slotOffset;
+	header->pageOffset = recordMtdt->pageOffset;
+	header->varLength = recordMtdt->varLength;
+	if (recordMtdt->version >= RM_FORMAT_LAYOUT)
+		header->layout = recordMtdt->layout;
+}
+
+// the whole header, page needs getTableHeaderSize(schema) bytes
+void
+writeTableHeaderPage (char *page, RM_RecordMtdt *recordMtdt, Schema *schema)
+{
+	RM_TableHeader *header = (RM_TableHeader *) page;
+	RM_AttrEntry *attrs = (RM_AttrEntry *) (page + sizeof(RM_TableHeader));
+	int *keys = (int *) (attrs + schema->numAttr);
+	char *names = (char *) (keys + schema->keySize);
+	int i;
+
+	updateTableHeaderPage(page, recordMtdt);
+	header->numAttr = schema->numAttr;
+	header->keySize = schema->keySize;
+	for (i = 0; i < schema->numAttr; i++)
+	{
+		attrs[i].dataType = schema->dataTypes[i];
+		attrs[i].typeLength = schema->typeLength[i];
+		attrs[i].offset = schema->layout->offsets[i];
+		attrs[i].nameLen = strlen(schema->attrNames[i]);
+		memcpy(names, schema->attrNames[i], attrs[i].nameLen + 1);
+		names += attrs[i].nameLen + 1;
+	}
+	memcpy(keys, schema->keyAttrs, schema->keySize * sizeof(int));
+}
+
+RM_RecordMtdt *
+readTableHeaderPage (char *page)
+{
+	RM_TableHeader *header = (RM_TableHeader *) page;
+	RM_RecordMtdt *recordMtdt = (RM_RecordMtdt *) calloc(1, sizeof(RM_RecordMtdt));
+	recordMtdt->version = header->version;
+	recordMtdt->tupleLen = header->tupleLen;
+	recordMtdt->slotLen = header->slotLen;
+	recordMtdt->slotMax = header->slotMax;
+	recordMtdt->slotOffset = header->slotOffset;
+	recordMtdt->pageOffset = header->pageOffset;
+	recordMtdt->varLength = header->varLength;
+	recordMtdt->layout = header->version >= RM_FORMAT_LAYOUT ? header->layout : RM_LAYOUT_ROW;
+	return recordMtdt;
+}
+
+Schema *
+readTableSchema (char *page)
+{
+	RM_TableHeader *header = (RM_TableHeader *) page;
+	RM_AttrEntry *attrs = (RM_AttrEntry *) (page + tableHeaderLength(header->version));
+	int *keys = (int *) (attrs + header->numAttr);
+	char *names = (char *) (keys + header->keySize);
+	Schema *schema = (Schema *) malloc(sizeof(Schema));
+	int i;
+
+	schema->numAttr = header->numAttr;
+	schema->keySize = header->keySize;
+	schema->attrNames = (char **) malloc(sizeof(char *) * schema->numAttr);
+	schema->dataTypes = (DataType *) malloc(sizeof(DataType) * schema->numAttr);
+	schema->typeLength = (int *) malloc(sizeof(int) * schema->numAttr);
+	schema->keyAttrs = (int *) malloc(sizeof(int) * (schema->keySize > 0 ? schema->keySize : 1));
+	for (i = 0; i < schema->numAttr; i++)
+	{
+		schema->dataTypes[i] = attrs[i].dataType;
+		schema->typeLength[i] = attrs[i].typeLength;
+		schema->attrNames[i] = (char *) malloc(attrs[i].nameLen + 1);
+		memcpy(schema->attrNames[i], names, attrs[i].nameLen + 1);
+		names += attrs[i].nameLen + 1;
+	}
+	memcpy(schema->keyAttrs, keys, schema->keySize * sizeof(int));
+	buildSchemaLayout(schema);
+	return schema;
+}
+
+// frees a schema built by readTableSchema or deserializeSchema
+void
+freeTableSchema (Schema *schema)
+{
+	int i;
+	for (i = 0; i < schema->numAttr; i++)
+		free(schema->attrNames[i]);
+	free(schema->attrNames);
+	free(schema->dataTypes);
+	free(schema->keyAttrs);
+	free(schema->typeLength);
+	freeSchemaLayout(schema);
+	free(schema);
+}
+
 int
 strtoi(char *delim, int cut_count) {
 	char *ptr, *temp;
@@ -151,7 +279,7 @@ strtochar(char *delim, int cut_count) {
 	for (i = 0; i < cut_count; i++) {
 		temp = strtok(NULL, delim);
 	}
-	ptr = (char *) malloc(sizeof(char) * strlen(temp));
+	ptr = (char *) malloc(sizeof(char) * (strlen(temp) + 1));
 	return strcpy(ptr, temp);
 }
 
@@ -159,7 +287,13 @@ RM_RecordMtdt *
 deserializeRecordMtdt(char * str) {
 	RM_RecordMtdt *recordMtdt = (RM_RecordMtdt *) malloc(sizeof(RM_RecordMtdt));
 	char *delim = "{}";
-	char strcp[strlen(str)];
+	char strcp[strlen(str) + 1];
+	// headers written before the version field hold text slots
+	char *version = strstr(str, "} version {");
+	recordMtdt->version = version ? atoi(version + strlen("} version {")) : RM_FORMAT_TEXT;
+	char *varLength = strstr(str, "} varLength {");
+	recordMtdt->varLength = varLength ? atoi(varLength + strlen("} varLength {")) : 0;
+	recordMtdt->layout = RM_LAYOUT_ROW;
 	strcpy(strcp, str);
 	strtok(strcp, delim);
 	recordMtdt->tupleLen = strtoi(delim, 1);
@@ -185,7 +319,7 @@ void setKeyIndex(Schema *schema, char *temp, int index) {
 void
 deserializeSchemaKeys(char *str, Schema *schema) {
 	char *temp;
-	char strcp[strlen(str)];
+	char strcp[strlen(str) + 1];
 	strcpy(strcp, str);
 	temp = strtok(strcp, ",");
 
@@ -222,7 +356,7 @@ deserializeSchemaAttr(char *str_origin, Schema *schema) {
 	int i;
 	char *delim = ",";
 	// format string to "x, a: INT, b: STRING[4], c: INT,"
-	char str[strlen(str_origin) + 2];
+	char str[strlen(str_origin) + 5];
 	strcpy(str, "x, ");
 	strcat(str, str_origin);
 	strcat(str, delim);
@@ -240,7 +374,7 @@ deserializeSchemaAttr(char *str_origin, Schema *schema) {
 			schema->dataTypes[i] = DT_BOOL;
 		} else if (strncmp(temp, " STRING", 7) == 0) {
 			schema->dataTypes[i] = DT_STRING;
-			typeLengthTemp[i] = (char *) malloc(sizeof(char) * strlen(temp));
+			typeLengthTemp[i] = (char *) malloc(sizeof(char) * (strlen(temp) + 1));
 			strcpy(typeLengthTemp[i], temp);
 		}
 	}
@@ -254,7 +388,7 @@ deserializeSchema(char * str)
 	// "Schema with <3> attributes (a: INT, b: STRING[4], c: INT) with keys: (a)\n"
 	Schema *schema = (Schema *) malloc(sizeof(Schema));
 	char *attrs, *keys;
-	char strcp[strlen(str)];
+	char strcp[strlen(str) + 1];
 	// copy str to strcp because do split token after
 	strcpy(strcp, str);
 	// get the number of attributes
@@ -272,6 +406,7 @@ deserializeSchema(char * str)
 	// split attr and key
 	deserializeSchemaAttr(attrs, schema);
 	deserializeSchemaKeys(keys, schema);
+	buildSchemaLayout(schema);
 	free(keys);
 	free(attrs);
 	return schema;
@@ -348,7 +483,7 @@ serializeAttr(Record *record, Schema *schema, int attrNum)
 	VarString *result;
 	MAKE_VARSTRING(result);
 
-	attrOffset(schema, attrNum, &offset);
+	offset = schema->layout->offsets[attrNum];
 	attrData = record->data + offset;
 
 	switch(schema->dataTypes[attrNum])
@@ -455,26 +590,144 @@ stringToValue(char *val)
 RC 
 attrOffset (Schema *schema, int attrNum, int *result)
 {
-	int offset = 0;
-	int attrPos = 0;
+	*result = schema->layout->offsets[attrNum];
+	return RC_OK;
+}
+
+// offsets and sizes of the attributes, records are packed in attribute
+// order since Record.data is what the pages store
+void
+buildSchemaLayout (Schema *schema)
+{
+	SchemaLayout *layout = (SchemaLayout *) malloc(sizeof(SchemaLayout));
+	int i, n = schema->numAttr > 0 ? schema->numAttr : 1;
 
-	for(attrPos = 0; attrPos < attrNum; attrPos++)
-		switch (schema->dataTypes[attrPos])
+	layout->offsets = (int *) malloc(sizeof(int) * n);
+	layout->sizes = (int *) malloc(sizeof(int) * n);
+	layout->recordSize = 0;
+	for (i = 0; i < schema->numAttr; i++)
+	{
+		switch (schema->dataTypes[i])
 		{
 		case DT_STRING:
-			offset += schema->typeLength[attrPos];
+			layout->sizes[i] = schema->typeLength[i];
 			break;
 		case DT_INT:
-			offset += sizeof(int);
+			layout->sizes[i] = sizeof(int);
 			break;
 		case DT_FLOAT:
-			offset += sizeof(float);
+			layout->sizes[i] = sizeof(float);
 			break;
 		case DT_BOOL:
-			offset += sizeof(bool);
+			layout->sizes[i] = sizeof(bool);
+			break;
+		default:
+			layout->sizes[i] = 0;
 			break;
 		}
+		layout->offsets[i] = layout->recordSize;
+		layout->recordSize += layout->sizes[i];
+	}
+	schema->layout = layout;
+}
 
-	*result = offset;
-	return RC_OK;
+void
+freeSchemaLayout (Schema *schema)
+{
+	if (schema->layout == NULL)
+		return;
+	free(schema->layout->offsets);
+	free(schema->layout->sizes);
+	free(schema->layout);
+	schema->layout = NULL;
+}
+
+// binary record encoding of variable length tables:
+// INT/FLOAT/BOOL raw, STRING as a 2 byte length and its bytes
+int
+isVarLengthSchema (Schema *schema)
+{
+	int i;
+	for (i = 0; i < schema->numAttr; i++)
+		if (schema->dataTypes[i] == DT_STRING && schema->typeLength[i] >= RM_VARLEN_MIN_STRING)
+			return TRUE;
+	return FALSE;
+}
+
+int
+getMaxEncodedSize (Schema *schema)
+{
+	int size = getRecordSize(schema);
+	int i;
+	for (i = 0; i < schema->numAttr; i++)
+		if (schema->dataTypes[i] == DT_STRING)
+			size += sizeof(unsigned short);
+	// a record can always be replaced by a forwarding RID
+	return size < (int) sizeof(RID) ? (int) sizeof(RID) : size;
+}
+
+int
+encodeRecord (Schema *schema, char *data, char *buf)
+{
+	int i, size, len = 0;
+	unsigned short strLen;
+
+	for (i = 0; i < schema->numAttr; i++)
+	{
+		size = schema->layout->sizes[i];
+		if (schema->dataTypes[i] == DT_STRING)
+		{
+			strLen = strnlen(data, size);
+			memcpy(buf + len, &strLen, sizeof(strLen));
+			memcpy(buf + len + sizeof(strLen), data, strLen);
+			len += sizeof(strLen) + strLen;
+			data += size;
+			continue;
+		}
+		memcpy(buf + len, data, size);
+		len += size;
+		data += size;
+	}
+	if (len < (int) sizeof(RID))
+	{
+		memset(buf + len, 0, sizeof(RID) - len);
+		len = sizeof(RID);
+	}
+	return len;
+}
+
+void
+decodeRecord (Schema *schema, char *buf, char *data)
+{
+	decodeRecordAttrs(schema, buf, data, NULL);
+}
+
+// decodes the attributes marked in attrs (all for NULL), the bytes of the
+// others in data stay as they are
+void
+decodeRecordAttrs (Schema *schema, char *buf, char *data, bool *attrs)
+{
+	int i, size;
+	unsigned short strLen;
+
+	for (i = 0; i < schema->numAttr; i++)
+	{
+		size = schema->layout->sizes[i];
+		if (schema->dataTypes[i] == DT_STRING)
+		{
+			memcpy(&strLen, buf, sizeof(strLen));
+			if (!attrs || attrs[i])
+			{
+				memcpy(data, buf + sizeof(strLen), strLen);
+				memset(data + strLen, 0, size - strLen);
+			}
+			buf += sizeof(strLen) + strLen;
+			data += size;
+			continue;
+		}
+		if (!attrs || attrs[i])
+			memcpy(data, buf, size);
+		buf += size;
+		data += size;
+	}
 }
@@ -0,0 +1,439 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dberror.h"
+#include "record_mgr.h"
+
+/**
+ * @brief bytes of the zone of one data page of a schema
+ *
+ * @param schema
+ * @return int
+ */
+int zoneSize (Schema *schema) {
+	return sizeof(RM_Zone) + 2 * schema->numAttr * sizeof(RM_ZoneValue);
+}
+
+/**
+ * @brief the zone of a data page, the map grows to hold it
+ *
+ * @param mgmtData
+ * @param page
+ * @return RM_Zone*
+ */
+RM_Zone *getZone (RM_RecordMtdt *mgmtData, int page) {
+	if (page > mgmtData->zonePages) {
+		int pages = mgmtData->zonePages ? mgmtData->zonePages : 64;
+		while (pages < page) {
+			pages *= 2;
+		}
+		mgmtData->zones = (char *) realloc(mgmtData->zones, (long) pages * mgmtData->zoneSize);
+		// new zones hold no record
+		memset(mgmtData->zones + (long) mgmtData->zonePages * mgmtData->zoneSize, 0,
+			(long) (pages - mgmtData->zonePages) * mgmtData->zoneSize);
+		mgmtData->zonePages = pages;
+	}
+	return (RM_Zone *) (mgmtData->zones + (long) (page - 1) * mgmtData->zoneSize);
+}
+
+/**
+ * @brief whether an attribute has bounds in the zone map
+ *
+ * @param dt
+ * @return bool
+ */
+static bool zoneTracks (DataType dt) {
+	return dt == DT_INT || dt == DT_FLOAT || dt == DT_BOOL;
+}
+
+/**
+ * @brief compares two values of a tracked attribute
+ *
+ * @param dt
+ * @param left
+ * @param right
+ * @return int below, equal to or above 0
+ */
+static int zoneCompare (DataType dt, RM_ZoneValue left, RM_ZoneValue right) {
+	if (dt == DT_FLOAT) {
+		return (left.floatV > right.floatV) - (left.floatV < right.floatV);
+	}
+	return (left.intV > right.intV) - (left.intV < right.intV);
+}
+
+/**
+ * @brief reads a tracked attribute from Record.data bytes
+ *
+ * @param schema
+ * @param data
+ * @param attr
+ * @return RM_ZoneValue
+ */
+static RM_ZoneValue zoneValueOf (Schema *schema, char *data, int attr) {
+	char *value = data + schema->layout->offsets[attr];
+	RM_ZoneValue result;
+	bool boolV;
+	if (schema->dataTypes[attr] == DT_BOOL) {
+		memcpy(&boolV, value, sizeof(bool));
+		result.intV = boolV ? 1 : 0;
+	} else {
+		// ints and floats share the bytes of the union
+		memcpy(&result, value, sizeof(RM_ZoneValue));
+	}
+	return result;
+}
+
+/**
+ * @brief widens the bounds of a page to the values of a record, the first
+ *        record of an empty zone sets them
+ *
+ * @param mgmtData
+ * @param schema
+ * @param page
+ * @param data Record.data bytes
+ * @return void
+ */
+void zoneWiden (RM_RecordMtdt *mgmtData, Schema *schema, int page, char *data) {
+	RM_Zone *zone = getZone(mgmtData, page);
+	RM_ZoneValue *min = zone->bounds, *max = zone->bounds + schema->numAttr;
+	RM_ZoneValue value;
+	int attr;
+	for (attr = 0; attr < schema->numAttr; attr++) {
+		if (!zoneTracks(schema->dataTypes[attr])) {
+			continue;
+		}
+		value = zoneValueOf(schema, data, attr);
+		if (zone->count == 0 || zoneCompare(schema->dataTypes[attr], value, min[attr]) < 0) {
+			min[attr] = value;
+		}
+		if (zone->count == 0 || zoneCompare(schema->dataTypes[attr], value, max[attr]) > 0) {
+			max[attr] = value;
+		}
+	}
+}
+
+/**
+ * @brief counts a new record of a page in its zone
+ *
+ * @param mgmtData
+ * @param schema
+ * @param page
+ * @param data Record.data bytes
+ * @return void
+ */
+void zoneAddRecord (RM_RecordMtdt *mgmtData, Schema *schema, int page, char *data) {
+	zoneWiden(mgmtData, schema, page, data);
+	getZone(mgmtData, page)->count += 1;
+}
+
+/**
+ * @brief takes a deleted record off the count of its page, the bounds stay
+ *
+ * @param mgmtData
+ * @param page
+ * @return void
+ */
+void zoneRemoveRecord (RM_RecordMtdt *mgmtData, int page) {
+	RM_Zone *zone = getZone(mgmtData, page);
+	if (zone->count > 0) {
+		zone->count -= 1;
+	}
+}
+
+/**
+ * @brief whether a comparison of an attribute with a constant can hold for
+ *        a value within the bounds of a zone
+ *
+ * @param zone
+ * @param schema
+ * @param op OP_COMP_EQUAL or OP_COMP_SMALLER
+ * @param negated the comparison is under a NOT
+ * @return bool FALSE only if no value between the bounds matches
+ */
+static bool zoneCompareMayMatch (RM_Zone *zone, Schema *schema, Operator *op, bool negated) {
+	Expr *left = op->args[0], *right = op->args[1];
+	bool flipped = left->type == EXPR_CONST;
+	Expr *attrRef = flipped ? right : left, *cons = flipped ? left : right;
+	RM_ZoneValue value;
+	int attr, low, high;
+
+	if (attrRef->type != EXPR_ATTRREF || cons->type != EXPR_CONST) {
+		return TRUE;
+	}
+	attr = attrRef->expr.attrRef;
+	if (attr < 0 || attr >= schema->numAttr || !zoneTracks(schema->dataTypes[attr])
+			|| schema->dataTypes[attr] != cons->expr.cons->dt) {
+		return TRUE;
+	}
+	switch (cons->expr.cons->dt) {
+	case DT_FLOAT:
+		value.floatV = cons->expr.cons->v.floatV;
+		break;
+	case DT_BOOL:
+		value.intV = cons->expr.cons->v.boolV ? 1 : 0;
+		break;
+	default:
+		value.intV = cons->expr.cons->v.intV;
+		break;
+	}
+	// where the bounds lie against the constant
+	low = zoneCompare(schema->dataTypes[attr], zone->bounds[attr], value);
+	high = zoneCompare(schema->dataTypes[attr], zone->bounds[schema->numAttr + attr], value);
+	if (op->type == OP_COMP_EQUAL) {
+		return negated ? !(low == 0 && high == 0) : low <= 0 && high >= 0;
+	}
+	if (!flipped) {
+		// attr < c, NOT attr >= c
+		return negated ? high >= 0 : low < 0;
+	}
+	// c < attr, NOT attr <= c
+	return negated ? low <= 0 : high > 0;
+}
+
+/**
+ * @brief whether a condition can hold for a record within the bounds of a zone
+ *
+ * @param zone
+ * @param schema
+ * @param cond
+ * @param negated the condition is under a NOT
+ * @return bool FALSE only if no record of the zone matches
+ */
+static bool zoneExprMayMatch (RM_Zone *zone, Schema *schema, Expr *cond, bool negated) {
+	Operator *op;
+	bool left, right;
+	if (cond->type != EXPR_OP) {
+		return TRUE;
+	}
+	op = cond->expr.op;
+	switch (op->type) {
+	case OP_BOOL_NOT:
+		return zoneExprMayMatch(zone, schema, op->args[0], !negated);
+	case OP_BOOL_AND:
+	case OP_BOOL_OR:
+		left = zoneExprMayMatch(zone, schema, op->args[0], negated);
+		right = zoneExprMayMatch(zone, schema, op->args[1], negated);
+		// NOT (a AND b) is NOT a OR NOT b
+		if ((op->type == OP_BOOL_AND) != negated) {
+			return left && right;
+		}
+		return left || right;
+	case OP_COMP_EQUAL:
+	case OP_COMP_SMALLER:
+		return zoneCompareMayMatch(zone, schema, op, negated);
+	default:
+		return TRUE;
+	}
+}
+
+/**
+ * @brief whether a scan has to pin a data page
+ * @details a page without records is passed over, as is one whose bounds
+ *          show no record can match comparisons of attributes with
+ *          constants joined by AND, OR and NOT
+ * @param mgmtData
+ * @param schema
+ * @param page
+ * @param cond NULL matches every record
+ * @return bool FALSE only if the page holds no matching record
+ */
+bool zoneMayMatch (RM_RecordMtdt *mgmtData, Schema *schema, int page, Expr *cond) {
+	RM_Zone *zone;
+	if (!mgmtData->zoneReady || page > mgmtData->zonePages) {
+		return TRUE;
+	}
+	zone = getZone(mgmtData, page);
+	if (zone->count == 0) {
+		return FALSE;
+	}
+	return cond == NULL || zoneExprMayMatch(zone, schema, cond, FALSE);
+}
+
+/**
+ * @brief the name of the zone map file of a table
+ *
+ * @param name
+ * @return char* to be freed
+ */
+static char *zoneFileName (char *name) {
+	char *result = (char *) malloc(strlen(name) + strlen(RM_ZONE_SUFFIX) + 1);
+	sprintf(result, "%s%s", name, RM_ZONE_SUFFIX);
+	return result;
+}
+
+/**
+ * @brief reads the zone map saved by closeTable()
+ *
+ * @param rel
+ * @param fh
+ * @return RC RC_FAIL if the file does not belong to the table as it is
+ */
+static RC readZoneMap (RM_TableData *rel, SM_FileHandle *fh) {
+	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) rel->mgmtData;
+	RM_ZoneFileHeader header;
+	char page[PAGE_SIZE];
+	long size, offset;
+	int block;
+	RC result = readBlock(0, fh, page);
+
+	if (result != RC_OK) {
+		return result;
+	}
+	memcpy(&header, page, sizeof(header));
+	if (header.magic != RM_ZONE_MAGIC || header.zoneSize != mgmtData->zoneSize
+			|| header.numPages != mgmtData->pageOffset) {
+		return RC_FAIL;
+	}
+	size = (long) header.numPages * header.zoneSize;
+	if ((long) sizeof(header) + size > (long) fh->totalNumPages * PAGE_SIZE) {
+		return RC_FAIL;
+	}
+	getZone(mgmtData, header.numPages);
+	offset = PAGE_SIZE - sizeof(header);
+	memcpy(mgmtData->zones, page + sizeof(header), size < offset ? size : offset);
+	for (block = 1; offset < size; block++, offset += PAGE_SIZE) {
+		result = readBlock(block, fh, page);
+		if (result != RC_OK) {
+			return result;
+		}
+		memcpy(mgmtData->zones + offset, page, size - offset < PAGE_SIZE ? size - offset : PAGE_SIZE);
+	}
+	return RC_OK;
+}
+
+/**
+ * @brief builds the zone map of a table from its records
+ *
+ * @param rel
+ * @return RC
+ */
+static RC buildZoneMap (RM_TableData *rel) {
+	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) rel->mgmtData;
+	RM_ScanHandle scan;
+	Record *record;
+	RC result;
+
+	if (mgmtData->zonePages > 0) {
+		memset(mgmtData->zones, 0, (long) mgmtData->zonePages * mgmtData->zoneSize);
+	}
+	createRecord(&record, rel->schema);
+	result = startScan(rel, &scan, NULL);
+	while (result == RC_OK && (result = next(&scan, record)) == RC_OK) {
+		zoneAddRecord(mgmtData, rel->schema, record->id.page, record->data);
+	}
+	closeScan(&scan);
+	freeRecord(record);
+	return result == RC_RM_NO_MORE_TUPLES ? RC_OK : result;
+}
+
+/**
+ * @brief loads the zone map of an opened table, it is built from the
+ *        records when the table has none saved
+ * @details the file is removed once read, so a table not closed after its
+ *          records changed gets its map built again on the next open
+ * @param rel
+ * @return RC
+ */
+RC loadZoneMap (RM_TableData *rel) {
+	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) rel->mgmtData;
+	char *name = zoneFileName(rel->name);
+	SM_FileHandle fh;
+	RC result = RC_FAIL;
+
+	mgmtData->zones = NULL;
+	mgmtData->zonePages = 0;
+	mgmtData->zoneSize = zoneSize(rel->schema);
+	mgmtData->zoneReady = FALSE;
+	if (openPageFile(name, &fh) == RC_OK) {
+		result = readZoneMap(rel, &fh);
+		closePageFile(&fh);
+		destroyPageFile(name);
+	}
+	free(name);
+	if (result != RC_OK) {
+		result = buildZoneMap(rel);
+	}
+	getZone(mgmtData, mgmtData->pageOffset);
+	mgmtData->zoneReady = result == RC_OK;
+	return result;
+}
+
+/**
+ * @brief writes the zone map of a table to its file and frees it
+ *
+ * @param rel
+ * @return RC
+ */
+RC saveZoneMap (RM_TableData *rel) {
+	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) rel->mgmtData;
+	char *name = zoneFileName(rel->name);
+	RM_ZoneFileHeader header;
+	SM_FileHandle fh;
+	char page[PAGE_SIZE];
+	long size, offset, length;
+	int block;
+	RC result = RC_OK;
+
+	if (!mgmtData->zoneReady) {
+		// a map not to be trusted is not saved, the next open builds it
+		free(name);
+		free(mgmtData->zones);
+		mgmtData->zones = NULL;
+		return RC_OK;
+	}
+	header.magic = RM_ZONE_MAGIC;
+	header.zoneSize = mgmtData->zoneSize;
+	header.numPages = mgmtData->pageOffset;
+	getZone(mgmtData, header.numPages);
+	size = (long) header.numPages * header.zoneSize;
+
+	result = createPageFile(name);
+	if (result == RC_OK) {
+		result = openPageFile(name, &fh);
+	}
+	for (block = 0, offset = 0; result == RC_OK && (block == 0 || offset < size); block++) {
+		memset(page, 0, PAGE_SIZE);
+		if (block == 0) {
+			memcpy(page, &header, sizeof(header));
+			length = PAGE_SIZE - sizeof(header);
+			length = size < length ? size : length;
+			memcpy(page + sizeof(header), mgmtData->zones, length);
+		} else {
+			length = size - offset < PAGE_SIZE ? size - offset : PAGE_SIZE;
+			memcpy(page, mgmtData->zones + offset, length);
+		}
+		offset += length;
+		result = ensureCapacity(block + 1, &fh);
+		if (result == RC_OK) {
+			result = writeBlock(block, &fh, page);
+		}
+	}
+	if (block > 0) {
+		closePageFile(&fh);
+	}
+	if (result != RC_OK) {
+		destroyPageFile(name);
+	}
+	free(name);
+	free(mgmtData->zones);
+	mgmtData->zones = NULL;
+	return result;
+}
+
+/**
+ * @brief removes the zone map file of a table, if it has one
+ *
+ * @param name
+ * @return RC
+ */
+RC dropZoneMap (char *name) {
+	char *zoneName = zoneFileName(name);
+	SM_FileHandle fh;
+	if (openPageFile(zoneName, &fh) == RC_OK) {
+		closePageFile(&fh);
+		destroyPageFile(zoneName);
+	}
+	free(zoneName);
+	return RC_OK;
+}
@@ -0,0 +1,577 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include "storage_backend.h"
+#include "dberror.h"
+
+static SM_StorageBackend *defaultBackend = &posixStorageBackend;
+
+/**
+ * @brief picks the backend of a page file
+ *
+ * @param fileName
+ * @return SM_StorageBackend*
+ */
+SM_StorageBackend *getStorageBackend(const char *fileName) {
+    if (strncmp(fileName, SM_MEMORY_PREFIX, strlen(SM_MEMORY_PREFIX)) == 0) {
+        return &memoryStorageBackend;
+    }
+    return defaultBackend;
+}
+
+SM_StorageBackend *getDefaultStorageBackend() {
+    return defaultBackend;
+}
+
+/**
+ * @brief sets the backend of page files without SM_MEMORY_PREFIX,
+ *        handles opened before keep their backend
+ *
+ * @param backend NULL restores the POSIX backend
+ */
+void setDefaultStorageBackend(SM_StorageBackend *backend) {
+    defaultBackend = backend ? backend : &posixStorageBackend;
+}
+
+// ************************************************************
+// POSIX files, positioned I/O on a descriptor
+
+typedef struct SM_PosixFile {
+    int fd;
+} SM_PosixFile;
+
+static int posixExists(const char *fileName) {
+    return (access(fileName, F_OK) == 0);
+}
+
+static RC posixCreate(const char *fileName) {
+    int fd = open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return RC_FILE_NOT_FOUND;
+    }
+    close(fd);
+    return RC_OK;
+}
+
+static RC posixDestroy(const char *fileName) {
+    return unlink(fileName) == 0 ? RC_OK : RC_FILE_NOT_FOUND;
+}
+
+static RC posixOpen(const char *fileName, void **file) {
+    int fd = open(fileName, O_RDWR);
+    if (fd < 0) {
+        return RC_FILE_NOT_FOUND;
+    }
+    SM_PosixFile *pf = (SM_PosixFile *) malloc(sizeof(SM_PosixFile));
+    pf->fd = fd;
+    *file = pf;
+    return RC_OK;
+}
+
+static RC posixClose(void *file) {
+    SM_PosixFile *pf = (SM_PosixFile *) file;
+    int rc = close(pf->fd);
+    free(pf);
+    return rc == 0 ? RC_OK : RC_FILE_NOT_FOUND;
+}
+
+static long posixSize(void *file) {
+    struct stat st;
+    if (fstat(((SM_PosixFile *) file)->fd, &st) != 0) {
+        return -1;
+    }
+    return (long) st.st_size;
+}
+
+static RC posixRead(void *file, long offset, char *buf, int len) {
+    int fd = ((SM_PosixFile *) file)->fd;
+    while (len > 0) {
+        ssize_t n = pread(fd, buf, len, offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        // a short file reads as a missing page
+        if (n <= 0) {
+            return RC_READ_NON_EXISTING_PAGE;
+        }
+        buf += n;
+        offset += n;
+        len -= (int) n;
+    }
+    return RC_OK;
+}
+
+static RC posixWrite(void *file, long offset, const char *buf, int len) {
+    int fd = ((SM_PosixFile *) file)->fd;
+    while (len > 0) {
+        ssize_t n = pwrite(fd, buf, len, offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return RC_WRITE_FAILED;
+        }
+        buf += n;
+        offset += n;
+        len -= (int) n;
+    }
+    return RC_OK;
+}
+
+/**
+ * @brief moves count pages between the file and bufs with as few system
+ *        calls as the platform allows, short transfers are finished page by page
+ */
+static RC posixTransfer(void *file, long offset, char **bufs, int count, int writing) {
+    int i = 0;
+#if defined(__linux__)
+    int fd = ((SM_PosixFile *) file)->fd;
+    struct iovec iov[64];
+    while (i < count) {
+        int n = count - i, j;
+        if (n > 64) {
+            n = 64;
+        }
+        for (j = 0; j < n; j++) {
+            iov[j].iov_base = bufs[i + j];
+            iov[j].iov_len = PAGE_SIZE;
+        }
+        ssize_t done = writing ? pwritev(fd, iov, n, offset) : preadv(fd, iov, n, offset);
+        if (done < 0 && errno == EINTR) {
+            continue;
+        }
+        if (done <= 0) {
+            return writing ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
+        }
+        // whole pages done, a partial one is redone below
+        i += (int) (done / PAGE_SIZE);
+        offset += (done / PAGE_SIZE) * PAGE_SIZE;
+        if (done % PAGE_SIZE != 0) {
+            break;
+        }
+    }
+#endif
+    for (; i < count; i++, offset += PAGE_SIZE) {
+        RC rc = writing ? posixWrite(file, offset, bufs[i], PAGE_SIZE)
+                        : posixRead(file, offset, bufs[i], PAGE_SIZE);
+        if (rc != RC_OK) {
+            return rc;
+        }
+    }
+    return RC_OK;
+}
+
+static RC posixReadv(void *file, long offset, char **bufs, int count) {
+    return posixTransfer(file, offset, bufs, count, 0);
+}
+
+static RC posixWritev(void *file, long offset, char **bufs, int count) {
+    return posixTransfer(file, offset, bufs, count, 1);
+}
+
+static RC posixExtend(void *file, long newSize) {
+    long size = posixSize(file);
+    if (size < 0) {
+        return RC_WRITE_FAILED;
+    }
+    if (newSize <= size) {
+        return RC_OK;
+    }
+    return ftruncate(((SM_PosixFile *) file)->fd, newSize) == 0 ? RC_OK : RC_WRITE_FAILED;
+}
+
+static RC posixSync(void *file) {
+#if defined(__linux__)
+    int rc = fdatasync(((SM_PosixFile *) file)->fd);
+#else
+    int rc = fsync(((SM_PosixFile *) file)->fd);
+#endif
+    return rc == 0 ? RC_OK : RC_WRITE_FAILED;
+}
+
+SM_StorageBackend posixStorageBackend = {
+    "posix", posixExists, posixCreate, posixDestroy, posixOpen, posixClose, posixSize,
+    posixRead, posixWrite, posixReadv, posixWritev, posixExtend, posixSync
+};
+
+// ************************************************************
+// in-memory files, they live until destroyed or the process exits
+
+typedef struct SM_MemoryFile {
+    char *name;
+    char *data;
+    long size;
+    long capacity;
+    int openCount;
+    int removed;    // destroyed while open, freed on the last close
+    struct SM_MemoryFile *next;
+} SM_MemoryFile;
+
+static SM_MemoryFile *memoryFiles = NULL;
+// handles of one file may be used from several buffer pool threads
+static pthread_mutex_t memoryLock = PTHREAD_MUTEX_INITIALIZER;
+
+static SM_MemoryFile *findMemoryFile(const char *fileName) {
+    SM_MemoryFile *curr = memoryFiles;
+    while (curr && strcmp(curr->name, fileName) != 0) {
+        curr = curr->next;
+    }
+    return curr;
+}
+
+static void freeMemoryFile(SM_MemoryFile *mf) {
+    free(mf->name);
+    free(mf->data);
+    free(mf);
+}
+
+/**
+ * @brief grows the file to at least size bytes, new bytes are zero
+ */
+static RC memoryGrow(SM_MemoryFile *mf, long size) {
+    if (size <= mf->size) {
+        return RC_OK;
+    }
+    if (size > mf->capacity) {
+        long capacity = mf->capacity ? mf->capacity : PAGE_SIZE;
+        while (capacity < size) {
+            capacity *= 2;
+        }
+        char *data = (char *) realloc(mf->data, capacity);
+        if (!data) {
+            return RC_WRITE_FAILED;
+        }
+        mf->data = data;
+        mf->capacity = capacity;
+    }
+    memset(mf->data + mf->size, 0, size - mf->size);
+    mf->size = size;
+    return RC_OK;
+}
+
+static int memoryExists(const char *fileName) {
+    pthread_mutex_lock(&memoryLock);
+    int found = findMemoryFile(fileName) != NULL;
+    pthread_mutex_unlock(&memoryLock);
+    return found;
+}
+
+static RC memoryCreate(const char *fileName) {
+    pthread_mutex_lock(&memoryLock);
+    SM_MemoryFile *mf = findMemoryFile(fileName);
+    if (mf) {
+        mf->size = 0;
+    } else {
+        mf = (SM_MemoryFile *) calloc(1, sizeof(SM_MemoryFile));
+        mf->name = strdup(fileName);
+        mf->next = memoryFiles;
+        memoryFiles = mf;
+    }
+    pthread_mutex_unlock(&memoryLock);
+    return RC_OK;
+}
+
+static RC memoryDestroy(const char *fileName) {
+    pthread_mutex_lock(&memoryLock);
+    SM_MemoryFile **slot = &memoryFiles;
+    while (*slot && strcmp((*slot)->name, fileName) != 0) {
+        slot = &(*slot)->next;
+    }
+    SM_MemoryFile *mf = *slot;
+    if (mf) {
+        *slot = mf->next;
+        if (mf->openCount > 0) {
+            mf->removed = 1;
+        } else {
+            freeMemoryFile(mf);
+        }
+    }
+    pthread_mutex_unlock(&memoryLock);
+    return mf ? RC_OK : RC_FILE_NOT_FOUND;
+}
+
+static RC memoryOpen(const char *fileName, void **file) {
+    pthread_mutex_lock(&memoryLock);
+    SM_MemoryFile *mf = findMemoryFile(fileName);
+    if (mf) {
+        mf->openCount += 1;
+    }
+    pthread_mutex_unlock(&memoryLock);
+    *file = mf;
+    return mf ? RC_OK : RC_FILE_NOT_FOUND;
+}
+
+static RC memoryClose(void *file) {
+    SM_MemoryFile *mf = (SM_MemoryFile *) file;
+    pthread_mutex_lock(&memoryLock);
+    mf->openCount -= 1;
+    if (mf->openCount == 0 && mf->removed) {
+        freeMemoryFile(mf);
+    }
+    pthread_mutex_unlock(&memoryLock);
+    return RC_OK;
+}
+
+static long memorySize(void *file) {
+    pthread_mutex_lock(&memoryLock);
+    long size = ((SM_MemoryFile *) file)->size;
+    pthread_mutex_unlock(&memoryLock);
+    return size;
+}
+
+static RC memoryRead(void *file, long offset, char *buf, int len) {
+    SM_MemoryFile *mf = (SM_MemoryFile *) file;
+    RC rc = RC_READ_NON_EXISTING_PAGE;
+    pthread_mutex_lock(&memoryLock);
+    if (offset >= 0 && offset + len <= mf->size) {
+        memcpy(buf, mf->data + offset, len);
+        rc = RC_OK;
+    }
+    pthread_mutex_unlock(&memoryLock);
+    return rc;
+}
+
+static RC memoryWrite(void *file, long offset, const char *buf, int len) {
+    SM_MemoryFile *mf = (SM_MemoryFile *) file;
+    pthread_mutex_lock(&memoryLock);
+    RC rc = offset < 0 ? RC_WRITE_FAILED : memoryGrow(mf, offset + len);
+    if (rc == RC_OK) {
+        memcpy(mf->data + offset, buf, len);
+    }
+    pthread_mutex_unlock(&memoryLock);
+    return rc;
+}
+
+static RC memoryReadv(void *file, long offset, char **bufs, int count) {
+    SM_MemoryFile *mf = (SM_MemoryFile *) file;
+    RC rc = RC_READ_NON_EXISTING_PAGE;
+    int i;
+    pthread_mutex_lock(&memoryLock);
+    if (offset >= 0 && offset + (long) count * PAGE_SIZE <= mf->size) {
+        for (i = 0; i < count; i++) {
+            memcpy(bufs[i], mf->data + offset + (long) i * PAGE_SIZE, PAGE_SIZE);
+        }
+        rc = RC_OK;
+    }
+    pthread_mutex_unlock(&memoryLock);
+    return rc;
+}
+
+static RC memoryWritev(void *file, long offset, char **bufs, int count) {
+    SM_MemoryFile *mf = (SM_MemoryFile *) file;
+    int i;
+    pthread_mutex_lock(&memoryLock);
+    RC rc = offset < 0 ? RC_WRITE_FAILED : memoryGrow(mf, offset + (long) count * PAGE_SIZE);
+    for (i = 0; rc == RC_OK && i < count; i++) {
+        memcpy(mf->data + offset + (long) i * PAGE_SIZE, bufs[i], PAGE_SIZE);
+    }
+    pthread_mutex_unlock(&memoryLock);
+    return rc;
+}
+
+static RC memoryExtend(void *file, long newSize) {
+    pthread_mutex_lock(&memoryLock);
+    RC rc = memoryGrow((SM_MemoryFile *) file, newSize);
+    pthread_mutex_unlock(&memoryLock);
+    return rc;
+}
+
+static RC memorySync(void *file) {
+    // the bytes never leave memory, there is nothing to sync
+    (void) file;
+    return RC_OK;
+}
+
+SM_StorageBackend memoryStorageBackend = {
+    "memory", memoryExists, memoryCreate, memoryDestroy, memoryOpen, memoryClose, memorySize,
+    memoryRead, memoryWrite, memoryReadv, memoryWritev, memoryExtend, memorySync
+};
+
+// ************************************************************
+// synthetic device latency in front of another backend
+
+typedef struct SM_LatencyFile {
+    void *file;
+    SM_StorageBackend *inner;
+    long head;      // page after the last request, where an HDD head would be
+} SM_LatencyFile;
+
+static SM_StorageBackend *latencyInner = &posixStorageBackend;
+static SM_LatencyConfig latencyConfig;
+static SM_LatencyStats latencyStats;
+static unsigned int latencySeed = 1;
+static pthread_mutex_t latencyLock = PTHREAD_MUTEX_INITIALIZER;
+// the device serves one cache flush at a time
+static pthread_mutex_t latencySyncLock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief configures latencyStorageBackend
+ *
+ * @param inner backend that holds the data, NULL is the POSIX backend
+ * @param config
+ */
+void setStorageLatency(SM_StorageBackend *inner, const SM_LatencyConfig *config) {
+    pthread_mutex_lock(&latencyLock);
+    latencyInner = inner ? inner : &posixStorageBackend;
+    latencyConfig = *config;
+    if (latencyConfig.spanPages <= 0) {
+        latencyConfig.spanPages = 1 << 20;
+    }
+    memset(&latencyStats, 0, sizeof(latencyStats));
+    latencySeed = 1;
+    pthread_mutex_unlock(&latencyLock);
+}
+
+void getStorageLatencyStats(SM_LatencyStats *stats) {
+    pthread_mutex_lock(&latencyLock);
+    *stats = latencyStats;
+    pthread_mutex_unlock(&latencyLock);
+}
+
+static double latencyRandom() {
+    return (double) rand_r(&latencySeed) / ((double) RAND_MAX + 1.0);
+}
+
+/**
+ * @brief latency of one request of numPages starting at page, by the model
+ */
+static long latencyOf(SM_LatencyFile *lf, long page, int numPages, int writing) {
+    SM_LatencyConfig *c = &latencyConfig;
+    double micros = writing ? c->writeMicros : c->readMicros;
+    switch (c->model) {
+        case SM_LATENCY_UNIFORM:
+            micros += latencyRandom() * c->jitterMicros;
+            break;
+        case SM_LATENCY_SSD:
+            micros += -log(1.0 - latencyRandom()) * c->jitterMicros;
+            break;
+        case SM_LATENCY_HDD:
+            if (page != lf->head) {
+                // seek time grows with the square root of the distance
+                double distance = (double) labs(page - lf->head) / c->spanPages;
+                micros += c->seekMicros * sqrt(distance < 1.0 ? distance : 1.0);
+                micros += latencyRandom() * 2 * c->rotationMicros;
+            }
+            break;
+        default:
+            break;
+    }
+    if (c->bandwidth > 0) {
+        micros += (double) numPages * PAGE_SIZE * 1000000.0 / c->bandwidth;
+    }
+    lf->head = page + numPages;
+    return (long) micros;
+}
+
+/**
+ * @brief accounts for a request and sleeps unless the clock is virtual
+ */
+static void latencyDelay(SM_LatencyFile *lf, long offset, int len, int kind) {
+    long micros = 0;
+    pthread_mutex_lock(&latencyLock);
+    if (latencyConfig.model != SM_LATENCY_NONE) {
+        if (kind == 2) {
+            micros = latencyConfig.syncMicros;
+        } else {
+            micros = latencyOf(lf, offset / PAGE_SIZE, (len + PAGE_SIZE - 1) / PAGE_SIZE, kind);
+        }
+    }
+    latencyStats.reads += (kind == 0);
+    latencyStats.writes += (kind == 1);
+    latencyStats.syncs += (kind == 2);
+    latencyStats.micros += micros;
+    int sleep = !latencyConfig.virtualTime;
+    pthread_mutex_unlock(&latencyLock);
+    if (sleep && micros > 0) {
+        struct timespec ts = {micros / 1000000, (micros % 1000000) * 1000};
+        while (nanosleep(&ts, &ts) != 0 && errno == EINTR);
+    }
+}
+
+static int latencyExists(const char *fileName) {
+    return latencyInner->exists(fileName);
+}
+
+static RC latencyCreate(const char *fileName) {
+    return latencyInner->create(fileName);
+}
+
+static RC latencyDestroy(const char *fileName) {
+    return latencyInner->destroy(fileName);
+}
+
+static RC latencyOpen(const char *fileName, void **file) {
+    SM_LatencyFile *lf = (SM_LatencyFile *) malloc(sizeof(SM_LatencyFile));
+    lf->inner = latencyInner;
+    lf->head = 0;
+    RC rc = lf->inner->open(fileName, &lf->file);
+    if (rc != RC_OK) {
+        free(lf);
+        return rc;
+    }
+    *file = lf;
+    return RC_OK;
+}
+
+static RC latencyClose(void *file) {
+    SM_LatencyFile *lf = (SM_LatencyFile *) file;
+    RC rc = lf->inner->close(lf->file);
+    free(lf);
+    return rc;
+}
+
+static long latencySize(void *file) {
+    SM_LatencyFile *lf = (SM_LatencyFile *) file;
+    return lf->inner->size(lf->file);
+}
+
+static RC latencyRead(void *file, long offset, char *buf, int len) {
+    SM_LatencyFile *lf = (SM_LatencyFile *) file;
+    latencyDelay(lf, offset, len, 0);
+    return lf->inner->read(lf->file, offset, buf, len);
+}
+
+static RC latencyWrite(void *file, long offset, const char *buf, int len) {
+    SM_LatencyFile *lf = (SM_LatencyFile *) file;
+    latencyDelay(lf, offset, len, 1);
+    return lf->inner->write(lf->file, offset, buf, len);
+}
+
+static RC latencyReadv(void *file, long offset, char **bufs, int count) {
+    SM_LatencyFile *lf = (SM_LatencyFile *) file;
+    latencyDelay(lf, offset, count * PAGE_SIZE, 0);
+    return lf->inner->readv(lf->file, offset, bufs, count);
+}
+
+static RC latencyWritev(void *file, long offset, char **bufs, int count) {
+    SM_LatencyFile *lf = (SM_LatencyFile *) file;
+    latencyDelay(lf, offset, count * PAGE_SIZE, 1);
+    return lf->inner->writev(lf->file, offset, bufs, count);
+}
+
+static RC latencyExtend(void *file, long newSize) {
+    SM_LatencyFile *lf = (SM_LatencyFile *) file;
+    return lf->inner->extend(lf->file, newSize);
+}
+
+static RC latencySync(void *file) {
+    SM_LatencyFile *lf = (SM_LatencyFile *) file;
+    pthread_mutex_lock(&latencySyncLock);
+    latencyDelay(lf, 0, 0, 2);
+    RC rc = lf->inner->sync(lf->file);
+    pthread_mutex_unlock(&latencySyncLock);
+    return rc;
+}
+
+SM_StorageBackend latencyStorageBackend = {
+    "latency", latencyExists, latencyCreate, latencyDestroy, latencyOpen, latencyClose, latencySize,
+    latencyRead, latencyWrite, latencyReadv, latencyWritev, latencyExtend, latencySync
+};
@@ -0,0 +1,77 @@
+#ifndef STORAGE_BACKEND_H
+#define STORAGE_BACKEND_H
+
+#include "dberror.h"
+
+// page files named with this prefix live in memory only
+#define SM_MEMORY_PREFIX "mem:"
+
+/************************************************************
+ *                    backend interface                     *
+ ************************************************************/
+// where the bytes of a page file live; offsets and lengths are in bytes,
+// file is whatever open returned
+typedef struct SM_StorageBackend {
+	char *name;
+	int (*exists) (const char *fileName);
+	RC (*create) (const char *fileName);      // empty file, truncates an existing one
+	RC (*destroy) (const char *fileName);
+	RC (*open) (const char *fileName, void **file);
+	RC (*close) (void *file);
+	long (*size) (void *file);
+	RC (*read) (void *file, long offset, char *buf, int len);
+	RC (*write) (void *file, long offset, const char *buf, int len);
+	// count pages of PAGE_SIZE starting at offset, one buffer per page
+	RC (*readv) (void *file, long offset, char **bufs, int count);
+	RC (*writev) (void *file, long offset, char **bufs, int count);
+	RC (*extend) (void *file, long newSize);  // zero filled, never shrinks
+	RC (*sync) (void *file);
+} SM_StorageBackend;
+
+extern SM_StorageBackend posixStorageBackend;
+extern SM_StorageBackend memoryStorageBackend;
+extern SM_StorageBackend latencyStorageBackend;
+
+// backend for a page file: the memory backend for SM_MEMORY_PREFIX names,
+// the default backend otherwise
+extern SM_StorageBackend *getStorageBackend (const char *fileName);
+extern SM_StorageBackend *getDefaultStorageBackend (void);
+extern void setDefaultStorageBackend (SM_StorageBackend *backend);
+
+/************************************************************
+ *                    synthetic device latency              *
+ ************************************************************/
+typedef enum SM_LatencyModel {
+	SM_LATENCY_NONE = 0,
+	SM_LATENCY_FIXED = 1,    // readMicros / writeMicros per request
+	SM_LATENCY_UNIFORM = 2,  // plus uniform [0, jitterMicros]
+	SM_LATENCY_SSD = 3,      // plus an exponential tail with mean jitterMicros
+	SM_LATENCY_HDD = 4       // seek by head distance plus rotation, free when sequential
+} SM_LatencyModel;
+
+typedef struct SM_LatencyConfig {
+	SM_LatencyModel model;
+	long readMicros;
+	long writeMicros;
+	long syncMicros;
+	long jitterMicros;
+	long seekMicros;         // HDD full stroke seek
+	long rotationMicros;     // HDD average rotational delay
+	long spanPages;          // HDD pages under a full stroke
+	long bandwidth;          // bytes per second, 0 is unlimited
+	int virtualTime;         // only account the delays instead of sleeping
+} SM_LatencyConfig;
+
+typedef struct SM_LatencyStats {
+	long reads;              // requests, a vectored run counts once
+	long writes;
+	long syncs;
+	long micros;             // latency injected so far
+} SM_LatencyStats;
+
+// latencyStorageBackend delays every request to inner (NULL is the POSIX
+// backend) by the configured model; the stats are reset
+extern void setStorageLatency (SM_StorageBackend *inner, const SM_LatencyConfig *config);
+extern void getStorageLatencyStats (SM_LatencyStats *stats);
+
+#endif
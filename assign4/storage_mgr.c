@@ -3,24 +3,26 @@
 #include <string.h>
 #include <unistd.h>
 #include <math.h>
+#include <pthread.h>
+#include <sys/time.h>
 #include "storage_mgr.h"
 #include "dberror.h"
 
 int initialize = 0;
 
-/**
- * @brief get the size of page
- * 
- * @param fp
- * @return unsigned long 
- * @author Yun Zi
- */
-unsigned long fsize(FILE *fp) {
-    fseek(fp, 0, SEEK_END);
-    unsigned long size = ftell(fp);
-    rewind(fp);
-    return size;
-}
+// durability state of an open page file
+struct SM_Durability {
+    SM_DurabilityMode mode;
+    long periodMicros;
+    long lastSync;      // PERIODIC: time of the last sync
+    long syncs;         // syncs issued to the backend
+    // GROUP_COMMIT: tickets of the callers and the ticket covered by the last sync
+    long requested;
+    long synced;
+    int syncing;
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+};
 
 /**
  * @brief check the file whether exists or not
@@ -30,28 +32,10 @@ unsigned long fsize(FILE *fp) {
  * @author Yun Zi
  */
 int fexist(char *fileName) {
-    return (access(fileName, 0) == 0);
+    return getStorageBackend(fileName)->exists(fileName);
 }
 
 
-/**
- * @brief write fill single page with '0'
- * 
- * @param fp 
- * @return int real size of writing
- * @author Yun Zi
- */
-int ffill(FILE *fp) {
-    // initial file size one page
-    char *buffer = (char*)malloc(PAGE_SIZE * sizeof(char));
-    // fill single page with '0'
-    memset(buffer, 0, PAGE_SIZE * sizeof(char));
-    int curr = fwrite(buffer, sizeof(char), PAGE_SIZE, fp);
-    // free buffer
-    free(buffer);
-    return curr;
-}
-
 /**
  * @brief init the storage manager
  * @author Yun Zi
@@ -75,20 +59,20 @@ void shutdownStorageManager () {
 
 /**
  * @brief Create a new page File
- * 
+ * @details the file starts with one page of zero bytes
  * @param fileName 
  * @return RC
  * @author Yun Zi
  */
 RC createPageFile (char *fileName) {
-    // use w+ mode to create file
-    FILE *fp = fopen(fileName, "w+");
-    if (fp == NULL) {
+    SM_StorageBackend *backend = getStorageBackend(fileName);
+    void *file;
+    if (backend->create(fileName) != RC_OK || backend->open(fileName, &file) != RC_OK) {
         return RC_FILE_NOT_FOUND;
     }
-    ffill(fp);
-    fclose(fp);
-    return RC_OK;
+    RC rc = backend->extend(file, PAGE_SIZE);
+    backend->close(file);
+    return rc;
 }
 
 /**
@@ -101,19 +85,27 @@ RC createPageFile (char *fileName) {
  */
 RC openPageFile (char *fileName, SM_FileHandle *fHandle) {
     // check file exist
-    if (!fexist(fileName)) {
+    SM_StorageBackend *backend = getStorageBackend(fileName);
+    void *file;
+    if (!backend->exists(fileName)) {
         return RC_FILE_NOT_FOUND;
     }
-    FILE *fp = fopen(fileName, "r+");
     if (fHandle == NULL) {
         return RC_FILE_HANDLE_NOT_INIT;
     }
+    if (backend->open(fileName, &file) != RC_OK) {
+        return RC_FILE_NOT_FOUND;
+    }
     // get file size and calc the number of page
-    unsigned long size = fsize(fp);
-    fHandle->totalNumPages = (int)ceil(size / PAGE_SIZE);
+    long size = backend->size(file);
+    fHandle->totalNumPages = (int)(size / PAGE_SIZE);
     fHandle->fileName = fileName;
-    fHandle->mgmtInfo = fp;
+    fHandle->mgmtInfo = file;
+    fHandle->backend = backend;
     fHandle->curPagePos = 0;
+    fHandle->durability = (SM_Durability *) calloc(1, sizeof(SM_Durability));
+    pthread_mutex_init(&fHandle->durability->lock, NULL);
+    pthread_cond_init(&fHandle->durability->done, NULL);
     return RC_OK;
 }
 
@@ -125,11 +117,18 @@ RC openPageFile (char *fileName, SM_FileHandle *fHandle) {
  * @author Yun Zi
  */
 RC closePageFile (SM_FileHandle *fHandle) {
-    FILE *fp = (FILE*)fHandle->mgmtInfo;
-    if (fp == NULL) {
+    if (fHandle->mgmtInfo == NULL) {
         return RC_FILE_NOT_FOUND;
     }
-    fclose(fp);
+    // nothing written through the handle may stay volatile once it is closed
+    if (fHandle->durability->mode != SM_DURABILITY_NONE) {
+        fHandle->backend->sync(fHandle->mgmtInfo);
+    }
+    pthread_mutex_destroy(&fHandle->durability->lock);
+    pthread_cond_destroy(&fHandle->durability->done);
+    free(fHandle->durability);
+    fHandle->durability = NULL;
+    fHandle->backend->close(fHandle->mgmtInfo);
     fHandle->mgmtInfo = NULL;
     fHandle->fileName = "";
     fHandle->curPagePos = -1;
@@ -146,10 +145,7 @@ RC closePageFile (SM_FileHandle *fHandle) {
  * @author Yun Zi
  */
 RC destroyPageFile (char *fileName) {
-    if (remove(fileName) != 0) {
-        return RC_FILE_NOT_FOUND;
-    }
-    return RC_OK;
+    return getStorageBackend(fileName)->destroy(fileName);
 }
 
 /**
@@ -169,17 +165,37 @@ RC readBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
     if (pageNum < 0 || pageNum > fHandle->totalNumPages) {
         return RC_READ_NON_EXISTING_PAGE;
     }
-    FILE *fp = fHandle->mgmtInfo;
-    unsigned long pos = pageNum * PAGE_SIZE;
-    fseek(fp, pos, SEEK_SET);
-    int curr = fread(memPage, sizeof(char), PAGE_SIZE, fp);
-    if (curr < PAGE_SIZE) {
+    RC rc = fHandle->backend->read(fHandle->mgmtInfo, (long)pageNum * PAGE_SIZE, memPage, PAGE_SIZE);
+    if (rc != RC_OK) {
         return RC_READ_NON_EXISTING_PAGE;
     }
     fHandle->curPagePos = pageNum;
     return RC_OK;
 }
 
+/**
+ * @brief read numPages consecutive blocks starting at startPage into memPages
+ * @details the whole run is handed to the backend as one vectored read
+ * @param startPage 
+ * @param numPages 
+ * @param fHandle 
+ * @param memPages one page buffer per block
+ * @return RC 
+ */
+RC readBlocks (int startPage, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages) {
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    if (startPage < 0 || numPages <= 0 || startPage + numPages > fHandle->totalNumPages) {
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+    if (fHandle->backend->readv(fHandle->mgmtInfo, (long)startPage * PAGE_SIZE, memPages, numPages) != RC_OK) {
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+    fHandle->curPagePos = startPage + numPages - 1;
+    return RC_OK;
+}
+
 /**
  * @brief Get the current position in the fHandle
  * 
@@ -283,16 +299,39 @@ RC writeBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
     }
 
     ensureCapacity(pageNum, fHandle);
-    FILE *fp = fopen(fHandle->fileName, "r+");
-
-    int fs = fseek(fp, pageNum * PAGE_SIZE, SEEK_SET);
-    if(fs != 0){
+    RC rc = fHandle->backend->write(fHandle->mgmtInfo, (long)pageNum * PAGE_SIZE, memPage, PAGE_SIZE);
+    if (rc != RC_OK) {
         return RC_WRITE_FAILED;
     }
-    fwrite(memPage, sizeof(char), PAGE_SIZE, fp);
     fHandle->curPagePos = pageNum;
+    return RC_OK;
+}
 
-    fclose(fp);
+/**
+ * @brief write numPages consecutive blocks starting at startPage from memPages
+ * @details the whole run is handed to the backend as one vectored write,
+ *          the file grows if the run ends behind it
+ * @param startPage 
+ * @param numPages 
+ * @param fHandle 
+ * @param memPages one page buffer per block
+ * @return RC 
+ */
+RC writeBlocks (int startPage, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages) {
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    if (startPage < 0 || numPages <= 0 || startPage > fHandle->totalNumPages) {
+        return RC_WRITE_NON_EXISTING_PAGE;
+    }
+    ensureCapacity(startPage, fHandle);
+    if (fHandle->backend->writev(fHandle->mgmtInfo, (long)startPage * PAGE_SIZE, memPages, numPages) != RC_OK) {
+        return RC_WRITE_FAILED;
+    }
+    if (startPage + numPages > fHandle->totalNumPages) {
+        fHandle->totalNumPages = startPage + numPages;
+    }
+    fHandle->curPagePos = startPage + numPages - 1;
     return RC_OK;
 }
 
@@ -317,23 +356,16 @@ RC writeCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage) {
  * @author Mansoor Syed
  */
 RC appendEmptyBlock (SM_FileHandle *fHandle) {
-    if(fHandle == NULL){
+    if(fHandle == NULL || fHandle->mgmtInfo == NULL){
         return RC_FILE_HANDLE_NOT_INIT;
     }
 
-    FILE *fp = fopen(fHandle->fileName,"a+");
-    SM_PageHandle emptyPageAlloc = (SM_PageHandle) calloc(PAGE_SIZE, sizeof(char));
-
-    fseek(fp, 0, SEEK_END);
-    fwrite(emptyPageAlloc, sizeof(char), PAGE_SIZE, fp);
-    free(emptyPageAlloc);
-
-    if (ffill(fHandle->mgmtInfo) != PAGE_SIZE) {
+    long size = (long)(fHandle->totalNumPages + 1) * PAGE_SIZE;
+    if (fHandle->backend->extend(fHandle->mgmtInfo, size) != RC_OK) {
         return RC_WRITE_NON_EXISTING_PAGE;
     }
 
     fHandle->totalNumPages += 1;
-    fclose(fp);
     return RC_OK;
 }
 
@@ -351,6 +383,13 @@ RC ensureCapacity (int numberOfPages, SM_FileHandle *fHandle) {
     if (numberOfPages <= total) {       
         return RC_OK;
     }
+    // another process sharing the file may have extended it already
+    if (fHandle->mgmtInfo) {
+        int onDisk = (int)(fHandle->backend->size(fHandle->mgmtInfo) / PAGE_SIZE);
+        if (onDisk > total) {
+            total = fHandle->totalNumPages = onDisk;
+        }
+    }
     while(total < numberOfPages) {
         RC value = appendEmptyBlock(fHandle);
         // if certain page append fail, the whole function is failed
@@ -362,3 +401,112 @@ RC ensureCapacity (int numberOfPages, SM_FileHandle *fHandle) {
     return RC_OK;
 }
 
+
+
+/**
+ * @brief sets when syncPageFile() forces written pages to stable storage
+ * 
+ * @param fHandle 
+ * @param mode 
+ * @details PERIODIC has no timer: a syncPageFile() call inside the period
+ *          since the last sync does not sync, its pages stay unsynced until
+ *          a later call past the period or closePageFile(). The period is
+ *          the shortest time between two syncs, not a bound on how long a
+ *          write may stay unsynced
+ * @param periodMicros PERIODIC only: the shortest time between two syncs
+ * @return RC 
+ */
+RC setDurability (SM_FileHandle *fHandle, SM_DurabilityMode mode, long periodMicros) {
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    if (mode == SM_DURABILITY_PERIODIC && periodMicros <= 0) {
+        return RC_FAIL;
+    }
+    pthread_mutex_lock(&fHandle->durability->lock);
+    fHandle->durability->mode = mode;
+    fHandle->durability->periodMicros = periodMicros;
+    pthread_mutex_unlock(&fHandle->durability->lock);
+    return RC_OK;
+}
+
+static long nowMicros() {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return now.tv_sec * 1000000L + now.tv_usec;
+}
+
+/**
+ * @brief makes the pages written so far durable as the mode of the file asks;
+ *        with GROUP_COMMIT one caller syncs for everybody who arrived before
+ *        the sync started, callers arriving during a sync share the next one
+ * 
+ * @param fHandle 
+ * @return RC 
+ */
+RC syncPageFile (SM_FileHandle *fHandle) {
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    SM_Durability *d = fHandle->durability;
+    RC rc = RC_OK;
+    pthread_mutex_lock(&d->lock);
+    switch (d->mode) {
+        case SM_DURABILITY_SYNC_ON_FLUSH:
+            d->syncs += 1;
+            pthread_mutex_unlock(&d->lock);
+            return fHandle->backend->sync(fHandle->mgmtInfo);
+        case SM_DURABILITY_PERIODIC: {
+            long now = nowMicros();
+            if (now - d->lastSync >= d->periodMicros) {
+                d->lastSync = now;
+                d->syncs += 1;
+                pthread_mutex_unlock(&d->lock);
+                return fHandle->backend->sync(fHandle->mgmtInfo);
+            }
+            break;
+        }
+        case SM_DURABILITY_GROUP_COMMIT: {
+            long ticket = ++d->requested;
+            while (d->synced < ticket) {
+                if (d->syncing) {
+                    pthread_cond_wait(&d->done, &d->lock);
+                    continue;
+                }
+                // leader: everything requested so far is covered by this sync
+                long covered = d->requested;
+                d->syncing = 1;
+                d->syncs += 1;
+                pthread_mutex_unlock(&d->lock);
+                rc = fHandle->backend->sync(fHandle->mgmtInfo);
+                pthread_mutex_lock(&d->lock);
+                d->syncing = 0;
+                if (rc == RC_OK) {
+                    d->synced = covered;
+                }
+                pthread_cond_broadcast(&d->done);
+                if (rc != RC_OK) {
+                    break;
+                }
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return rc;
+}
+
+/**
+ * @brief number of syncs issued for the handle
+ * 
+ * @param fHandle 
+ * @return long 
+ */
+long getNumSyncs (SM_FileHandle *fHandle) {
+    pthread_mutex_lock(&fHandle->durability->lock);
+    long syncs = fHandle->durability->syncs;
+    pthread_mutex_unlock(&fHandle->durability->lock);
+    return syncs;
+}
@@ -2,23 +2,34 @@
 #define STORAGE_MGR_H
 
 #include "dberror.h"
+#include "storage_backend.h"
 
 /************************************************************
  *                    handle data structures                *
  ************************************************************/
+// when written pages are forced to stable storage
+typedef enum SM_DurabilityMode {
+	SM_DURABILITY_NONE = 0,          // left to the operating system
+	SM_DURABILITY_SYNC_ON_FLUSH = 1, // every syncPageFile() syncs
+	SM_DURABILITY_PERIODIC = 2,      // syncPageFile() syncs if a period passed since the last sync
+	SM_DURABILITY_GROUP_COMMIT = 3   // concurrent syncPageFile() calls share one sync
+} SM_DurabilityMode;
+
+typedef struct SM_Durability SM_Durability;
+
 typedef struct SM_FileHandle {
 	char *fileName;
 	int totalNumPages;
 	int curPagePos;
-	void *mgmtInfo;
+	void *mgmtInfo;     // open file of the backend
+	SM_StorageBackend *backend;
+	SM_Durability *durability;
 } SM_FileHandle;
 
 typedef char* SM_PageHandle;
 
 // common function
-unsigned long fsize(FILE *fp);
 int fexist(char *fileName);
-int ffill(FILE *fp);
 
 
 
@@ -41,11 +52,18 @@ extern RC readPreviousBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readNextBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readLastBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern RC readBlocks (int startPage, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages);
 
 /* writing blocks to a page file */
 extern RC writeBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC writeCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern RC writeBlocks (int startPage, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages);
 extern RC appendEmptyBlock (SM_FileHandle *fHandle);
 extern RC ensureCapacity (int numberOfPages, SM_FileHandle *fHandle);
 
+/* durability */
+extern RC setDurability (SM_FileHandle *fHandle, SM_DurabilityMode mode, long periodMicros);
+extern RC syncPageFile (SM_FileHandle *fHandle);
+extern long getNumSyncs (SM_FileHandle *fHandle);
+
 #endif
@@ -32,6 +32,14 @@ typedef struct Record
 	char *data;
 } Record;
 
+// where the attributes of a record live in Record.data, built once per schema
+typedef struct SchemaLayout
+{
+	int recordSize;// bytes of Record.data
+	int *offsets;// offset of each attribute
+	int *sizes;// bytes of each attribute
+} SchemaLayout;
+
 // information of a table schema: its attributes, datatypes, 
 typedef struct Schema
 {
@@ -41,6 +49,7 @@ typedef struct Schema
 	int *typeLength;// if type = DT_STRING, the size of string
 	int *keyAttrs;// the position of the attributes of the key
 	int keySize;
+	SchemaLayout *layout;// attribute offsets, see buildSchemaLayout()
 } Schema;
 
 // TableData: Management Structure for a Record Manager to handle one relation
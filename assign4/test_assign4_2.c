@@ -0,0 +1,492 @@
+#include "storage_mgr.h"
+#include "buffer_mgr_stat.h"
+#include "buffer_mgr.h"
+#include "dberror.h"
+#include "test_helper.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/wait.h>
+
+// var to store the current test's name
+char *testName;
+
+// test and helper methods
+static void testPinPagesBatch (void);
+static void testCompressedTier (void);
+static void testSharedPool (void);
+static void testMemoryBackend (void);
+static void testLatencyBackend (void);
+static void testFlushRuns (void);
+static void testDurabilityModes (void);
+static void createDummyPages(char *fileName, int num);
+
+// main method
+int
+main (void)
+{
+  initStorageManager();
+  testName = "";
+
+  testPinPagesBatch();
+  testCompressedTier();
+  testSharedPool();
+  testMemoryBackend();
+  testLatencyBackend();
+  testFlushRuns();
+  testDurabilityModes();
+
+  return 0;
+}
+
+// write n pages with content "Page X" through a buffer pool
+void
+createDummyPages(char *fileName, int num)
+{
+  int i;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+
+  CHECK(initBufferPool(bm, fileName, 3, RS_FIFO, NULL));
+  for (i = 0; i < num; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      sprintf(h->data, "%s-%i", "Page", h->pageNum);
+      CHECK(markDirty(bm, h));
+      CHECK(unpinPage(bm,h));
+    }
+  CHECK(shutdownBufferPool(bm));
+
+  free(h);
+  free(bm);
+}
+
+// pin a batch with hits, misses, a gap and a duplicate, then unpin it
+void
+testPinPagesBatch (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PageHandle handles[6];
+  PageNumber pages[] = {7, 2, 3, 4, 9, 3};
+  PageNumber tooMany[] = {10, 11, 12, 13, 14, 15, 16, 17, 18};
+  char expected[64];
+  int i, *fixCounts;
+  testName = "Pinning and unpinning a batch of pages";
+
+  CHECK(createPageFile("testbatch.bin"));
+  createDummyPages("testbatch.bin", 12);
+
+  CHECK(initBufferPool(bm, "testbatch.bin", 8, RS_LRU, NULL));
+  CHECK(pinPage(bm, h, 2));
+  CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_INT(1, getNumReadIO(bm), "one page read before the batch");
+
+  CHECK(pinPages(bm, handles, pages, 6));
+  for (i = 0; i < 6; i++)
+    {
+      sprintf(expected, "%s-%i", "Page", pages[i]);
+      ASSERT_EQUALS_INT(pages[i], handles[i].pageNum, "handle has the requested page");
+      ASSERT_EQUALS_STRING(expected, handles[i].data, "batch page content");
+    }
+  // page 2 was a hit, 3 is only read once
+  ASSERT_EQUALS_INT(5, getNumReadIO(bm), "only the distinct misses are read");
+  ASSERT_TRUE(handles[2].data == handles[5].data, "duplicate pages share a frame");
+
+  // the batch holds 5 of 8 frames, 9 more pages cannot fit
+  ASSERT_ERROR(pinPages(bm, h, tooMany, 9), "batch larger than the free frames fails");
+  fixCounts = getFixCounts(bm);
+  for (i = 0, h->pageNum = 0; i < bm->numPages; i++)
+    h->pageNum += fixCounts[i] ? 1 : 0;
+  free(fixCounts);
+  ASSERT_EQUALS_INT(5, h->pageNum, "failed batch leaves no pins behind");
+
+  CHECK(unpinPages(bm, handles, 6));
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbatch.bin"));
+
+  free(h);
+  free(bm);
+  TEST_DONE();
+}
+
+// evicted pages come back from the compressed tier without read I/O
+void
+testCompressedTier (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  char page[PAGE_SIZE], packed[TIER_MAX_COMPRESSED], unpacked[PAGE_SIZE];
+  char expected[64];
+  int i, size;
+  testName = "Compressed second tier of the buffer pool";
+
+  // codec round trip on a page with repeats and a random tail
+  for (i = 0; i < PAGE_SIZE; i++)
+    page[i] = (i < PAGE_SIZE / 2) ? "abcabcabd"[i % 9] : (char) (rand() & 0xff);
+  size = tierCompress(page, PAGE_SIZE, packed);
+  ASSERT_TRUE(size < PAGE_SIZE, "repeated content compresses");
+  ASSERT_EQUALS_INT(PAGE_SIZE, tierDecompress(packed, size, unpacked, PAGE_SIZE), "decompressed size");
+  ASSERT_TRUE(memcmp(page, unpacked, PAGE_SIZE) == 0, "codec round trip");
+
+  CHECK(createPageFile("testtier.bin"));
+  createDummyPages("testtier.bin", 8);
+
+  CHECK(initBufferPool(bm, "testtier.bin", 2, RS_LRU, NULL));
+  CHECK(setCompressedTier(bm, 8 * PAGE_SIZE));
+  for (i = 0; i < 8; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h));
+    }
+  ASSERT_EQUALS_INT(8, getNumReadIO(bm), "first pass reads every page");
+
+  // pages 0..5 were evicted into the tier
+  for (i = 0; i < 6; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      sprintf(expected, "%s-%i", "Page", i);
+      ASSERT_EQUALS_STRING(expected, h->data, "page content from the tier");
+      CHECK(unpinPage(bm, h));
+    }
+  ASSERT_EQUALS_INT(8, getNumReadIO(bm), "tier hits need no read I/O");
+  ASSERT_TRUE(getTierHitRatio(bm) * 14 > 5.99 && getTierHitRatio(bm) * 14 < 6.01, "6 of 14 tier lookups hit");
+  ASSERT_TRUE(getTierCompressionRatio(bm) > 10, "dummy pages compress well");
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testtier.bin"));
+
+  free(h);
+  free(bm);
+  TEST_DONE();
+}
+
+// a second process attaches to the pool and sees and changes the same frames
+void
+testSharedPool (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  char *shmName = "/test_assign4_2_pool";
+  int status;
+  pid_t pid;
+  testName = "Buffer pool shared between processes";
+
+  CHECK(createPageFile("testshared.bin"));
+  createDummyPages("testshared.bin", 4);
+
+  CHECK(initBufferPoolShared(bm, "testshared.bin", 3, RS_LRU, NULL, shmName));
+  ASSERT_ERROR(setCompressedTier(bm, 4 * PAGE_SIZE), "shared pools have no private tier");
+  CHECK(pinPage(bm, h, 0));
+  CHECK(unpinPage(bm, h));
+
+  pid = fork();
+  if (pid == 0)
+    {
+      // the child reports failures through its exit status only
+      BM_BufferPool *child = MAKE_POOL();
+      int rc = 0;
+      if (initBufferPoolShared(child, "testshared.bin", 3, RS_LRU, NULL, shmName) != RC_OK)
+        _exit(1);
+      rc |= pinPage(child, h, 0);
+      rc |= strcmp(h->data, "Page-0") != 0;
+      rc |= getNumReadIO(child) != 1;
+      strcpy(h->data, "child");
+      rc |= markDirty(child, h);
+      rc |= unpinPage(child, h);
+      rc |= shutdownBufferPool(child);
+      _exit(rc ? 2 : 0);
+    }
+  ASSERT_TRUE(pid > 0, "fork");
+  ASSERT_TRUE(waitpid(pid, &status, 0) == pid, "wait for the child");
+  ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0, "child attached and changed page 0");
+
+  CHECK(pinPage(bm, h, 0));
+  ASSERT_EQUALS_STRING("child", h->data, "change of the child is visible");
+  ASSERT_EQUALS_INT(1, getNumReadIO(bm), "page 0 was read once for both processes");
+  CHECK(unpinPage(bm, h));
+  ASSERT_ERROR(initBufferPoolShared(MAKE_POOL(), "testshared.bin", 5, RS_LRU, NULL, shmName), "pool size must match");
+  CHECK(shutdownBufferPool(bm));
+
+  // the last process out flushed the page and removed the segment
+  CHECK(initBufferPool(bm, "testshared.bin", 3, RS_FIFO, NULL));
+  CHECK(pinPage(bm, h, 0));
+  ASSERT_EQUALS_STRING("child", h->data, "shared pool flushed on shutdown");
+  CHECK(unpinPage(bm, h));
+  CHECK(shutdownBufferPool(bm));
+
+  // a pool whose page file does not open leaves no segment behind
+  ASSERT_ERROR(initBufferPoolShared(bm, "testshared_missing.bin", 3, RS_LRU, NULL, shmName), "missing page file");
+  CHECK(initBufferPoolShared(bm, "testshared.bin", 3, RS_LRU, NULL, shmName));
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testshared.bin"));
+
+  free(h);
+  free(bm);
+  TEST_DONE();
+}
+
+// page files with the memory prefix work like real ones but never touch the disk
+void
+testMemoryBackend (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  SM_FileHandle fh;
+  char *fileName = SM_MEMORY_PREFIX "testmem.bin";
+  char expected[64];
+  int i;
+  testName = "In-memory storage backend";
+
+  ASSERT_TRUE(!fexist(fileName), "memory file does not exist yet");
+  CHECK(createPageFile(fileName));
+  ASSERT_TRUE(fexist(fileName), "memory file exists after creation");
+  ASSERT_TRUE(!fexist("testmem.bin"), "no file on disk");
+
+  createDummyPages(fileName, 10);
+  CHECK(openPageFile(fileName, &fh));
+  ASSERT_EQUALS_INT(10, fh.totalNumPages, "pages appended through the buffer pool");
+  ASSERT_TRUE(fh.backend == &memoryStorageBackend, "handle uses the memory backend");
+  CHECK(closePageFile(&fh));
+
+  CHECK(initBufferPool(bm, fileName, 4, RS_CLOCK, NULL));
+  for (i = 9; i >= 0; i--)
+    {
+      CHECK(pinPage(bm, h, i));
+      sprintf(expected, "%s-%i", "Page", i);
+      ASSERT_EQUALS_STRING(expected, h->data, "page content read back from memory");
+      CHECK(unpinPage(bm, h));
+    }
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(destroyPageFile(fileName));
+  ASSERT_TRUE(!fexist(fileName), "memory file removed");
+  ASSERT_ERROR(openPageFile(fileName, &fh), "destroyed memory file cannot be opened");
+
+  free(h);
+  free(bm);
+  TEST_DONE();
+}
+
+// injected latency follows the configured model, on a virtual clock
+void
+testLatencyBackend (void)
+{
+  SM_LatencyConfig config;
+  SM_LatencyStats stats;
+  SM_FileHandle fh;
+  SM_PageHandle pages[8];
+  char data[8][PAGE_SIZE];
+  long sequential;
+  int i;
+  testName = "Latency injecting storage backend";
+
+  memset(&config, 0, sizeof(config));
+  config.model = SM_LATENCY_FIXED;
+  config.readMicros = 100;
+  config.writeMicros = 300;
+  config.virtualTime = 1;
+  setStorageLatency(&memoryStorageBackend, &config);
+  setDefaultStorageBackend(&latencyStorageBackend);
+
+  CHECK(createPageFile("testlatency.bin"));
+  ASSERT_TRUE(!fexist(SM_MEMORY_PREFIX "testlatency.bin") && fexist("testlatency.bin"), "file lives in the inner backend");
+  createDummyPages("testlatency.bin", 8);
+  CHECK(openPageFile("testlatency.bin", &fh));
+  for (i = 0; i < 8; i++)
+    pages[i] = data[i];
+  setStorageLatency(&memoryStorageBackend, &config);
+  CHECK(readBlock(3, &fh, data[0]));
+  CHECK(writeBlock(3, &fh, data[0]));
+  CHECK(readBlocks(0, 8, &fh, pages));
+  getStorageLatencyStats(&stats);
+  ASSERT_EQUALS_INT(2, (int) stats.reads, "a vectored read is one request");
+  ASSERT_EQUALS_INT(1, (int) stats.writes, "one write request");
+  ASSERT_EQUALS_INT(500, (int) stats.micros, "fixed latency per request");
+  ASSERT_EQUALS_STRING("Page-7", data[7], "data comes from the inner backend");
+
+  // a disk head pays for seeks, reading in page order does not
+  config.model = SM_LATENCY_HDD;
+  config.seekMicros = 8000;
+  config.rotationMicros = 4000;
+  config.spanPages = 64;
+  setStorageLatency(&memoryStorageBackend, &config);
+  CHECK(readBlock(0, &fh, data[0]));
+  setStorageLatency(&memoryStorageBackend, &config);
+  for (i = 1; i < 8; i++)
+    CHECK(readBlock(i, &fh, data[i]));
+  getStorageLatencyStats(&stats);
+  sequential = stats.micros;
+  ASSERT_EQUALS_INT(7 * 100, (int) sequential, "sequential reads never seek");
+  setStorageLatency(&memoryStorageBackend, &config);
+  for (i = 0; i < 8; i++)
+    CHECK(readBlock((i * 5) % 8, &fh, data[i]));
+  getStorageLatencyStats(&stats);
+  ASSERT_TRUE(stats.micros > 4 * sequential, "scattered reads pay seek and rotation");
+
+  CHECK(closePageFile(&fh));
+  CHECK(destroyPageFile("testlatency.bin"));
+  setDefaultStorageBackend(NULL);
+  TEST_DONE();
+}
+
+// a flush writes dirty pages in page order, adjacent pages as one request
+void
+testFlushRuns (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  PageNumber dirty[] = {5, 1, 2, 7, 3, 6};
+  SM_LatencyConfig config;
+  SM_LatencyStats stats;
+  char expected[64];
+  int i;
+  testName = "Flushing dirty pages in runs";
+
+  memset(&config, 0, sizeof(config));
+  config.model = SM_LATENCY_FIXED;
+  config.virtualTime = 1;
+  setStorageLatency(&memoryStorageBackend, &config);
+  setDefaultStorageBackend(&latencyStorageBackend);
+  CHECK(createPageFile("testruns.bin"));
+  createDummyPages("testruns.bin", 8);
+
+  CHECK(initBufferPool(bm, "testruns.bin", 8, RS_LRU, NULL));
+  for (i = 0; i < 6; i++)
+    {
+      CHECK(pinPage(bm, h, dirty[i]));
+      sprintf(h->data, "%s-%i", "Run", dirty[i]);
+      CHECK(markDirty(bm, h));
+      CHECK(unpinPage(bm, h));
+    }
+  // page 4 stays clean and splits the pages into two runs
+  CHECK(pinPage(bm, h, 4));
+  CHECK(unpinPage(bm, h));
+  setStorageLatency(&memoryStorageBackend, &config);
+  CHECK(forceFlushPool(bm));
+  getStorageLatencyStats(&stats);
+  ASSERT_EQUALS_INT(6, getNumWriteIO(bm), "every dirty page is written");
+  ASSERT_EQUALS_INT(2, (int) stats.writes, "runs 1-3 and 5-7 are one request each");
+  ASSERT_TRUE(getAverageWriteRun(bm) > 2.99 && getAverageWriteRun(bm) < 3.01, "average run of 3 pages");
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(initBufferPool(bm, "testruns.bin", 3, RS_FIFO, NULL));
+  for (i = 0; i < 8; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      sprintf(expected, "%s-%i", (i == 0 || i == 4) ? "Page" : "Run", i);
+      ASSERT_EQUALS_STRING(expected, h->data, "runs land on the right pages");
+      CHECK(unpinPage(bm, h));
+    }
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testruns.bin"));
+  setDefaultStorageBackend(NULL);
+
+  free(h);
+  free(bm);
+  TEST_DONE();
+}
+
+// one committer per page, they all force their page at about the same time
+typedef struct Committer {
+  BM_BufferPool *bm;
+  pthread_barrier_t *start;
+  PageNumber pageNum;
+  RC rc;
+} Committer;
+
+static void *
+commitPage (void *arg)
+{
+  Committer *c = (Committer *) arg;
+  BM_PageHandle h;
+  c->rc = pinPage(c->bm, &h, c->pageNum);
+  sprintf(h.data, "%s-%i", "Commit", c->pageNum);
+  c->rc |= markDirty(c->bm, &h);
+  pthread_barrier_wait(c->start);
+  c->rc |= forcePage(c->bm, &h);
+  c->rc |= unpinPage(c->bm, &h);
+  return NULL;
+}
+
+// concurrent commits of all 8 pages, returns the syncs they needed
+static long
+commitConcurrently (BM_BufferPool *bm)
+{
+  pthread_t threads[8];
+  Committer committers[8];
+  pthread_barrier_t start;
+  BM_MgmtData *mgmt = (BM_MgmtData *) bm->mgmtData;
+  long before = getNumSyncs(mgmt->fh);
+  int i;
+
+  pthread_barrier_init(&start, NULL, 8);
+  for (i = 0; i < 8; i++)
+    {
+      committers[i].bm = bm;
+      committers[i].start = &start;
+      committers[i].pageNum = i;
+      pthread_create(&threads[i], NULL, commitPage, &committers[i]);
+    }
+  for (i = 0; i < 8; i++)
+    {
+      pthread_join(threads[i], NULL);
+      ASSERT_EQUALS_INT(RC_OK, committers[i].rc, "commit succeeded");
+    }
+  pthread_barrier_destroy(&start);
+  return getNumSyncs(mgmt->fh) - before;
+}
+
+// syncs issued by forcePage under each durability mode
+void
+testDurabilityModes (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  SM_LatencyConfig config;
+  SM_LatencyStats stats;
+  long syncs;
+  testName = "Durability modes and group commit";
+
+  // a slow device cache flush, everything else is free
+  memset(&config, 0, sizeof(config));
+  config.model = SM_LATENCY_FIXED;
+  config.syncMicros = 20000;
+  setStorageLatency(&memoryStorageBackend, &config);
+  setDefaultStorageBackend(&latencyStorageBackend);
+  CHECK(createPageFile("testdurable.bin"));
+  createDummyPages("testdurable.bin", 8);
+  CHECK(initBufferPool(bm, "testdurable.bin", 8, RS_LRU, NULL));
+
+  ASSERT_EQUALS_INT(0, (int) commitConcurrently(bm), "no syncs by default");
+  CHECK(setPoolDurability(bm, SM_DURABILITY_SYNC_ON_FLUSH, 0));
+  ASSERT_EQUALS_INT(8, (int) commitConcurrently(bm), "one sync per commit");
+  CHECK(setPoolDurability(bm, SM_DURABILITY_GROUP_COMMIT, 0));
+  syncs = commitConcurrently(bm);
+  ASSERT_TRUE(syncs >= 1 && syncs < 8, "concurrent commits share syncs");
+
+  CHECK(setPoolDurability(bm, SM_DURABILITY_PERIODIC, 3600L * 1000000));
+  setStorageLatency(&memoryStorageBackend, &config);
+  CHECK(pinPage(bm, h, 0));
+  CHECK(markDirty(bm, h));
+  CHECK(forcePage(bm, h));
+  CHECK(forcePage(bm, h));
+  CHECK(unpinPage(bm, h));
+  CHECK(forceFlushPool(bm));
+  getStorageLatencyStats(&stats);
+  ASSERT_EQUALS_INT(1, (int) stats.syncs, "one sync per period");
+  ASSERT_ERROR(setPoolDurability(bm, SM_DURABILITY_PERIODIC, 0), "a period is required");
+
+  CHECK(shutdownBufferPool(bm));
+  getStorageLatencyStats(&stats);
+  ASSERT_EQUALS_INT(2, (int) stats.syncs, "closing a durable file syncs");
+  CHECK(destroyPageFile("testdurable.bin"));
+  setDefaultStorageBackend(NULL);
+
+  free(h);
+  free(bm);
+  TEST_DONE();
+}
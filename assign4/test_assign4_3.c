@@ -0,0 +1,1621 @@
+#include <stddef.h>
+#include <stdlib.h>
+#include "dberror.h"
+#include "expr.h"
+#include "record_mgr.h"
+#include "tables.h"
+#include "test_helper.h"
+
+// test methods
+static void testSlottedPages (void);
+static void testMigrateTextTable (void);
+static void testRecordRefs (void);
+static void testFreeSpaceMap (void);
+static void testVariableLength (void);
+static void testTableHeader (void);
+static void testSchemaLayout (void);
+static void testBulkInsert (void);
+static void testBulkInsertTooLarge (void);
+static void testScanCursor (void);
+static void testBatchScan (void);
+static void testProjectedScan (void);
+static void testParallelScan (void);
+static void testPaxLayout (void);
+static void testZoneMaps (void);
+static void testPrimaryKey (void);
+
+// helper methods
+static Schema *testSchema (void);
+static Record *testRecord (Schema *schema, int a, char *b, int c);
+static void setKey (Record *record, Schema *schema, int a);
+static int countPinned (RM_TableData *table);
+
+// test name
+char *testName;
+
+// main method
+int
+main (void)
+{
+	testName = "";
+
+	testSlottedPages();
+	testMigrateTextTable();
+	testRecordRefs();
+	testFreeSpaceMap();
+	testVariableLength();
+	testTableHeader();
+	testSchemaLayout();
+	testBulkInsert();
+	testBulkInsertTooLarge();
+	testScanCursor();
+	testBatchScan();
+	testProjectedScan();
+	testParallelScan();
+	testPaxLayout();
+	testZoneMaps();
+	testPrimaryKey();
+
+	return 0;
+}
+
+// ************************************************************
+void
+testSlottedPages (void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	Schema *schema = testSchema();
+	Record *r, *out;
+	RID rids[500];
+	RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+	char b[5];
+	int i, seen, slotMax;
+
+	testName = "test binary slotted pages";
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_s", schema));
+	TEST_CHECK(openTable(table, "test_table_s"));
+
+	// more records than fit on one page
+	for (i = 0; i < 500; i++)
+	{
+		sprintf(b, "%04i", i);
+		r = testRecord(schema, i, b, i * 2);
+		TEST_CHECK(insertRecord(table, r));
+		rids[i] = r->id;
+		freeRecord(r);
+	}
+	ASSERT_EQUALS_INT(500, getNumTuples(table), "all records inserted");
+	slotMax = calcSlotMax(getRecordSize(schema));
+	ASSERT_TRUE(rids[slotMax - 1].page == 1 && rids[slotMax].page == 2, "a full page holds slotMax records");
+
+	// records are stored as raw bytes
+	TEST_CHECK(createRecord(&out, schema));
+	r = testRecord(schema, 321, "0321", 642);
+	TEST_CHECK(getRecord(table, rids[321], out));
+	ASSERT_TRUE(memcmp(r->data, out->data, getRecordSize(schema)) == 0, "record read back as inserted");
+	freeRecord(r);
+
+	// delete frees the slot, the next insert on the page reuses it
+	TEST_CHECK(deleteRecord(table, rids[499]));
+	ASSERT_EQUALS_INT(RC_RM_DELETED_TUPLES, getRecord(table, rids[499], out), "deleted record is gone");
+	ASSERT_EQUALS_INT(499, getNumTuples(table), "tuple count after delete");
+	r = testRecord(schema, 1000, "xxxx", 0);
+	TEST_CHECK(insertRecord(table, r));
+	ASSERT_TRUE(r->id.page == rids[499].page && r->id.slot == rids[499].slot, "free slot reused");
+	freeRecord(r);
+
+	// update in place, then reopen
+	r = testRecord(schema, 7, "upd7", 7);
+	r->id = rids[7];
+	TEST_CHECK(updateRecord(table, r));
+	TEST_CHECK(deleteRecord(table, rids[8]));
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(openTable(table, "test_table_s"));
+	ASSERT_EQUALS_INT(499, getNumTuples(table), "tuple count survives reopen");
+	TEST_CHECK(getRecord(table, rids[7], out));
+	ASSERT_TRUE(memcmp(r->data, out->data, getRecordSize(schema)) == 0, "update survives reopen");
+	freeRecord(r);
+
+	// a full scan skips deleted slots
+	seen = 0;
+	TEST_CHECK(startScan(table, sc, NULL));
+	while (next(sc, out) == RC_OK)
+	{
+		ASSERT_TRUE(out->id.page != rids[8].page || out->id.slot != rids[8].slot, "deleted record not scanned");
+		seen++;
+	}
+	TEST_CHECK(closeScan(sc));
+	ASSERT_EQUALS_INT(499, seen, "scan sees every live record");
+
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_s"));
+	TEST_CHECK(shutdownRecordManager());
+
+	freeRecord(out);
+	free(table);
+	free(sc);
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testMigrateTextTable (void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	Schema *schema = testSchema();
+	SM_FileHandle fh;
+	char page[PAGE_SIZE];
+	char header[PAGE_SIZE];
+	char *schemaStr = serializeSchema(schema);
+	int slotLen = calcSlotLen(schema);
+	Record *r, *out;
+	RID id;
+	int i;
+
+	testName = "test migrating a text table";
+
+	// a table as written before slotted pages: text slots, no version
+	// field in the header, slot 1 deleted
+	TEST_CHECK(initRecordManager(NULL));
+	sprintf(header, "tupleLen {%i} schemaLen {%i} slotLen {%i} slotMax {%i} slotOffset {%i} pageOffset {%i} schemaStr {%s}",
+			2, (int) strlen(schemaStr), slotLen, PAGE_SIZE / slotLen, 3, 1, schemaStr);
+	TEST_CHECK(writeStrToPage("test_table_m", 0, header));
+	memset(page, 0, PAGE_SIZE);
+	for (i = 0; i < 3; i += 2)
+	{
+		r = testRecord(schema, i, i ? "bbbb" : "aaaa", i + 10);
+		r->id.page = 1;
+		r->id.slot = i;
+		char *text = serializeRecord(r, schema);
+		memcpy(page + i * slotLen, text, strlen(text));
+		free(text);
+		freeRecord(r);
+	}
+	TEST_CHECK(openPageFile("test_table_m", &fh));
+	TEST_CHECK(ensureCapacity(2, &fh));
+	TEST_CHECK(writeBlock(1, &fh, page));
+	TEST_CHECK(closePageFile(&fh));
+
+	TEST_CHECK(openTable(table, "test_table_m"));
+	ASSERT_EQUALS_INT(RM_FORMAT_LAYOUT, ((RM_RecordMtdt *) table->mgmtData)->version, "table migrated on open");
+	ASSERT_EQUALS_INT(2, getNumTuples(table), "tuple count kept");
+	TEST_CHECK(createRecord(&out, schema));
+	id.page = 1;
+	id.slot = 2;
+	TEST_CHECK(getRecord(table, id, out));
+	r = testRecord(schema, 2, "bbbb", 12);
+	ASSERT_TRUE(memcmp(r->data, out->data, getRecordSize(schema)) == 0, "record keeps its id");
+	freeRecord(r);
+	id.slot = 1;
+	ASSERT_EQUALS_INT(RC_RM_DELETED_TUPLES, getRecord(table, id, out), "deleted text slot stays deleted");
+	r = testRecord(schema, 1, "cccc", 11);
+	TEST_CHECK(insertRecord(table, r));
+	ASSERT_TRUE(r->id.page == 1 && r->id.slot == 1, "migrated hole reused");
+	freeRecord(r);
+	TEST_CHECK(closeTable(table));
+
+	// the migrated table is written back in the binary format
+	TEST_CHECK(openTable(table, "test_table_m"));
+	id.slot = 0;
+	TEST_CHECK(getRecord(table, id, out));
+	r = testRecord(schema, 0, "aaaa", 10);
+	ASSERT_TRUE(memcmp(r->data, out->data, getRecordSize(schema)) == 0, "record readable after reopen");
+	freeRecord(r);
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_m"));
+	TEST_CHECK(shutdownRecordManager());
+
+	freeRecord(out);
+	free(schemaStr);
+	free(table);
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testRecordRefs (void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	Schema *schema = testSchema();
+	RM_RecordRef ref, other, third;
+	RM_ScanHandle scan;
+	Record *r, *out;
+	RC rc;
+	RID id;
+	char *str;
+	int i, len;
+
+	testName = "test reading records in place";
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_r", schema));
+	TEST_CHECK(openTable(table, "test_table_r"));
+	r = testRecord(schema, 42, "ab", 7);
+	TEST_CHECK(insertRecord(table, r));
+	id = r->id;
+	freeRecord(r);
+	r = testRecord(schema, 43, "full", 8);
+	TEST_CHECK(insertRecord(table, r));
+
+	TEST_CHECK(getRecordRef(table, id, &ref));
+	ASSERT_EQUALS_INT(42, getIntAttr(&ref.record, schema, 0), "int read in place");
+	ASSERT_EQUALS_INT(7, getIntAttr(&ref.record, schema, 2), "second int read in place");
+	str = getStringAttrRef(&ref.record, schema, 1, &len);
+	ASSERT_TRUE(len == 2 && strncmp(str, "ab", 2) == 0, "short string read in place");
+	ASSERT_TRUE(str > ref.page.data && str < ref.page.data + PAGE_SIZE, "string points into the pinned page");
+
+	// refs hold their own pins, two of them may share a page
+	TEST_CHECK(getRecordRef(table, r->id, &other));
+	str = getStringAttrRef(&other.record, schema, 1, &len);
+	ASSERT_TRUE(len == 4 && strncmp(str, "full", 4) == 0, "string filling the attribute read in place");
+	TEST_CHECK(releaseRecordRef(table, &other));
+	TEST_CHECK(releaseRecordRef(table, &ref));
+
+	TEST_CHECK(deleteRecord(table, id));
+	ASSERT_EQUALS_INT(RC_RM_DELETED_TUPLES, getRecordRef(table, id, &ref), "no ref to a deleted record");
+	id.page = 5;
+	ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, getRecordRef(table, id, &ref), "no ref past the last page");
+
+	// a pool of three frames holds the header and two refs, a third ref or a scan fails
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(createRecord(&out, schema));
+	TEST_CHECK(openTableWithFrames(table, "test_table_r", RM_MIN_BUFFER_NUMS));
+	for (i = 100; r->id.page < 3; i++)
+	{
+		freeRecord(r);
+		r = testRecord(schema, i, "full", 8);
+		TEST_CHECK(insertRecord(table, r));
+	}
+	id.page = 1;
+	id.slot = 1;
+	TEST_CHECK(getRecordRef(table, id, &ref));
+	id.page = 2;
+	id.slot = 0;
+	TEST_CHECK(getRecordRef(table, id, &other));
+	ASSERT_TRUE(getRecordRef(table, r->id, &third) != RC_OK, "no ref without a free frame");
+	TEST_CHECK(startScan(table, &scan, NULL));
+	while ((rc = next(&scan, out)) == RC_OK)
+		;
+	ASSERT_TRUE(rc != RC_RM_NO_MORE_TUPLES, "scan stops at the page without a free frame");
+	TEST_CHECK(closeScan(&scan));
+	TEST_CHECK(releaseRecordRef(table, &other));
+	TEST_CHECK(getRecordRef(table, r->id, &third));
+	TEST_CHECK(releaseRecordRef(table, &third));
+	TEST_CHECK(releaseRecordRef(table, &ref));
+	ASSERT_EQUALS_INT(1, countPinned(table), "failed scan left no pin behind");
+	freeRecord(out);
+
+	freeRecord(r);
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_r"));
+	TEST_CHECK(shutdownRecordManager());
+	free(table);
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testFreeSpaceMap (void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	Schema *schema = testSchema();
+	RM_RecordMtdt *mgmtData;
+	Record *r;
+	RID rids[1000];
+	int i, pages;
+
+	testName = "test free space map";
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_f", schema));
+	TEST_CHECK(openTable(table, "test_table_f"));
+	mgmtData = (RM_RecordMtdt *) table->mgmtData;
+	r = testRecord(schema, 1, "aaaa", 1);
+	for (i = 0; i < 1000; i++)
+	{
+		setKey(r, schema, i);
+		TEST_CHECK(insertRecord(table, r));
+		rids[i] = r->id;
+	}
+	pages = mgmtData->pageOffset;
+	ASSERT_EQUALS_INT(0, mgmtData->fsm[0], "full page has no room in the map");
+
+	// every other record on every page goes, the map is persisted
+	for (i = 0; i < 1000; i += 2)
+		TEST_CHECK(deleteRecord(table, rids[i]));
+	ASSERT_TRUE(mgmtData->fsm[0] > 0, "delete gives the room back");
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(openTable(table, "test_table_f"));
+	mgmtData = (RM_RecordMtdt *) table->mgmtData;
+	ASSERT_TRUE(mgmtData->fsm[0] > 0, "map survives reopen");
+
+	// churn: the holes are filled from the first page on, the table does not grow
+	for (i = 0; i < 500; i++)
+	{
+		setKey(r, schema, 1000 + i);
+		TEST_CHECK(insertRecord(table, r));
+		ASSERT_TRUE(r->id.page == rids[2 * i].page, "hole of the lowest page reused");
+	}
+	ASSERT_EQUALS_INT(pages, mgmtData->pageOffset, "no page added while holes are left");
+	ASSERT_EQUALS_INT(1000, getNumTuples(table), "tuple count after churn");
+	setKey(r, schema, 1500);
+	TEST_CHECK(insertRecord(table, r));
+	ASSERT_TRUE(r->id.page == pages || r->id.page == pages + 1, "table grows at the end once dense");
+
+	freeRecord(r);
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_f"));
+	TEST_CHECK(shutdownRecordManager());
+	free(table);
+	TEST_DONE();
+}
+
+// ************************************************************
+static Schema *
+testWideSchema (void)
+{
+	char **names = (char **) malloc(sizeof(char*) * 2);
+	DataType *dt = (DataType *) malloc(sizeof(DataType) * 2);
+	int *sizes = (int *) malloc(sizeof(int) * 2);
+	int *keys = (int *) malloc(sizeof(int));
+
+	names[0] = strdup("a");
+	names[1] = strdup("b");
+	dt[0] = DT_INT;
+	dt[1] = DT_STRING;
+	sizes[0] = 0;
+	sizes[1] = 255;
+	keys[0] = 0;
+	return createSchema(2, names, dt, sizes, 1, keys);
+}
+
+static Record *
+wideRecord (Schema *schema, int a, int len)
+{
+	Record *result;
+	Value *value;
+	char b[256];
+
+	memset(b, 'a' + a % 26, len);
+	b[len] = '\0';
+	TEST_CHECK(createRecord(&result, schema));
+	memset(result->data, 0, getRecordSize(schema));
+	MAKE_VALUE(value, DT_INT, a);
+	TEST_CHECK(setAttr(result, schema, 0, value));
+	freeVal(value);
+	MAKE_STRING_VALUE(value, b);
+	TEST_CHECK(setAttr(result, schema, 1, value));
+	freeVal(value);
+	return result;
+}
+
+static RM_Slot *
+slotOf (RM_TableData *table, RID id, BM_PageHandle *h)
+{
+	RM_RecordMtdt *mgmtData = (RM_RecordMtdt *) table->mgmtData;
+	TEST_CHECK(pinPage(mgmtData->bm, h, id.page));
+	return &PAGE_SLOTS(h->data)[id.slot];
+}
+
+void
+testVariableLength (void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	Schema *schema = testWideSchema();
+	RM_RecordMtdt *mgmtData;
+	RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+	BM_PageHandle h;
+	Record *r, *out;
+	RID rids[400];
+	int i, n, seen, fixedPages;
+
+	testName = "test variable length records";
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_v", schema));
+	TEST_CHECK(openTable(table, "test_table_v"));
+	mgmtData = (RM_RecordMtdt *) table->mgmtData;
+	ASSERT_TRUE(mgmtData->varLength, "wide strings make a variable length table");
+
+	// short strings: the page count follows the data, not STRING[255]
+	for (i = 0; i < 400; i++)
+	{
+		r = wideRecord(schema, i, 10);
+		TEST_CHECK(insertRecord(table, r));
+		rids[i] = r->id;
+		freeRecord(r);
+	}
+	fixedPages = (400 + calcSlotMax(getRecordSize(schema)) - 1) / calcSlotMax(getRecordSize(schema));
+	ASSERT_TRUE(mgmtData->pageOffset * 5 < fixedPages, "pages track the actual record size");
+	TEST_CHECK(createRecord(&out, schema));
+	r = wideRecord(schema, 17, 10);
+	TEST_CHECK(getRecord(table, rids[17], out));
+	ASSERT_TRUE(memcmp(r->data, out->data, getRecordSize(schema)) == 0, "record decoded with its padding");
+	freeRecord(r);
+
+	// page 1 is full: deleting two neighbours leaves room to grow in place
+	TEST_CHECK(deleteRecord(table, rids[1]));
+	TEST_CHECK(deleteRecord(table, rids[2]));
+	r = wideRecord(schema, 0, 40);
+	r->id = rids[0];
+	TEST_CHECK(updateRecord(table, r));
+	ASSERT_TRUE(!(slotOf(table, rids[0], &h)->length & RM_SLOT_FORWARD), "grown record compacted into its page");
+	TEST_CHECK(unpinPage(mgmtData->bm, &h));
+	TEST_CHECK(getRecord(table, rids[0], out));
+	ASSERT_TRUE(memcmp(r->data, out->data, getRecordSize(schema)) == 0, "grown record read back");
+	freeRecord(r);
+
+	// no room left on the page: the record moves and keeps its id
+	r = wideRecord(schema, 3, 255);
+	r->id = rids[3];
+	TEST_CHECK(updateRecord(table, r));
+	ASSERT_TRUE(slotOf(table, rids[3], &h)->length & RM_SLOT_FORWARD, "record forwarded");
+	TEST_CHECK(unpinPage(mgmtData->bm, &h));
+	TEST_CHECK(getRecord(table, rids[3], out));
+	ASSERT_TRUE(memcmp(r->data, out->data, getRecordSize(schema)) == 0, "forwarded record read through its id");
+	freeRecord(r);
+	r = wideRecord(schema, 3, 200);
+	r->id = rids[3];
+	TEST_CHECK(updateRecord(table, r));
+	TEST_CHECK(getRecord(table, rids[3], out));
+	ASSERT_TRUE(memcmp(r->data, out->data, getRecordSize(schema)) == 0, "forwarded record updated again");
+	freeRecord(r);
+
+	// a scan returns every record once, the moved one under its own id
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(openTable(table, "test_table_v"));
+	seen = n = 0;
+	TEST_CHECK(startScan(table, sc, NULL));
+	while (next(sc, out) == RC_OK)
+	{
+		if (out->id.page == rids[3].page && out->id.slot == rids[3].slot)
+			n++;
+		seen++;
+	}
+	TEST_CHECK(closeScan(sc));
+	ASSERT_EQUALS_INT(398, seen, "scan sees every record once");
+	ASSERT_EQUALS_INT(1, n, "moved record scanned under its id");
+
+	TEST_CHECK(deleteRecord(table, rids[3]));
+	ASSERT_EQUALS_INT(RC_RM_DELETED_TUPLES, getRecord(table, rids[3], out), "moved record deleted");
+	ASSERT_EQUALS_INT(397, getNumTuples(table), "tuple count after deleting a moved record");
+
+	freeRecord(out);
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_v"));
+	TEST_CHECK(shutdownRecordManager());
+	free(table);
+	free(sc);
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testTableHeader (void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	RM_TableData *other = (RM_TableData *) malloc(sizeof(RM_TableData));
+	Schema *schema = testSchema();
+	Schema *cached, *wide = testWideSchema();
+	Record *r;
+	int i, offset;
+
+	testName = "test binary table header and schema cache";
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_h", schema));
+	TEST_CHECK(openTable(table, "test_table_h"));
+	ASSERT_TRUE(isBinaryTableHeader(((RM_RecordMtdt *) table->mgmtData)->phSchema->data), "binary header written on create");
+	ASSERT_EQUALS_INT(3, table->schema->numAttr, "attributes read from the header");
+	for (i = 0; i < 3; i++)
+	{
+		ASSERT_TRUE(strcmp(schema->attrNames[i], table->schema->attrNames[i]) == 0, "attribute name kept");
+		ASSERT_EQUALS_INT(schema->dataTypes[i], table->schema->dataTypes[i], "data type kept");
+		ASSERT_EQUALS_INT(schema->typeLength[i], table->schema->typeLength[i], "type length kept");
+	}
+	ASSERT_TRUE(table->schema->keySize == 1 && table->schema->keyAttrs[0] == 0, "key kept");
+	attrOffset(schema, 2, &offset);
+	ASSERT_EQUALS_INT(offset, ((RM_AttrEntry *) (((RM_RecordMtdt *) table->mgmtData)->phSchema->data + sizeof(RM_TableHeader)))[2].offset, "attribute offset stored");
+	r = testRecord(schema, 1, "aaaa", 2);
+	for (i = 0; i < 10; i++)
+	{
+		setKey(r, schema, i);
+		TEST_CHECK(insertRecord(table, r));
+	}
+	cached = table->schema;
+
+	// a second handle shares the schema, the counters survive a reopen
+	TEST_CHECK(openTable(other, "test_table_h"));
+	ASSERT_TRUE(other->schema == cached, "open table shares the cached schema");
+	TEST_CHECK(closeTable(other));
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(openTable(table, "test_table_h"));
+	ASSERT_TRUE(table->schema == cached, "reopen takes the schema from the cache");
+	ASSERT_EQUALS_INT(10, getNumTuples(table), "tuple count persisted");
+	TEST_CHECK(closeTable(table));
+
+	// a table created again under the same name gets its new schema
+	TEST_CHECK(deleteTable("test_table_h"));
+	TEST_CHECK(createTable("test_table_h", wide));
+	TEST_CHECK(openTable(table, "test_table_h"));
+	ASSERT_EQUALS_INT(2, table->schema->numAttr, "new schema after re-create");
+	ASSERT_EQUALS_INT(0, getNumTuples(table), "new table is empty");
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_h"));
+	TEST_CHECK(shutdownRecordManager());
+
+	freeRecord(r);
+	free(table);
+	free(other);
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testSchemaLayout (void)
+{
+	Schema *schema = testSchema();
+	Schema *wide = testWideSchema();
+	char *str = serializeSchema(schema);
+	Schema *parsed = deserializeSchema(str);
+	Record *r;
+	int offset;
+
+	testName = "test schema layout";
+
+	ASSERT_EQUALS_INT(12, schema->layout->recordSize, "record size");
+	ASSERT_TRUE(schema->layout->offsets[0] == 0 && schema->layout->offsets[1] == 4 && schema->layout->offsets[2] == 8, "attribute offsets");
+	ASSERT_TRUE(schema->layout->sizes[0] == 4 && schema->layout->sizes[1] == 4 && schema->layout->sizes[2] == 4, "attribute sizes");
+	ASSERT_EQUALS_INT(getRecordSize(schema), getRecordSize(parsed), "parsed schema has the same layout");
+	TEST_CHECK(attrOffset(parsed, 2, &offset));
+	ASSERT_EQUALS_INT(8, offset, "offset of a parsed schema");
+	ASSERT_EQUALS_INT(259, getRecordSize(wide), "layout with a long string");
+
+	// accessors agree with the layout
+	r = testRecord(schema, 7, "abcd", 9);
+	ASSERT_EQUALS_INT(9, getIntAttr(r, parsed, 2), "int read through the layout");
+	ASSERT_TRUE(memcmp(r->data + 4, "abcd", 4) == 0, "string stored at its offset");
+
+	freeRecord(r);
+	freeTableSchema(parsed);
+	free(str);
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testBulkInsert (void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	Schema *schema = testSchema();
+	RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+	Record *records[3000];
+	RID rids[3000], first[10];
+	Record *out;
+	char b[5];
+	int i, seen;
+
+	testName = "test bulk insert";
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_b", schema));
+	TEST_CHECK(openTable(table, "test_table_b"));
+	for (i = 0; i < 3000; i++)
+	{
+		sprintf(b, "%04i", i % 10000);
+		records[i] = testRecord(schema, i, b, -i);
+	}
+
+	// holes of deleted records are filled before new pages are added
+	TEST_CHECK(insertRecords(table, records, 10, first));
+	for (i = 0; i < 10; i += 2)
+		TEST_CHECK(deleteRecord(table, first[i]));
+	TEST_CHECK(insertRecords(table, records + 10, 2990, rids + 10));
+	for (i = 10; i < 15; i++)
+		ASSERT_TRUE(rids[i].page == 1, "holes on the first page reused");
+	ASSERT_EQUALS_INT(2995, getNumTuples(table), "tuple count after bulk insert");
+	ASSERT_TRUE(rids[2999].page == records[2999]->id.page && rids[2999].slot == records[2999]->id.slot, "record ids set");
+
+	// the pages written outside the pool read back, also after reopen
+	TEST_CHECK(createRecord(&out, schema));
+	for (i = 10; i < 3000; i += 7)
+	{
+		TEST_CHECK(getRecord(table, rids[i], out));
+		ASSERT_TRUE(memcmp(records[i]->data, out->data, getRecordSize(schema)) == 0, "bulk inserted record read back");
+	}
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(openTable(table, "test_table_b"));
+	ASSERT_EQUALS_INT(2995, getNumTuples(table), "tuple count persisted");
+	seen = 0;
+	TEST_CHECK(startScan(table, sc, NULL));
+	while (next(sc, out) == RC_OK)
+		seen++;
+	TEST_CHECK(closeScan(sc));
+	ASSERT_EQUALS_INT(2995, seen, "scan sees every bulk inserted record");
+	TEST_CHECK(getRecord(table, rids[2999], out));
+	ASSERT_TRUE(memcmp(records[2999]->data, out->data, getRecordSize(schema)) == 0, "last record after reopen");
+
+	// single inserts continue after the bulk loaded pages
+	TEST_CHECK(insertRecord(table, records[0]));
+	ASSERT_TRUE(records[0]->id.page >= rids[2999].page, "insert after the loaded pages");
+
+	for (i = 0; i < 3000; i++)
+		freeRecord(records[i]);
+	freeRecord(out);
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_b"));
+	TEST_CHECK(shutdownRecordManager());
+	free(table);
+	free(sc);
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testBulkInsertTooLarge (void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	char **names = (char **) malloc(sizeof(char*) * 2);
+	DataType *dt = (DataType *) malloc(sizeof(DataType) * 2);
+	int *sizes = (int *) malloc(sizeof(int) * 2);
+	int *keys = (int *) malloc(sizeof(int));
+	Schema *schema;
+	Record *records[1001];
+	Record *out;
+	RID rids[1001];
+	Value *value, *key[1];
+	char *huge = (char *) malloc(PAGE_SIZE + 1);
+	int i;
+
+	testName = "test bulk insert of a record larger than a page";
+
+	names[0] = strdup("a");
+	names[1] = strdup("b");
+	dt[0] = DT_INT;
+	dt[1] = DT_STRING;
+	sizes[0] = 0;
+	sizes[1] = PAGE_SIZE;
+	keys[0] = 0;
+	schema = createSchema(2, names, dt, sizes, 1, keys);
+	memset(huge, 'z', PAGE_SIZE);
+	huge[PAGE_SIZE] = '\0';
+	for (i = 0; i < 1001; i++)
+	{
+		TEST_CHECK(createRecord(&records[i], schema));
+		memset(records[i]->data, 0, getRecordSize(schema));
+		setKey(records[i], schema, i);
+		MAKE_STRING_VALUE(value, i < 1000 ? "x" : huge);
+		TEST_CHECK(setAttr(records[i], schema, 1, value));
+		freeVal(value);
+	}
+
+	// the pages filled before the record that fits no page are written
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_bl", schema));
+	TEST_CHECK(openTable(table, "test_table_bl"));
+	ASSERT_EQUALS_INT(RC_FAIL, insertRecords(table, records, 1001, rids), "record larger than a page");
+	ASSERT_EQUALS_INT(1000, getNumTuples(table), "records before it inserted");
+	ASSERT_TRUE(((RM_RecordMtdt *) table->mgmtData)->pageOffset > 2, "several pages written");
+
+	// its key was not kept, the pages are not taken again
+	MAKE_STRING_VALUE(value, "y");
+	TEST_CHECK(setAttr(records[1000], schema, 1, value));
+	freeVal(value);
+	TEST_CHECK(insertRecord(table, records[1000]));
+	TEST_CHECK(createRecord(&out, schema));
+	for (i = 0; i < 1000; i++)
+	{
+		MAKE_VALUE(key[0], DT_INT, i);
+		TEST_CHECK(getRecordByKey(table, key, out));
+		freeVal(key[0]);
+		ASSERT_TRUE(out->id.page == rids[i].page && out->id.slot == rids[i].slot, "key points at the inserted record");
+		ASSERT_EQUALS_INT(i, getIntAttr(out, schema, 0), "record read back");
+	}
+
+	for (i = 0; i < 1001; i++)
+		freeRecord(records[i]);
+	freeRecord(out);
+	free(huge);
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_bl"));
+	TEST_CHECK(shutdownRecordManager());
+	free(table);
+	TEST_DONE();
+}
+
+// ************************************************************
+static int
+countPinned (RM_TableData *table)
+{
+	BM_BufferPool *bm = ((RM_RecordMtdt *) table->mgmtData)->bm;
+	int *fixCounts = getFixCounts(bm);
+	int i, pinned = 0;
+	for (i = 0; i < bm->numPages; i++)
+		pinned += fixCounts[i];
+	free(fixCounts);
+	return pinned;
+}
+
+void
+testScanCursor (void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	Schema *schema = testSchema();
+	RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+	Record *records[5000];
+	RID rids[5000];
+	Record *out;
+	Expr *sel, *left, *right;
+	int i, seen;
+
+	testName = "test scan cursor";
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_c", schema));
+	TEST_CHECK(openTable(table, "test_table_c"));
+	for (i = 0; i < 5000; i++)
+		records[i] = testRecord(schema, i, "abcd", i % 7);
+	TEST_CHECK(insertRecords(table, records, 5000, rids));
+	TEST_CHECK(createRecord(&out, schema));
+
+	// a predicate matching one record at the end of many pages
+	MAKE_CONS(left, stringToValue("i4999"));
+	MAKE_ATTRREF(right, 0);
+	MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+	TEST_CHECK(startScan(table, sc, sel));
+	TEST_CHECK(next(sc, out));
+	ASSERT_TRUE(out->id.page == rids[4999].page && out->id.slot == rids[4999].slot, "only match found");
+	ASSERT_EQUALS_INT(2, countPinned(table), "scan holds the header and its current page");
+	ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, next(sc, out), "no more matches");
+	ASSERT_EQUALS_INT(1, countPinned(table), "page unpinned at the end");
+	TEST_CHECK(closeScan(sc));
+	freeExpr(sel);
+
+	// a condition comparing different types is refused up front
+	MAKE_CONS(left, stringToValue("sabcd"));
+	MAKE_ATTRREF(right, 0);
+	MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+	ASSERT_EQUALS_INT(RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE, startScan(table, sc, sel), "ill typed condition");
+	freeExpr(sel);
+
+	// records deleted behind and ahead of the cursor, whole pages emptied
+	for (i = 0; i < 5000; i++)
+		if (i % 2 == 0 || (rids[i].page == rids[2500].page))
+			TEST_CHECK(deleteRecord(table, rids[i]));
+	seen = 0;
+	TEST_CHECK(startScan(table, sc, NULL));
+	while (next(sc, out) == RC_OK)
+	{
+		if (seen == 10)
+			TEST_CHECK(deleteRecord(table, rids[4999]));
+		ASSERT_TRUE(getIntAttr(out, schema, 0) % 2 == 1, "deleted records skipped");
+		seen++;
+	}
+	TEST_CHECK(closeScan(sc));
+	ASSERT_EQUALS_INT(getNumTuples(table), seen, "scan sees the live records");
+
+	// closing a scan early gives its pin back
+	TEST_CHECK(startScan(table, sc, NULL));
+	TEST_CHECK(next(sc, out));
+	TEST_CHECK(closeScan(sc));
+	ASSERT_EQUALS_INT(1, countPinned(table), "early close unpins");
+
+	for (i = 0; i < 5000; i++)
+		freeRecord(records[i]);
+	freeRecord(out);
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_c"));
+	TEST_CHECK(shutdownRecordManager());
+	free(table);
+	free(sc);
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testBatchScan (void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	Schema *schema = testSchema();
+	RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+	RM_Batch *batch;
+	Record *records[5000];
+	RID rids[5000];
+	Record *out;
+	Expr *sel, *and, *lt, *eq, *left, *right;
+	int i, k, row, a, expected, seen, wrong;
+
+	testName = "test batch scan";
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_v", schema));
+	TEST_CHECK(openTable(table, "test_table_v"));
+	for (i = 0; i < 5000; i++)
+		records[i] = testRecord(schema, i, i % 100 == 0 ? "zzzz" : "abcd", i % 7);
+	TEST_CHECK(insertRecords(table, records, 5000, rids));
+	TEST_CHECK(createRecord(&out, schema));
+	TEST_CHECK(createBatch(&batch, schema, 100));
+
+	// (a < 1000 AND c = 3) OR b = "zzzz", batches cross page boundaries
+	MAKE_ATTRREF(left, 0);
+	MAKE_CONS(right, stringToValue("i1000"));
+	MAKE_BINOP_EXPR(lt, left, right, OP_COMP_SMALLER);
+	MAKE_ATTRREF(left, 2);
+	MAKE_CONS(right, stringToValue("i3"));
+	MAKE_BINOP_EXPR(eq, left, right, OP_COMP_EQUAL);
+	MAKE_BINOP_EXPR(and, lt, eq, OP_BOOL_AND);
+	MAKE_ATTRREF(left, 1);
+	MAKE_CONS(right, stringToValue("szzzz"));
+	MAKE_BINOP_EXPR(eq, left, right, OP_COMP_EQUAL);
+	MAKE_BINOP_EXPR(sel, and, eq, OP_BOOL_OR);
+	expected = 0;
+	for (i = 0; i < 5000; i++)
+		expected += (i < 1000 && i % 7 == 3) || i % 100 == 0;
+	TEST_CHECK(startScan(table, sc, sel));
+	seen = wrong = 0;
+	while (nextBatch(sc, batch) == RC_OK)
+	{
+		for (k = 0; k < batch->numSelected; k++)
+		{
+			row = batch->selection[k];
+			a = ((int *) batch->columns[0])[row];
+			wrong += !((a < 1000 && ((int *) batch->columns[2])[row] == 3) || a % 100 == 0);
+			wrong += batch->rids[row].page != rids[a].page || batch->rids[row].slot != rids[a].slot;
+			wrong += memcmp(batch->columns[1] + row * 4, a % 100 == 0 ? "zzzz" : "abcd", 4) != 0;
+		}
+		seen += batch->numSelected;
+	}
+	TEST_CHECK(closeScan(sc));
+	ASSERT_EQUALS_INT(expected, seen, "batches select the matches");
+	ASSERT_EQUALS_INT(0, wrong, "selected rows hold their values");
+	ASSERT_EQUALS_INT(1, countPinned(table), "page unpinned at the end");
+
+	// next() and nextBatch() share the cursor
+	TEST_CHECK(startScan(table, sc, sel));
+	TEST_CHECK(next(sc, out));
+	TEST_CHECK(nextBatch(sc, batch));
+	ASSERT_EQUALS_INT(3, ((int *) batch->columns[0])[batch->selection[0]], "batch goes on after next()");
+	TEST_CHECK(closeScan(sc));
+	freeExpr(sel);
+
+	// a condition left to evalExpr is tested as rows are loaded
+	MAKE_ATTRREF(left, 0);
+	MAKE_CONS(right, stringToValue("i10"));
+	MAKE_BINOP_EXPR(lt, left, right, OP_COMP_SMALLER);
+	MAKE_ATTRREF(left, 2);
+	MAKE_CONS(right, stringToValue("i3"));
+	MAKE_BINOP_EXPR(eq, left, right, OP_COMP_EQUAL);
+	MAKE_BINOP_EXPR(sel, lt, eq, OP_COMP_EQUAL);
+	expected = 0;
+	for (i = 0; i < 5000; i++)
+		expected += (i < 10) == (i % 7 == 3);
+	TEST_CHECK(startScan(table, sc, sel));
+	seen = 0;
+	while (nextBatch(sc, batch) == RC_OK)
+		seen += batch->numSelected;
+	TEST_CHECK(closeScan(sc));
+	ASSERT_EQUALS_INT(expected, seen, "uncompiled condition");
+	freeExpr(sel);
+
+	// no condition selects every live row
+	for (i = 0; i < 5000; i += 3)
+		TEST_CHECK(deleteRecord(table, rids[i]));
+	TEST_CHECK(startScan(table, sc, NULL));
+	seen = 0;
+	while (nextBatch(sc, batch) == RC_OK)
+	{
+		ASSERT_TRUE(batch->numSelected == batch->numRows, "all rows selected");
+		seen += batch->numSelected;
+	}
+	TEST_CHECK(closeScan(sc));
+	ASSERT_EQUALS_INT(getNumTuples(table), seen, "batches see the live records");
+
+	for (i = 0; i < 5000; i++)
+		freeRecord(records[i]);
+	freeRecord(out);
+	TEST_CHECK(freeBatch(batch, schema));
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_v"));
+	TEST_CHECK(shutdownRecordManager());
+	free(table);
+	free(sc);
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testProjectedScan (void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	Schema *schema = testSchema(), *wide = testWideSchema();
+	RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+	RM_Batch *batch;
+	Record *records[500];
+	Record *out;
+	Expr *sel, *left, *right;
+	int projection[] = { 2 }, first[] = { 0 }, bad[] = { 3 };
+	int i, seen, wrong;
+
+	testName = "test projected scan";
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_p", schema));
+	TEST_CHECK(openTable(table, "test_table_p"));
+	for (i = 0; i < 500; i++)
+		records[i] = testRecord(schema, i, "abcd", i % 7);
+	TEST_CHECK(insertRecords(table, records, 500, NULL));
+	TEST_CHECK(createRecord(&out, schema));
+
+	ASSERT_EQUALS_INT(RC_RM_UNKOWN_DATATYPE, startProjectedScan(table, sc, NULL, 1, bad), "unknown attribute");
+
+	// c of the records with a < 10, a is tested on the page but not copied
+	MAKE_ATTRREF(left, 0);
+	MAKE_CONS(right, stringToValue("i10"));
+	MAKE_BINOP_EXPR(sel, left, right, OP_COMP_SMALLER);
+	TEST_CHECK(startProjectedScan(table, sc, sel, 1, projection));
+	seen = wrong = 0;
+	memset(out->data, 0x7f, getRecordSize(schema));
+	while (next(sc, out) == RC_OK)
+	{
+		wrong += getIntAttr(out, schema, 2) != (out->id.slot % 7);
+		wrong += out->data[0] != 0x7f || out->data[sizeof(int)] != 0x7f;
+		seen++;
+	}
+	TEST_CHECK(closeScan(sc));
+	ASSERT_EQUALS_INT(10, seen, "projected scan matches");
+	ASSERT_EQUALS_INT(0, wrong, "only the projected attribute copied");
+
+	// batches load the projected columns and those of the condition
+	TEST_CHECK(createBatch(&batch, schema, RM_BATCH_SIZE));
+	memset(batch->columns[1], 0x7f, RM_BATCH_SIZE * 4);
+	TEST_CHECK(startProjectedScan(table, sc, sel, 1, projection));
+	TEST_CHECK(nextBatch(sc, batch));
+	ASSERT_EQUALS_INT(10, batch->numSelected, "projected batch matches");
+	ASSERT_EQUALS_INT(9, ((int *) batch->columns[0])[batch->selection[9]], "condition column loaded");
+	ASSERT_TRUE(batch->columns[1][0] == 0x7f, "other columns left alone");
+	TEST_CHECK(closeScan(sc));
+	TEST_CHECK(freeBatch(batch, schema));
+	freeExpr(sel);
+	freeRecord(out);
+	for (i = 0; i < 500; i++)
+		freeRecord(records[i]);
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_p"));
+
+	// a variable length table only decodes the projected attribute
+	TEST_CHECK(createTable("test_table_p", wide));
+	TEST_CHECK(openTable(table, "test_table_p"));
+	for (i = 0; i < 100; i++)
+	{
+		records[i] = wideRecord(wide, i, 100);
+		TEST_CHECK(insertRecord(table, records[i]));
+		freeRecord(records[i]);
+	}
+	TEST_CHECK(createRecord(&out, wide));
+	TEST_CHECK(startProjectedScan(table, sc, NULL, 1, first));
+	seen = wrong = 0;
+	memset(out->data, 0x7f, getRecordSize(wide));
+	while (next(sc, out) == RC_OK)
+	{
+		wrong += getIntAttr(out, wide, 0) != seen;
+		wrong += out->data[sizeof(int)] != 0x7f;
+		seen++;
+	}
+	TEST_CHECK(closeScan(sc));
+	ASSERT_EQUALS_INT(100, seen, "all records scanned");
+	ASSERT_EQUALS_INT(0, wrong, "string not decoded");
+
+	freeRecord(out);
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_p"));
+	TEST_CHECK(shutdownRecordManager());
+	free(table);
+	free(sc);
+	TEST_DONE();
+}
+
+// ************************************************************
+#define PARALLEL_WORKERS 4
+
+typedef struct ParallelTotals {
+	Schema *schema;
+	long sum[PARALLEL_WORKERS];
+	int count[PARALLEL_WORKERS];
+	int limit;
+} ParallelTotals;
+
+static RC
+sumRecord (Record *record, int worker, void *arg)
+{
+	ParallelTotals *totals = (ParallelTotals *) arg;
+	totals->sum[worker] += getIntAttr(record, totals->schema, 0);
+	totals->count[worker] += 1;
+	if (totals->limit && totals->count[worker] >= totals->limit)
+		return RC_FAIL;
+	return RC_OK;
+}
+
+void
+testParallelScan (void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	Schema *schema = testSchema();
+	Record *records[1000];
+	ParallelTotals totals;
+	Expr *sel, *left, *right;
+	long sum, expected;
+	int i, j, count;
+
+	testName = "test parallel scan";
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_m", schema));
+	TEST_CHECK(openTable(table, "test_table_m"));
+	for (i = 0; i < 20; i++)
+	{
+		for (j = 0; j < 1000; j++)
+			records[j] = testRecord(schema, i * 1000 + j, "abcd", j % 7);
+		TEST_CHECK(insertRecords(table, records, 1000, NULL));
+		for (j = 0; j < 1000; j++)
+			freeRecord(records[j]);
+	}
+
+	// records with c = 3, summed by each worker on its own
+	MAKE_ATTRREF(left, 2);
+	MAKE_CONS(right, stringToValue("i3"));
+	MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+	expected = 0;
+	for (i = 0; i < 20000; i++)
+		if (i % 1000 % 7 == 3)
+			expected += i;
+	memset(&totals, 0, sizeof(totals));
+	totals.schema = schema;
+	TEST_CHECK(parallelScan(table, sel, PARALLEL_WORKERS, sumRecord, &totals));
+	sum = count = 0;
+	for (i = 0; i < PARALLEL_WORKERS; i++)
+	{
+		sum += totals.sum[i];
+		count += totals.count[i];
+	}
+	ASSERT_EQUALS_INT(20 * 143, count, "every match seen once");
+	ASSERT_TRUE(sum == expected, "sum of the matches");
+	ASSERT_EQUALS_INT(1, countPinned(table), "workers unpinned their pages");
+
+	// a failing callback stops every worker
+	memset(&totals, 0, sizeof(totals));
+	totals.schema = schema;
+	totals.limit = 10;
+	ASSERT_EQUALS_INT(RC_FAIL, parallelScan(table, NULL, PARALLEL_WORKERS, sumRecord, &totals), "callback failure returned");
+	for (i = 0, count = 0; i < PARALLEL_WORKERS; i++)
+		count += totals.count[i];
+	ASSERT_TRUE(count < 20000, "scan stopped early");
+	ASSERT_EQUALS_INT(1, countPinned(table), "stopped workers unpinned their pages");
+
+	// more workers than the pool has frames for are refused, a bigger pool takes them
+	ASSERT_EQUALS_INT((MAX_BUFFER_NUMS - 1) / 2, getMaxScanWorkers(table), "workers of the default pool");
+	ASSERT_EQUALS_INT(RC_RM_TOO_MANY_WORKERS, parallelScan(table, sel, getMaxScanWorkers(table) + 1, sumRecord, &totals), "too many workers refused");
+	TEST_CHECK(closeTable(table));
+	ASSERT_EQUALS_INT(RC_FAIL, openTableWithFrames(table, "test_table_m", RM_MIN_BUFFER_NUMS - 1), "too small a pool refused");
+	TEST_CHECK(openTableWithFrames(table, "test_table_m", 4 * PARALLEL_WORKERS + 1));
+	ASSERT_EQUALS_INT(2 * PARALLEL_WORKERS, getMaxScanWorkers(table), "workers of a bigger pool");
+	memset(&totals, 0, sizeof(totals));
+	totals.schema = schema;
+	TEST_CHECK(parallelScan(table, sel, PARALLEL_WORKERS, sumRecord, &totals));
+	for (i = 0, count = 0; i < PARALLEL_WORKERS; i++)
+		count += totals.count[i];
+	ASSERT_EQUALS_INT(20 * 143, count, "every match seen once with a bigger pool");
+	freeExpr(sel);
+
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_m"));
+	TEST_CHECK(shutdownRecordManager());
+	free(table);
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testPaxLayout (void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	Schema *schema = testSchema();
+	RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+	RM_RecordMtdt *mgmtData;
+	RM_RecordRef ref;
+	RM_Batch *batch;
+	Record *records[3000];
+	RID rids[3000];
+	Record *out;
+	Value *value;
+	Expr *sel, *left, *right;
+	SM_FileHandle fh;
+	char page[PAGE_SIZE], b[5];
+	int attrs[] = { 2 };
+	int i, k, a, seen, wrong;
+
+	testName = "test PAX page layout";
+
+	TEST_CHECK(initRecordManager(NULL));
+	ASSERT_EQUALS_INT(RC_FAIL, createTableWithLayout("test_table_x", schema, 7), "unknown layout refused");
+	TEST_CHECK(createTableWithLayout("test_table_x", schema, RM_LAYOUT_PAX));
+	TEST_CHECK(openTable(table, "test_table_x"));
+	mgmtData = (RM_RecordMtdt *) table->mgmtData;
+	ASSERT_EQUALS_INT(RM_LAYOUT_PAX, mgmtData->layout, "layout read from the header");
+	ASSERT_EQUALS_INT(calcSlotMax(getRecordSize(schema)), mgmtData->slotMax, "as many records as a slotted page");
+	for (i = 0; i < 3000; i++)
+	{
+		sprintf(b, "%04i", i);
+		records[i] = testRecord(schema, i, b, i % 7);
+	}
+	for (i = 0; i < 10; i++)
+		TEST_CHECK(insertRecord(table, records[i]));
+	TEST_CHECK(insertRecords(table, records + 10, 2990, rids + 10));
+	for (i = 0; i < 10; i++)
+		rids[i] = records[i]->id;
+
+	// the values of an attribute lie next to each other on the page
+	ASSERT_TRUE(rids[1].page == 1 && rids[1].slot == 1, "second record in the second slot");
+	TEST_CHECK(pinPage(mgmtData->bm, mgmtData->ph, 1));
+	ASSERT_EQUALS_INT(1, *(int *) paxValue(mgmtData->ph->data, schema->layout, mgmtData->slotMax, 0, 1), "a of the second record");
+	ASSERT_TRUE(paxValue(mgmtData->ph->data, schema->layout, mgmtData->slotMax, 0, 1)
+			== paxValue(mgmtData->ph->data, schema->layout, mgmtData->slotMax, 0, 0) + sizeof(int), "minipage values packed");
+	TEST_CHECK(unpinPage(mgmtData->bm, mgmtData->ph));
+
+	// records read back whole, also after update, delete and reopen
+	TEST_CHECK(createRecord(&out, schema));
+	wrong = 0;
+	for (i = 0; i < 3000; i += 7)
+	{
+		TEST_CHECK(getRecord(table, rids[i], out));
+		wrong += memcmp(records[i]->data, out->data, getRecordSize(schema)) != 0;
+	}
+	ASSERT_EQUALS_INT(0, wrong, "records gathered from the minipages");
+	records[5]->id = rids[5];
+	MAKE_VALUE(value, DT_INT, 100);
+	TEST_CHECK(setAttr(records[5], schema, 2, value));
+	freeVal(value);
+	TEST_CHECK(updateRecord(table, records[5]));
+	TEST_CHECK(getRecordRef(table, rids[5], &ref));
+	ASSERT_EQUALS_INT(100, getIntAttr(&ref.record, schema, 2), "update in place");
+	TEST_CHECK(releaseRecordRef(table, &ref));
+	for (i = 0; i < 3000; i += 3)
+		TEST_CHECK(deleteRecord(table, rids[i]));
+	ASSERT_EQUALS_INT(RC_RM_DELETED_TUPLES, getRecord(table, rids[3], out), "deleted record gone");
+	TEST_CHECK(insertRecord(table, records[3]));
+	ASSERT_TRUE(records[3]->id.page == 1 && records[3]->id.slot == 0, "free slot reused");
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(openTable(table, "test_table_x"));
+	ASSERT_EQUALS_INT(2001, getNumTuples(table), "tuple count persisted");
+	TEST_CHECK(getRecord(table, rids[2999], out));
+	ASSERT_TRUE(memcmp(records[2999]->data, out->data, getRecordSize(schema)) == 0, "record after reopen");
+
+	// scans and batches only read the projected and condition attributes
+	MAKE_ATTRREF(left, 0);
+	MAKE_CONS(right, stringToValue("i1000"));
+	MAKE_BINOP_EXPR(sel, left, right, OP_COMP_SMALLER);
+	TEST_CHECK(startProjectedScan(table, sc, sel, 1, attrs));
+	memset(out->data, 0, getRecordSize(schema));
+	seen = wrong = 0;
+	while (next(sc, out) == RC_OK)
+	{
+		a = getIntAttr(out, schema, 0);
+		wrong += a >= 1000 || getIntAttr(out, schema, 2) != (a == 5 ? 100 : a % 7) || out->data[sizeof(int)] != 0;
+		seen++;
+	}
+	TEST_CHECK(closeScan(sc));
+	ASSERT_EQUALS_INT(667, seen, "projected scan of a PAX table");
+	ASSERT_EQUALS_INT(0, wrong, "only the projected attributes copied");
+
+	TEST_CHECK(createBatch(&batch, schema, 100));
+	TEST_CHECK(startProjectedScan(table, sc, sel, 1, attrs));
+	seen = wrong = 0;
+	while (nextBatch(sc, batch) == RC_OK)
+	{
+		for (k = 0; k < batch->numSelected; k++)
+		{
+			i = batch->selection[k];
+			a = ((int *) batch->columns[0])[i];
+			wrong += a >= 1000 || (a % 3 == 0 && a != 3);
+			wrong += ((int *) batch->columns[2])[i] != (a == 5 ? 100 : a % 7);
+			wrong += a != 3 && (batch->rids[i].page != rids[a].page || batch->rids[i].slot != rids[a].slot);
+		}
+		seen += batch->numSelected;
+	}
+	TEST_CHECK(closeScan(sc));
+	ASSERT_EQUALS_INT(667, seen, "batches of a PAX table");
+	ASSERT_EQUALS_INT(0, wrong, "runs of records copied by column");
+	TEST_CHECK(startScan(table, sc, NULL));
+	seen = 0;
+	while (nextBatch(sc, batch) == RC_OK)
+		seen += batch->numSelected;
+	TEST_CHECK(closeScan(sc));
+	ASSERT_EQUALS_INT(2001, seen, "batches without a condition");
+	ASSERT_EQUALS_INT(1, countPinned(table), "page unpinned at the end");
+	freeExpr(sel);
+	TEST_CHECK(freeBatch(batch, schema));
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_x"));
+
+	// a header written before the layout field reads as a row table
+	TEST_CHECK(createTable("test_table_x", schema));
+	TEST_CHECK(openTable(table, "test_table_x"));
+	TEST_CHECK(insertRecord(table, records[1]));
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(shutdownRecordManager());
+	TEST_CHECK(openPageFile("test_table_x", &fh));
+	TEST_CHECK(readBlock(0, &fh, page));
+	((RM_TableHeader *) page)->version = RM_FORMAT_BINARY;
+	memmove(page + offsetof(RM_TableHeader, layout), page + sizeof(RM_TableHeader), RM_FSM_OFFSET - sizeof(RM_TableHeader));
+	TEST_CHECK(writeBlock(0, &fh, page));
+	TEST_CHECK(closePageFile(&fh));
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(openTable(table, "test_table_x"));
+	mgmtData = (RM_RecordMtdt *) table->mgmtData;
+	ASSERT_EQUALS_INT(RM_FORMAT_LAYOUT, mgmtData->version, "header rewritten on open");
+	ASSERT_EQUALS_INT(RM_LAYOUT_ROW, mgmtData->layout, "older table stored by row");
+	ASSERT_TRUE(strcmp("c", table->schema->attrNames[2]) == 0, "schema read from the older header");
+	TEST_CHECK(getRecord(table, records[1]->id, out));
+	ASSERT_TRUE(memcmp(records[1]->data, out->data, getRecordSize(schema)) == 0, "record of the older table");
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_x"));
+	TEST_CHECK(shutdownRecordManager());
+
+	for (i = 0; i < 3000; i++)
+		freeRecord(records[i]);
+	freeRecord(out);
+	free(table);
+	free(sc);
+	TEST_DONE();
+}
+
+// ************************************************************
+static int
+countZoneScan (RM_TableData *table, Expr *cond, int *skipped)
+{
+	RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+	Record *out;
+	int count = 0;
+
+	TEST_CHECK(createRecord(&out, table->schema));
+	TEST_CHECK(startScan(table, sc, cond));
+	while (next(sc, out) == RC_OK)
+		count++;
+	*skipped = ((RM_ScanMtdt *) sc->mgmtData)->skipped;
+	TEST_CHECK(closeScan(sc));
+	freeRecord(out);
+	free(sc);
+	return count;
+}
+
+void
+testZoneMaps (void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	Schema *schema = testSchema();
+	RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+	RM_RecordMtdt *mgmtData;
+	RM_Batch *batch;
+	Record *records[1000];
+	RID rids[20000];
+	Expr *low, *high, *not, *eq, *under, *either, *byC, *left, *right;
+	Value *value;
+	int i, j, pages, skipped, seen;
+
+	testName = "test zone maps";
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_z", schema));
+	TEST_CHECK(openTable(table, "test_table_z"));
+	for (i = 0; i < 20; i++)
+	{
+		for (j = 0; j < 1000; j++)
+			records[j] = testRecord(schema, i * 1000 + j, "abcd", j % 7);
+		TEST_CHECK(insertRecords(table, records, 1000, rids + i * 1000));
+		for (j = 0; j < 1000; j++)
+			freeRecord(records[j]);
+	}
+	mgmtData = (RM_RecordMtdt *) table->mgmtData;
+	pages = mgmtData->pageOffset;
+	ASSERT_EQUALS_INT(calcSlotMax(getRecordSize(schema)), getZone(mgmtData, 1)->count, "first page counted");
+	ASSERT_EQUALS_INT(0, getZone(mgmtData, 1)->bounds[0].intV, "smallest a of the first page");
+
+	// a < 100, NOT a < 19900, a = 5000, a < 100 OR a = 19999 and c = 3
+	MAKE_ATTRREF(left, 0);
+	MAKE_CONS(right, stringToValue("i100"));
+	MAKE_BINOP_EXPR(low, left, right, OP_COMP_SMALLER);
+	MAKE_ATTRREF(left, 0);
+	MAKE_CONS(right, stringToValue("i19900"));
+	MAKE_BINOP_EXPR(high, left, right, OP_COMP_SMALLER);
+	MAKE_UNOP_EXPR(not, high, OP_BOOL_NOT);
+	MAKE_CONS(left, stringToValue("i5000"));
+	MAKE_ATTRREF(right, 0);
+	MAKE_BINOP_EXPR(eq, left, right, OP_COMP_EQUAL);
+	MAKE_ATTRREF(left, 0);
+	MAKE_CONS(right, stringToValue("i19999"));
+	MAKE_BINOP_EXPR(byC, left, right, OP_COMP_EQUAL);
+	MAKE_ATTRREF(left, 0);
+	MAKE_CONS(right, stringToValue("i100"));
+	MAKE_BINOP_EXPR(under, left, right, OP_COMP_SMALLER);
+	MAKE_BINOP_EXPR(either, under, byC, OP_BOOL_OR);
+	MAKE_ATTRREF(left, 2);
+	MAKE_CONS(right, stringToValue("i3"));
+	MAKE_BINOP_EXPR(byC, left, right, OP_COMP_EQUAL);
+
+	ASSERT_EQUALS_INT(100, countZoneScan(table, low, &skipped), "a < 100");
+	ASSERT_EQUALS_INT(pages - 1, skipped, "pages past the range never pinned");
+	ASSERT_EQUALS_INT(100, countZoneScan(table, not, &skipped), "NOT a < 19900");
+	ASSERT_TRUE(skipped >= pages - 2, "pages before the range never pinned");
+	ASSERT_EQUALS_INT(1, countZoneScan(table, eq, &skipped), "5000 = a");
+	ASSERT_EQUALS_INT(pages - 1, skipped, "one page holds 5000");
+	ASSERT_EQUALS_INT(101, countZoneScan(table, either, &skipped), "a < 100 OR a = 19999");
+	ASSERT_EQUALS_INT(pages - 2, skipped, "first and last page pinned");
+	ASSERT_EQUALS_INT(20 * 143, countZoneScan(table, byC, &skipped), "c = 3");
+	ASSERT_EQUALS_INT(0, skipped, "unordered attribute skips nothing");
+
+	// an update widens the bounds, deleted records leave an empty page out;
+	// 5000 is a key, the record that has it goes first
+	TEST_CHECK(deleteRecord(table, rids[5000]));
+	TEST_CHECK(createRecord(&records[0], schema));
+	TEST_CHECK(getRecord(table, rids[10], records[0]));
+	MAKE_VALUE(value, DT_INT, 5000);
+	TEST_CHECK(setAttr(records[0], schema, 0, value));
+	freeVal(value);
+	TEST_CHECK(updateRecord(table, records[0]));
+	ASSERT_EQUALS_INT(1, countZoneScan(table, eq, &skipped), "updated record found");
+	ASSERT_EQUALS_INT(99, countZoneScan(table, low, &skipped), "old value gone");
+	for (i = 0; i < 20000; i++)
+		if (rids[i].page == 2)
+			TEST_CHECK(deleteRecord(table, rids[i]));
+	ASSERT_EQUALS_INT(0, getZone(mgmtData, 2)->count, "empty page counted");
+	ASSERT_EQUALS_INT(getNumTuples(table), countZoneScan(table, NULL, &skipped), "scan without a condition");
+	ASSERT_EQUALS_INT(1, skipped, "empty page never pinned");
+
+	// batches skip the same pages
+	TEST_CHECK(createBatch(&batch, schema, 64));
+	TEST_CHECK(startScan(table, sc, low));
+	seen = 0;
+	while (nextBatch(sc, batch) == RC_OK)
+		seen += batch->numSelected;
+	ASSERT_EQUALS_INT(pages - 1, ((RM_ScanMtdt *) sc->mgmtData)->skipped, "batches skip pages");
+	TEST_CHECK(closeScan(sc));
+	ASSERT_EQUALS_INT(99, seen, "batches of a < 100");
+	TEST_CHECK(freeBatch(batch, schema));
+
+	// saved on close, read and removed on open
+	TEST_CHECK(closeTable(table));
+	ASSERT_TRUE(fexist("test_table_z" RM_ZONE_SUFFIX), "zone map saved");
+	TEST_CHECK(openTable(table, "test_table_z"));
+	mgmtData = (RM_RecordMtdt *) table->mgmtData;
+	ASSERT_TRUE(!fexist("test_table_z" RM_ZONE_SUFFIX), "zone map file removed while open");
+	ASSERT_EQUALS_INT(0, getZone(mgmtData, 2)->count, "zone read back");
+	ASSERT_EQUALS_INT(1, countZoneScan(table, eq, &skipped), "5000 = a after reopen");
+	ASSERT_EQUALS_INT(pages - 2, skipped, "bounds read back");
+
+	// a table closed without its map builds it again
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(dropZoneMap("test_table_z"));
+	TEST_CHECK(openTable(table, "test_table_z"));
+	ASSERT_EQUALS_INT(1, countZoneScan(table, eq, &skipped), "5000 = a on a built map");
+	ASSERT_EQUALS_INT(pages - 2, skipped, "bounds built from the records");
+
+	freeExpr(low);
+	freeExpr(not);
+	freeExpr(eq);
+	freeExpr(either);
+	freeExpr(byC);
+	freeRecord(records[0]);
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_z"));
+	ASSERT_TRUE(!fexist("test_table_z" RM_ZONE_SUFFIX), "zone map deleted with the table");
+	TEST_CHECK(shutdownRecordManager());
+	free(table);
+	free(sc);
+	TEST_DONE();
+}
+
+// ************************************************************
+static Schema *
+testCompositeKeySchema (void)
+{
+	char **names = (char **) malloc(sizeof(char*) * 3);
+	DataType *dt = (DataType *) malloc(sizeof(DataType) * 3);
+	int *sizes = (int *) malloc(sizeof(int) * 3);
+	int *keys = (int *) malloc(sizeof(int) * 2);
+
+	names[0] = strdup("a");
+	names[1] = strdup("b");
+	names[2] = strdup("c");
+	dt[0] = DT_INT;
+	dt[1] = DT_STRING;
+	dt[2] = DT_INT;
+	sizes[0] = 0;
+	sizes[1] = 4;
+	sizes[2] = 0;
+	keys[0] = 0;
+	keys[1] = 1;
+	return createSchema(3, names, dt, sizes, 2, keys);
+}
+
+void
+testPrimaryKey (void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	Schema *schema = testSchema();
+	Schema *composite = testCompositeKeySchema();
+	Record *records[3000];
+	Record *r, *out;
+	Value *key[2];
+	RID rids[3000];
+	int i;
+
+	testName = "test primary key index";
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_k", schema));
+	ASSERT_TRUE(fexist("test_table_k" RM_INDEX_SUFFIX), "index created with the table");
+	TEST_CHECK(openTable(table, "test_table_k"));
+	for (i = 0; i < 3000; i++)
+		records[i] = testRecord(schema, (i * 7919) % 3000, "abcd", i);
+	TEST_CHECK(insertRecords(table, records, 3000, rids));
+	TEST_CHECK(createRecord(&out, schema));
+
+	// probes find every key, other keys are not there
+	for (i = 0; i < 3000; i++)
+	{
+		MAKE_VALUE(key[0], DT_INT, (i * 7919) % 3000);
+		TEST_CHECK(getRecordByKey(table, key, out));
+		freeVal(key[0]);
+		ASSERT_TRUE(out->id.page == rids[i].page && out->id.slot == rids[i].slot, "probe finds the record");
+		ASSERT_EQUALS_INT(i, getIntAttr(out, schema, 2), "probe reads the record");
+	}
+	MAKE_VALUE(key[0], DT_INT, 3000);
+	ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, getRecordByKey(table, key, out), "key not in the table");
+	freeVal(key[0]);
+
+	// duplicates are rejected and leave the table as it was
+	r = testRecord(schema, 42, "dup", 0);
+	ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, insertRecord(table, r), "duplicate insert rejected");
+	ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, insertRecords(table, records, 1, NULL), "duplicate bulk insert rejected");
+	setKey(records[0], schema, 5000);
+	setKey(records[1], schema, 5000);
+	ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, insertRecords(table, records, 2, NULL), "duplicate inside a bulk insert rejected");
+	ASSERT_EQUALS_INT(3000, getNumTuples(table), "nothing inserted");
+	MAKE_VALUE(key[0], DT_INT, 5000);
+	ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, getRecordByKey(table, key, out), "keys of a rejected bulk insert removed");
+	freeVal(key[0]);
+
+	// an update may keep its key or take a free one, not one in use
+	records[0]->id = rids[0];
+	setKey(records[0], schema, 1);
+	ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, updateRecord(table, records[0]), "update to a key in use rejected");
+	setKey(records[0], schema, 0);
+	TEST_CHECK(updateRecord(table, records[0]));
+	setKey(records[0], schema, 4000);
+	TEST_CHECK(updateRecord(table, records[0]));
+	MAKE_VALUE(key[0], DT_INT, 0);
+	ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, getRecordByKey(table, key, out), "old key gone");
+	freeVal(key[0]);
+	MAKE_VALUE(key[0], DT_INT, 4000);
+	TEST_CHECK(getRecordByKey(table, key, out));
+	freeVal(key[0]);
+	ASSERT_TRUE(out->id.page == rids[0].page && out->id.slot == rids[0].slot, "new key finds the record");
+
+	// a deleted record frees its key
+	TEST_CHECK(deleteRecord(table, rids[1]));
+	MAKE_VALUE(key[0], DT_INT, 7919 % 3000);
+	ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, getRecordByKey(table, key, out), "deleted key gone");
+	freeVal(key[0]);
+	setKey(r, schema, 7919 % 3000);
+	TEST_CHECK(insertRecord(table, r));
+
+	// the index is built again on open, a table without one is scanned
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(openTable(table, "test_table_k"));
+	ASSERT_TRUE(((RM_RecordMtdt *) table->mgmtData)->index != NULL, "index rebuilt");
+	MAKE_VALUE(key[0], DT_INT, 4000);
+	TEST_CHECK(getRecordByKey(table, key, out));
+	ASSERT_TRUE(out->id.page == rids[0].page && out->id.slot == rids[0].slot, "probe after reopen");
+	TEST_CHECK(closeIndex(table));
+	TEST_CHECK(getRecordByKey(table, key, out));
+	ASSERT_TRUE(out->id.page == rids[0].page && out->id.slot == rids[0].slot, "scan without an index");
+	freeVal(key[0]);
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_k"));
+	ASSERT_TRUE(!fexist("test_table_k" RM_INDEX_SUFFIX), "index deleted with the table");
+
+	// a key of two attributes
+	TEST_CHECK(createTable("test_table_k", composite));
+	TEST_CHECK(openTable(table, "test_table_k"));
+	freeRecord(r);
+	r = testRecord(composite, 1, "ab", 1);
+	TEST_CHECK(insertRecord(table, r));
+	freeRecord(r);
+	r = testRecord(composite, 1, "abc", 2);
+	TEST_CHECK(insertRecord(table, r));
+	freeRecord(r);
+	r = testRecord(composite, 2, "ab", 3);
+	TEST_CHECK(insertRecord(table, r));
+	ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, insertRecord(table, r), "duplicate pair rejected");
+	MAKE_VALUE(key[0], DT_INT, 1);
+	MAKE_STRING_VALUE(key[1], "abc");
+	TEST_CHECK(getRecordByKey(table, key, out));
+	ASSERT_EQUALS_INT(2, getIntAttr(out, composite, 2), "probe by both attributes");
+	freeVal(key[1]);
+	MAKE_STRING_VALUE(key[1], "b");
+	ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, getRecordByKey(table, key, out), "pair not in the table");
+	freeVal(key[0]);
+	freeVal(key[1]);
+
+	for (i = 0; i < 3000; i++)
+		freeRecord(records[i]);
+	freeRecord(r);
+	freeRecord(out);
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_k"));
+	TEST_CHECK(shutdownRecordManager());
+	free(table);
+	TEST_DONE();
+}
+
+Schema *
+testSchema (void)
+{
+	Schema *result;
+	char *names[] = { "a", "b", "c" };
+	DataType dt[] = { DT_INT, DT_STRING, DT_INT };
+	int sizes[] = { 0, 4, 0 };
+	int keys[] = {0};
+	int i;
+	char **cpNames = (char **) malloc(sizeof(char*) * 3);
+	DataType *cpDt = (DataType *) malloc(sizeof(DataType) * 3);
+	int *cpSizes = (int *) malloc(sizeof(int) * 3);
+	int *cpKeys = (int *) malloc(sizeof(int));
+
+	for(i = 0; i < 3; i++)
+	{
+		cpNames[i] = (char *) malloc(2);
+		strcpy(cpNames[i], names[i]);
+	}
+	memcpy(cpDt, dt, sizeof(DataType) * 3);
+	memcpy(cpSizes, sizes, sizeof(int) * 3);
+	memcpy(cpKeys, keys, sizeof(int));
+
+	result = createSchema(3, cpNames, cpDt, cpSizes, 1, cpKeys);
+
+	return result;
+}
+
+Record *
+testRecord (Schema *schema, int a, char *b, int c)
+{
+	Record *result;
+	Value *value;
+
+	TEST_CHECK(createRecord(&result, schema));
+
+	MAKE_VALUE(value, DT_INT, a);
+	TEST_CHECK(setAttr(result, schema, 0, value));
+	freeVal(value);
+
+	MAKE_STRING_VALUE(value, b);
+	TEST_CHECK(setAttr(result, schema, 1, value));
+	freeVal(value);
+
+	MAKE_VALUE(value, DT_INT, c);
+	TEST_CHECK(setAttr(result, schema, 2, value));
+	freeVal(value);
+
+	return result;
+}
+
+void
+setKey (Record *record, Schema *schema, int a)
+{
+	Value *value;
+
+	MAKE_VALUE(value, DT_INT, a);
+	TEST_CHECK(setAttr(record, schema, 0, value));
+	freeVal(value);
+}
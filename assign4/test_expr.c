@@ -29,6 +29,9 @@
 static void testValueSerialize (void);
 static void testOperators (void);
 static void testExpressions (void);
+static void testCompiledExpressions (void);
+static void testShortCircuit (void);
+static void testBitmapKernels (void);
 
 char *testName;
 
@@ -41,6 +44,9 @@ main (void)
 	testValueSerialize();
 	testOperators();
 	testExpressions();
+	testCompiledExpressions();
+	testShortCircuit();
+	testBitmapKernels();
 
 	return 0;
 }
@@ -123,3 +129,235 @@ testExpressions (void)
 
 	TEST_DONE();
 }
+
+// ************************************************************
+// a compiled condition agrees with evalExpr on a record
+static bool
+compiledMatches (Expr *cond, Schema *schema, Record *record)
+{
+	ExprProgram *program;
+	Value *res;
+	bool compiled, evaluated;
+
+	TEST_CHECK(compileExpr(cond, schema, &program));
+	compiled = runExprProgram(program, record->data);
+	freeExprProgram(program);
+	evalExpr(record, schema, cond, &res);
+	evaluated = res->v.boolV;
+	freeVal(res);
+	ASSERT_TRUE(compiled == evaluated, "compiled condition agrees with evalExpr");
+	return compiled;
+}
+
+void
+testCompiledExpressions (void)
+{
+	char *names[] = { "a", "b", "c", "d" };
+	DataType dt[] = { DT_INT, DT_STRING, DT_FLOAT, DT_BOOL };
+	int sizes[] = { 0, 4, 0, 0 };
+	int keys[] = { 0 };
+	Schema *schema = createSchema(4, names, dt, sizes, 1, keys);
+	ExprProgram *program;
+	Expr *op, *l, *r, *cond;
+	Record *record;
+	testName = "test compiled expressions";
+
+	TEST_CHECK(createRecord(&record, schema));
+	TEST_CHECK(setAttr(record, schema, 0, stringToValue("i7")));
+	TEST_CHECK(setAttr(record, schema, 1, stringToValue("sabcd")));
+	TEST_CHECK(setAttr(record, schema, 2, stringToValue("f2.5")));
+	TEST_CHECK(setAttr(record, schema, 3, stringToValue("bt")));
+
+	// a = 7, a < 5, 2.5 < c, b = "abcd" filling the attribute, b < "abd"
+	MAKE_ATTRREF(l, 0);
+	MAKE_CONS(r, stringToValue("i7"));
+	MAKE_BINOP_EXPR(op, l, r, OP_COMP_EQUAL);
+	ASSERT_TRUE(compiledMatches(op, schema, record), "a = 7");
+	freeExpr(op);
+	MAKE_ATTRREF(l, 0);
+	MAKE_CONS(r, stringToValue("i5"));
+	MAKE_BINOP_EXPR(op, l, r, OP_COMP_SMALLER);
+	ASSERT_TRUE(!compiledMatches(op, schema, record), "not a < 5");
+	freeExpr(op);
+	MAKE_CONS(l, stringToValue("f2.5"));
+	MAKE_ATTRREF(r, 2);
+	MAKE_BINOP_EXPR(op, l, r, OP_COMP_SMALLER);
+	ASSERT_TRUE(!compiledMatches(op, schema, record), "not 2.5 < c");
+	freeExpr(op);
+	MAKE_ATTRREF(l, 1);
+	MAKE_CONS(r, stringToValue("sabcd"));
+	MAKE_BINOP_EXPR(op, l, r, OP_COMP_EQUAL);
+	ASSERT_TRUE(compiledMatches(op, schema, record), "b = abcd");
+	freeExpr(op);
+	MAKE_ATTRREF(l, 1);
+	MAKE_CONS(r, stringToValue("sabd"));
+	MAKE_BINOP_EXPR(op, l, r, OP_COMP_SMALLER);
+	ASSERT_TRUE(compiledMatches(op, schema, record), "b < abd");
+
+	// NOT (b < abd) OR (d AND a = 7)
+	MAKE_UNOP_EXPR(cond, op, OP_BOOL_NOT);
+	MAKE_ATTRREF(l, 0);
+	MAKE_CONS(r, stringToValue("i7"));
+	MAKE_BINOP_EXPR(op, l, r, OP_COMP_EQUAL);
+	MAKE_ATTRREF(l, 3);
+	MAKE_BINOP_EXPR(r, l, op, OP_BOOL_AND);
+	MAKE_BINOP_EXPR(op, cond, r, OP_BOOL_OR);
+	ASSERT_TRUE(compiledMatches(op, schema, record), "NOT (b < abd) OR (d AND a = 7)");
+	freeExpr(op);
+
+	// type errors are returned instead of aborting
+	MAKE_ATTRREF(l, 0);
+	MAKE_CONS(r, stringToValue("sabc"));
+	MAKE_BINOP_EXPR(op, l, r, OP_COMP_EQUAL);
+	ASSERT_EQUALS_INT(RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE, compileExpr(op, schema, &program), "int compared to a string");
+	freeExpr(op);
+	MAKE_ATTRREF(l, 0);
+	MAKE_ATTRREF(r, 3);
+	MAKE_BINOP_EXPR(op, l, r, OP_BOOL_AND);
+	ASSERT_EQUALS_INT(RC_RM_BOOLEAN_EXPR_ARG_IS_NOT_BOOLEAN, compileExpr(op, schema, &program), "AND of an int");
+	freeExpr(op);
+
+	freeRecord(record);
+	freeSchema(schema);
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testShortCircuit (void)
+{
+	char *names[] = { "a", "b" };
+	DataType dt[] = { DT_INT, DT_STRING };
+	int sizes[] = { 0, 4 };
+	int keys[] = { 0 };
+	Schema *schema = createSchema(2, names, dt, sizes, 1, keys);
+	ExprProgram *program;
+	Expr *op, *l, *r, *cheap, *costly;
+	Record *record;
+	Value *res;
+	int i, matches;
+	testName = "test short circuit evaluation";
+
+	// the ill typed right operand is never looked at
+	MAKE_CONS(l, stringToValue("i1"));
+	MAKE_CONS(r, stringToValue("sx"));
+	MAKE_BINOP_EXPR(op, l, r, OP_COMP_EQUAL);
+	MAKE_CONS(l, stringToValue("bf"));
+	MAKE_BINOP_EXPR(r, l, op, OP_BOOL_AND);
+	TEST_CHECK(evalExpr(NULL, NULL, r, &res));
+	ASSERT_TRUE(res->dt == DT_BOOL && !res->v.boolV, "false AND anything");
+	freeVal(res);
+	((Operator *) r->expr.op)->args[0]->expr.cons->v.boolV = TRUE;
+	((Operator *) r->expr.op)->type = OP_BOOL_OR;
+	TEST_CHECK(evalExpr(NULL, NULL, r, &res));
+	ASSERT_TRUE(res->dt == DT_BOOL && res->v.boolV, "true OR anything");
+	freeVal(res);
+	freeExpr(r);
+
+	// b = "zzzz" AND a < 100: the int compare starts first, the string
+	// compare rejecting every record takes over once observed
+	TEST_CHECK(createRecord(&record, schema));
+	TEST_CHECK(setAttr(record, schema, 0, stringToValue("i7")));
+	TEST_CHECK(setAttr(record, schema, 1, stringToValue("sabcd")));
+	MAKE_ATTRREF(l, 1);
+	MAKE_CONS(r, stringToValue("szzzz"));
+	MAKE_BINOP_EXPR(costly, l, r, OP_COMP_EQUAL);
+	MAKE_ATTRREF(l, 0);
+	MAKE_CONS(r, stringToValue("i100"));
+	MAKE_BINOP_EXPR(cheap, l, r, OP_COMP_SMALLER);
+	MAKE_BINOP_EXPR(op, costly, cheap, OP_BOOL_AND);
+	TEST_CHECK(compileExpr(op, schema, &program));
+	ASSERT_EQUALS_INT(2, program->numConjuncts, "two conjuncts");
+	ASSERT_EQUALS_INT(1, program->conjuncts[0].position, "cheap conjunct first");
+	for (i = 0, matches = 0; i < 2 * EXPR_REORDER_INTERVAL; i++)
+		matches += runExprProgram(program, record->data);
+	ASSERT_EQUALS_INT(0, matches, "no match");
+	ASSERT_EQUALS_INT(0, program->conjuncts[0].position, "selective conjunct moved first");
+	ASSERT_TRUE(program->conjuncts[0].passed == 0 && program->conjuncts[1].passed == EXPR_REORDER_INTERVAL,
+			"pass counters");
+	ASSERT_EQUALS_INT(EXPR_REORDER_INTERVAL, (int) program->conjuncts[1].evaluated, "skipped once moved behind");
+	freeExprProgram(program);
+	freeExpr(op);
+
+	freeRecord(record);
+	freeSchema(schema);
+	TEST_DONE();
+}
+
+// ************************************************************
+#define KERNEL_ROWS 1000
+
+// bits of a compare kernel against the plain loop
+#define CHECK_COMPARE(kernel, type, l, r, c, n, bits)			\
+		do {							\
+			int _i, _cmp;					\
+			type *_r = (r);					\
+			for (_cmp = EXPR_CMP_EQ; _cmp <= EXPR_CMP_GT; _cmp++) \
+			{						\
+				kernel(_cmp, l, _r, c, n, bits);		\
+				for (_i = 0; _i < BITMAP_WORDS(n) * 64; _i++) \
+				{					\
+					type _v = _r ? _r[_i] : (c);	\
+					bool _want = _i < n && (_cmp == EXPR_CMP_EQ ? (l)[_i] == _v : \
+							_cmp == EXPR_CMP_LT ? (l)[_i] < _v : (l)[_i] > _v); \
+					wrong += _want != (int) ((bits[_i >> 6] >> (_i & 63)) & 1); \
+				}					\
+			}						\
+		} while (0)
+
+void
+testBitmapKernels (void)
+{
+	int ints[KERNEL_ROWS + 64], others[KERNEL_ROWS + 64];
+	float floats[KERNEL_ROWS + 64], otherFloats[KERNEL_ROWS + 64];
+	uint64_t a[BITMAP_WORDS(KERNEL_ROWS)], b[BITMAP_WORDS(KERNEL_ROWS)], c[BITMAP_WORDS(KERNEL_ROWS)];
+	int sizes[] = { 1, 7, 37, 64, 100, KERNEL_ROWS };
+	int i, n, wrong;
+	size_t s;
+	ExprKernelLevel level;
+
+	testName = "test bitmap kernels";
+
+	srand(42);
+	for (i = 0; i < KERNEL_ROWS + 64; i++)
+	{
+		ints[i] = rand() % 16 - 8;
+		others[i] = rand() % 16 - 8;
+		floats[i] = ints[i] * 0.5f;
+		otherFloats[i] = others[i] * 0.5f;
+	}
+
+	// every level the CPU has computes the bits of the plain comparisons
+	for (level = EXPR_KERNELS_SCALAR; level <= EXPR_KERNELS_AVX2; level++)
+	{
+		if (setExprKernels(level) != level)
+			continue;
+		wrong = 0;
+		for (s = 0; s < sizeof(sizes) / sizeof(int); s++)
+		{
+			n = sizes[s];
+			CHECK_COMPARE(bitmapCompareInt, int, ints, (int *) NULL, 3, n, a);
+			CHECK_COMPARE(bitmapCompareInt, int, ints, others, 0, n, a);
+			CHECK_COMPARE(bitmapCompareFloat, float, floats, (float *) NULL, 1.5f, n, a);
+			CHECK_COMPARE(bitmapCompareFloat, float, floats, otherFloats, 0, n, a);
+
+			bitmapCompareInt(EXPR_CMP_LT, ints, NULL, 0, n, a);
+			bitmapCompareInt(EXPR_CMP_EQ, others, NULL, 1, n, b);
+			memcpy(c, a, sizeof(c));
+			bitmapAnd(c, b, n);
+			for (i = 0; i < n; i++)
+				wrong += ((c[i >> 6] >> (i & 63)) & 1) != (ints[i] < 0 && others[i] == 1);
+			memcpy(c, a, sizeof(c));
+			bitmapOr(c, b, n);
+			for (i = 0; i < n; i++)
+				wrong += ((c[i >> 6] >> (i & 63)) & 1) != (ints[i] < 0 || others[i] == 1);
+			bitmapNot(a, n);
+			for (i = 0; i < BITMAP_WORDS(n) * 64; i++)
+				wrong += ((a[i >> 6] >> (i & 63)) & 1) != (i < n && ints[i] >= 0);
+		}
+		ASSERT_EQUALS_INT(0, wrong, "kernel bits match the scalar comparisons");
+	}
+	setExprKernels(EXPR_KERNELS_AVX2);
+
+	TEST_DONE();
+}